@@ -0,0 +1,242 @@
+#define _GNU_SOURCE
+#include "bench.h"
+#include <linux/perf_event.h>
+#include <math.h>
+#include <sched.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <time.h>
+#include <unistd.h>
+#if defined( __x86_64__ ) || defined( __i386__ )
+#include <x86intrin.h>
+#endif
+
+////////////////////////////////////////////////////////////////////////
+// Helper functions
+////////////////////////////////////////////////////////////////////////
+
+// Open one counter for the calling thread, user space only
+static int perf_open_counter( uint32_t type, uint64_t config ) {
+  struct perf_event_attr attr;
+  memset( &attr, 0, sizeof( attr ) );
+  attr.size = sizeof( attr );
+  attr.type = type;
+  attr.config = config;
+  attr.disabled = 1;
+  attr.exclude_kernel = 1;
+  attr.exclude_hv = 1;
+  return (int) syscall( SYS_perf_event_open, &attr, 0, -1, -1, 0 );
+}
+
+static uint64_t perf_read_counter( int fd ) {
+  uint64_t count;
+  if ( fd < 0 || read( fd, &count, sizeof( count ) ) != sizeof( count ) )
+    return UINT64_MAX;
+  return count;
+}
+
+static int compare_doubles( const void *a, const void *b ) {
+  double x = *(const double *) a, y = *(const double *) b;
+  return ( x > y ) - ( x < y );
+}
+
+// Quantile of sorted samples, interpolating between neighbors
+static double quantile( const double *sorted, size_t n, double q ) {
+  double pos = q * ( n - 1 );
+  size_t i = (size_t) pos;
+  if ( i + 1 >= n )
+    return sorted[n - 1];
+  return sorted[i] + ( pos - i ) * ( sorted[i + 1] - sorted[i] );
+}
+
+// Sample value and the set it came from, for ranking
+typedef struct {
+  double val;
+  int from_b;
+} ranked_t;
+
+static int compare_ranked( const void *a, const void *b ) {
+  return compare_doubles( &( (const ranked_t *) a )->val, &( (const ranked_t *) b )->val );
+}
+
+////////////////////////////////////////////////////////////////////////
+// Public functions
+////////////////////////////////////////////////////////////////////////
+
+double bench_now_sec( void ) {
+  struct timespec ts;
+  clock_gettime( CLOCK_MONOTONIC, &ts );
+  return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+uint64_t bench_cycles( void ) {
+#if defined( __x86_64__ ) || defined( __i386__ )
+  return __rdtsc();
+#else
+  return 0;
+#endif
+}
+
+uint64_t bench_rand( uint64_t *state ) {
+  *state ^= *state >> 12;
+  *state ^= *state << 25;
+  *state ^= *state >> 27;
+  return *state * 0x2545F4914F6CDD1DULL;
+}
+
+void bench_fill_random( fixpoint_t *vals, size_t n, uint64_t *state ) {
+  for ( size_t i = 0; i < n; i++ ) {
+    uint64_t r = bench_rand( state );
+    fixpoint_init( &vals[i], (uint32_t) ( r >> 56 ), (uint32_t) r, r & 0x100 );
+  }
+}
+
+bool bench_perf_open( bench_perf_t *perf ) {
+  perf->fd_instructions = perf_open_counter( PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS );
+  perf->fd_branch_misses = perf_open_counter( PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES );
+  return perf->fd_instructions >= 0 || perf->fd_branch_misses >= 0;
+}
+
+void bench_perf_start( bench_perf_t *perf ) {
+  int fds[2] = { perf->fd_instructions, perf->fd_branch_misses };
+  for ( int i = 0; i < 2; i++ ) {
+    if ( fds[i] >= 0 ) {
+      ioctl( fds[i], PERF_EVENT_IOC_RESET, 0 );
+      ioctl( fds[i], PERF_EVENT_IOC_ENABLE, 0 );
+    }
+  }
+}
+
+void bench_perf_stop( bench_perf_t *perf, uint64_t *instructions, uint64_t *branch_misses ) {
+  int fds[2] = { perf->fd_instructions, perf->fd_branch_misses };
+  for ( int i = 0; i < 2; i++ )
+    if ( fds[i] >= 0 )
+      ioctl( fds[i], PERF_EVENT_IOC_DISABLE, 0 );
+  *instructions = perf_read_counter( perf->fd_instructions );
+  *branch_misses = perf_read_counter( perf->fd_branch_misses );
+}
+
+void bench_perf_close( bench_perf_t *perf ) {
+  if ( perf->fd_instructions >= 0 )
+    close( perf->fd_instructions );
+  if ( perf->fd_branch_misses >= 0 )
+    close( perf->fd_branch_misses );
+  perf->fd_instructions = perf->fd_branch_misses = -1;
+}
+
+void bench_measure( bench_cost_t *cost, bench_perf_t *perf, void ( *fn )( void *ctx ),
+                    void *ctx, size_t nops, int reps ) {
+  fn( ctx ); // warm up caches and branch predictors
+
+  double best_ns = -1, best_cycles = -1, best_instr = -1, best_misses = -1;
+  for ( int r = 0; r < reps; r++ ) {
+    uint64_t instr = UINT64_MAX, misses = UINT64_MAX;
+    if ( perf )
+      bench_perf_start( perf );
+    double start = bench_now_sec();
+    uint64_t c0 = bench_cycles();
+    fn( ctx );
+    uint64_t c1 = bench_cycles();
+    double ns = ( bench_now_sec() - start ) * 1e9 / nops;
+    if ( perf )
+      bench_perf_stop( perf, &instr, &misses );
+
+    // the counts of the fastest run are the least disturbed
+    if ( best_ns < 0 || ns < best_ns ) {
+      best_ns = ns;
+      best_cycles = c1 ? (double) ( c1 - c0 ) / nops : -1;
+      best_instr = instr != UINT64_MAX ? (double) instr / nops : -1;
+      best_misses = misses != UINT64_MAX ? (double) misses / nops : -1;
+    }
+  }
+  cost->ns = best_ns;
+  cost->cycles = best_cycles;
+  cost->instructions = best_instr;
+  cost->branch_misses = best_misses;
+}
+
+void bench_sink( uint64_t val ) {
+  static volatile uint64_t sink;
+  sink ^= val;
+}
+
+size_t bench_calibrate( void ( *fn )( void *ctx ), void *ctx, double min_trial_sec ) {
+  size_t calls = 1;
+  while ( bench_trial( fn, ctx, calls, 1 ) * calls * 1e-9 < min_trial_sec )
+    calls *= 2;
+  return calls;
+}
+
+double bench_trial( void ( *fn )( void *ctx ), void *ctx, size_t calls, size_t nops ) {
+  double start = bench_now_sec();
+  for ( size_t c = 0; c < calls; c++ )
+    fn( ctx );
+  return ( bench_now_sec() - start ) * 1e9 / ( (double) calls * nops );
+}
+
+size_t bench_reject_outliers( double *samples, size_t n ) {
+  qsort( samples, n, sizeof( double ), compare_doubles );
+  if ( n < 4 )
+    return n;
+  double q1 = quantile( samples, n, 0.25 ), q3 = quantile( samples, n, 0.75 );
+  double lo = q1 - 1.5 * ( q3 - q1 ), hi = q3 + 1.5 * ( q3 - q1 );
+  size_t kept = 0;
+  for ( size_t i = 0; i < n; i++ )
+    if ( samples[i] >= lo && samples[i] <= hi )
+      samples[kept++] = samples[i];
+  return kept;
+}
+
+double bench_median( const double *sorted, size_t n ) {
+  return n ? quantile( sorted, n, 0.5 ) : 0;
+}
+
+double bench_quantile( const double *sorted, size_t n, double q ) {
+  return n ? quantile( sorted, n, q ) : 0;
+}
+
+double bench_mann_whitney_p( const double *a, size_t na, const double *b, size_t nb ) {
+  size_t n = na + nb;
+  ranked_t *all = malloc( n * sizeof( ranked_t ) );
+  if ( !all || na == 0 || nb == 0 ) {
+    free( all );
+    return 1;
+  }
+  for ( size_t i = 0; i < na; i++ )
+    all[i] = ( ranked_t ) { a[i], 0 };
+  for ( size_t i = 0; i < nb; i++ )
+    all[na + i] = ( ranked_t ) { b[i], 1 };
+  qsort( all, n, sizeof( ranked_t ), compare_ranked );
+
+  // rank sum of b, with tied values sharing their average rank
+  double rank_sum_b = 0, tie_term = 0;
+  for ( size_t i = 0; i < n; ) {
+    size_t j = i;
+    while ( j < n && all[j].val == all[i].val )
+      j++;
+    double rank = ( i + 1 + j ) / 2.0, t = (double) ( j - i );
+    for ( size_t k = i; k < j; k++ )
+      if ( all[k].from_b )
+        rank_sum_b += rank;
+    tie_term += t * t * t - t;
+    i = j;
+  }
+  free( all );
+
+  double u = rank_sum_b - nb * ( nb + 1 ) / 2.0;
+  double mean = na * (double) nb / 2;
+  double var = na * (double) nb / 12 * ( ( n + 1 ) - tie_term / ( (double) n * ( n - 1 ) ) );
+  if ( var <= 0 )
+    return 1;
+  double z = ( u - mean - 0.5 ) / sqrt( var ); // with continuity correction
+  return 0.5 * erfc( z / sqrt( 2 ) );
+}
+
+bool bench_pin_cpu( int cpu ) {
+  cpu_set_t set;
+  CPU_ZERO( &set );
+  CPU_SET( cpu, &set );
+  return sched_setaffinity( 0, sizeof( set ), &set ) == 0;
+}
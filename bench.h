@@ -0,0 +1,120 @@
+#ifndef BENCH_H
+#define BENCH_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "fixpoint.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+////////////////////////////////////////////////////////////////////////
+// Measurement helpers shared by the benchmark drivers
+////////////////////////////////////////////////////////////////////////
+
+//! Monotonic wall clock time in seconds.
+double bench_now_sec( void );
+
+//! Time stamp counter, or 0 if the CPU doesn't have one. On x86 this
+//! counts reference cycles at a constant rate, which is close to (but
+//! not exactly) core cycles when the clock frequency changes.
+uint64_t bench_cycles( void );
+
+//! xorshift64* so the inputs are the same on every run.
+uint64_t bench_rand( uint64_t *state );
+
+//! Random values of moderate magnitude (|x| < 2^8) with random signs.
+void bench_fill_random( fixpoint_t *vals, size_t n, uint64_t *state );
+
+//! Hardware counters read with perf_event_open. Opening them fails
+//! (and the counts are reported as unavailable) on kernels or
+//! containers that don't allow user-space performance monitoring.
+typedef struct {
+  int fd_instructions;
+  int fd_branch_misses;
+} bench_perf_t;
+
+//! Open the counters (they start disabled).
+//!
+//! @return true if at least one counter could be opened
+bool bench_perf_open( bench_perf_t *perf );
+
+//! Reset and enable the counters.
+void bench_perf_start( bench_perf_t *perf );
+
+//! Disable the counters and read them. A counter that could not be
+//! opened reads as UINT64_MAX.
+void bench_perf_stop( bench_perf_t *perf, uint64_t *instructions, uint64_t *branch_misses );
+
+//! Close the counters.
+void bench_perf_close( bench_perf_t *perf );
+
+//! Per-operation costs of a measured function (negative if unavailable).
+typedef struct {
+  double ns;
+  double cycles;
+  double instructions;
+  double branch_misses;
+} bench_cost_t;
+
+//! Measure a function that performs nops operations. The function is
+//! run once to warm up, then reps times; the fastest run is reported.
+//!
+//! @param cost set to the per-operation costs
+//! @param perf counters to read, or NULL
+//! @param fn the function to measure
+//! @param ctx argument for fn
+//! @param nops number of operations fn performs per call
+//! @param reps number of timed runs
+void bench_measure( bench_cost_t *cost, bench_perf_t *perf, void ( *fn )( void *ctx ),
+                    void *ctx, size_t nops, int reps );
+
+//! Number of calls of a function needed for a trial to take at least
+//! min_trial_sec, which keeps timer resolution out of the samples.
+size_t bench_calibrate( void ( *fn )( void *ctx ), void *ctx, double min_trial_sec );
+
+//! Time one trial of calls calls of a function.
+//!
+//! @param fn the function to measure
+//! @param ctx argument for fn
+//! @param calls number of calls (see bench_calibrate)
+//! @param nops number of operations fn performs per call
+//! @return the time per operation in ns
+double bench_trial( void ( *fn )( void *ctx ), void *ctx, size_t calls, size_t nops );
+
+//! Sort samples and remove outliers outside the Tukey fences
+//! [Q1 - 1.5 IQR, Q3 + 1.5 IQR].
+//!
+//! @return the number of samples kept (at the start of the array, sorted)
+size_t bench_reject_outliers( double *samples, size_t n );
+
+//! Median of sorted samples.
+double bench_median( const double *sorted, size_t n );
+
+//! Quantile q (0 to 1) of sorted samples, interpolating between
+//! neighbors.
+double bench_quantile( const double *sorted, size_t n, double q );
+
+//! One-sided Mann-Whitney U test (normal approximation with tie
+//! correction) of the hypothesis that samples b tend to be larger than
+//! samples a. It makes no assumption about the shape of the
+//! distributions, which for timings are usually skewed.
+//!
+//! @return the p-value (small values mean b is significantly larger)
+double bench_mann_whitney_p( const double *a, size_t na, const double *b, size_t nb );
+
+//! Pin the calling thread to one CPU.
+//!
+//! @return true on success
+bool bench_pin_cpu( int cpu );
+
+//! Keep a value alive so the compiler can't remove the code computing it.
+void bench_sink( uint64_t val );
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // BENCH_H
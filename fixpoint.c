@@ -1,10 +1,17 @@
 
 
 #include "fixpoint.h"
+#include "fixpoint_inline.h"
+#include "fixpoint_probes.h"
+#include "fixpoint_profile.h"
+#include "fixpoint_stats.h"
 #include <assert.h>
 #include <ctype.h>
+#include <pthread.h>
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
+#include <unistd.h>
 
 ////////////////////////////////////////////////////////////////////////
 // Helper functions
@@ -12,141 +19,6 @@
 // if you want to be able to write unit tests for them
 ////////////////////////////////////////////////////////////////////////
 
-/**
- * Checks if a fixpoint number has zero magnitude.
- * param- x pointer to the fixpoint number.
- * return-true if whole and fraction are both zero
- */
-static inline bool is_zero_mag(const fixpoint_t *x) {
-  return x->whole == 0 && x->frac == 0;
-}
-/**
- * Compares the magnitudes of two fixpoint numbers (no sign).
- * param-
- * left pointer to left num.
- * right pointer to right num.
- * return -1 if left < right, 1 if left > right.
- */
-static int compare_magnitudes(const fixpoint_t *left, const fixpoint_t *right) {
-  if (left->whole != right->whole) {
-    return (left->whole < right->whole) ? -1 : 1;
-  } else if (left->frac != right->frac) {
-    return (left->frac < right->frac) ? -1 : 1;
-  } else {
-    return 0; // magnitudes are equal
-  }
-}
-/**
- * Adds magnitudes of two nums with the same sign.
- * @param result pointer to the output num.
- * @param left pointer to left num.
- * @param right right pointer to right num..
- * @param negative Boolean flag  if the result should be negative.
- * @return Flags mean  overflow occurred.
- */
-static result_t add_magnitudes_same_sign(fixpoint_t *result,
-                                         const fixpoint_t *left,
-                                         const fixpoint_t *right,
-                                         bool negative) {
-  uint64_t frac_sum = (uint64_t)left->frac + (uint64_t)right->frac;
-  uint64_t carry = frac_sum >> 32; // carry from fraction
-  uint64_t whole_sum = (uint64_t)left->whole + (uint64_t)right->whole + carry; // add whole and carry
-
-  result->frac = (uint32_t)(frac_sum & 0xFFFFFFFFu); // store fraction
-  result->whole = (uint32_t)(whole_sum & 0xFFFFFFFFu); // store whole
-  result->negative = negative; // preserve sign
-
-  result_t flags = RESULT_OK;
-  if (whole_sum >> 32)
-    flags |= RESULT_OVERFLOW; // overflow on 33rd bit
-
-  // Normalize 0 except negative overflow case
-  if (result->whole == 0 && result->frac == 0) {
-    if (!(negative && (flags & RESULT_OVERFLOW))) {
-      result->negative = false; // 0 is not negative
-    }
-  }
-  return flags;
-}
-
-/**
- * Subtracts magnitudes when numbers have opposite signs.
- * param-
- *  result pointer to output num.
- *  larger pointer to larger magnitude.
- *  smaller pointer to smaller magnitude.
- */
-static void subtract_magnitudes_opposite_sign(fixpoint_t *result,
-                                              const fixpoint_t *larger,
-                                              const fixpoint_t *smaller) {
-  uint64_t largerwhole = (uint64_t)larger->whole;
-  uint64_t largerfrac = (uint64_t)larger->frac;
-  uint64_t smallerwhole = (uint64_t)smaller->whole;
-  uint64_t smallerfrac = (uint64_t)smaller->frac;
-
-  uint32_t out_frac, out_whole;
-  if (largerfrac >= smallerfrac) {
-    // no borrow
-    out_frac = (uint32_t)(largerfrac - smallerfrac); // subtract fractions
-    out_whole = (uint32_t)(largerwhole - smallerwhole); // subtract wholes
-  } else { // borrow 1 whole
-    out_frac = (uint32_t)((largerfrac + (1ULL << 32)) - smallerfrac); // subtract whole after borrow
-    out_whole = (uint32_t)((largerwhole - 1) - smallerwhole);
-  }
-
-  result->whole = out_whole;
-  result->frac = out_frac;
-  result->negative = larger->negative && !is_zero_mag(larger);
- 
-  if (result->whole == 0 && result->frac == 0)  result->negative = false; // normalize zer0
-}
-/**
- * Finalizes multiplication result from partial products.
- * param-
- *  p0 product of fractional parts.
- *  p1 product of left frac * right whole.
- *  p2 product of left whole * right frac.
- *  p3 product of whole parts.
- *  out_frac pointer to resulting fraction.
- *  out_whole pointer to resulting whole part.
- *  overflow pointer to overflow.
- *  underflow pointer to underflow.
- */
-static void finalize_mul(uint64_t p0, uint64_t p1, uint64_t p2, uint64_t p3,
-                         uint32_t *out_frac, uint32_t *out_whole,
-                         bool *overflow, bool *underflow) {
-  uint32_t x0_low = (uint32_t)(p0 & 0xFFFFFFFFu); // check lost bits for underflow
-  *underflow = (x0_low != 0); // underflow if lost occurs
-
-  uint64_t x1 = (p0 >> 32) + (p1 & 0xFFFFFFFFu) + (p2 & 0xFFFFFFFFu); // partial sum for fraction
-  uint64_t x2 = (p1 >> 32) + (p2 >> 32) + p3;  // partial sum for whole
-
-  *out_frac = (uint32_t)(x1 & 0xFFFFFFFFu); // store fraction
-  uint64_t carry1 = (x1 >> 32); // carry to whole
-
-  uint64_t tmp = x2 + carry1;
-  *out_whole = (uint32_t)(tmp & 0xFFFFFFFFu);
-  *overflow = ((tmp >> 32) != 0); // overflow to bits above 32
-}
-/**
- * Normalizes zero for multiplication results.
- * param-
- * result pointer to the result.
- * underflow Boolean flag for underflow.
- * overflow Boolean flag for overflow.
- * out_sign expected sign if non-zero.
- */
-static void normalize_zero_mul(fixpoint_t *result, bool underflow,
-                               bool overflow, bool out_sign) {
-  if (result->whole == 0 && result->frac == 0) {
-    if (!(underflow || overflow)) {
-      result->negative = false; // pure zero
-    } else {
-      result->negative = out_sign; // expected sign
-    }
-  }
-}
-
 /**
  * Formats the fractional part in hexadecimal.
  * param-
@@ -253,141 +125,858 @@ static bool parse_frac(const char **p, uint32_t *frac) {
     return true;
 }
 
+/**
+ * Returns the 64 bit magnitude of a fixpoint number (whole:frac).
+ * param- x pointer to the fixpoint number.
+ * return- magnitude in units of 2^-32.
+ */
+static inline uint64_t mag_of(const fixpoint_t *x) {
+#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+  uint64_t w; // one load: whole in the low half, frac in the high half
+  memcpy(&w, x, sizeof(w));
+  return (w << 32) | (w >> 32);
+#else
+  return ((uint64_t)x->whole << 32) | x->frac;
+#endif
+}
+
+/**
+ * Stores a 64 bit magnitude into the whole and frac of a fixpoint
+ * number (the inverse of mag_of).
+ * param-
+ *  x pointer to the fixpoint number.
+ *  mag magnitude in units of 2^-32.
+ */
+static inline void set_mag(fixpoint_t *x, uint64_t mag) {
+#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+  uint64_t w = (mag << 32) | (mag >> 32);
+  memcpy(x, &w, sizeof(w));
+#else
+  x->whole = (uint32_t)(mag >> 32);
+  x->frac = (uint32_t)mag;
+#endif
+}
+
+/**
+ * Returns an all-ones mask if a fixpoint number is negative and
+ * nonzero, otherwise 0 (negative zero counts as non-negative,
+ * like in fixpoint_add and fixpoint_mul).
+ * param- x pointer to the fixpoint number.
+ */
+static inline uint64_t neg_mask_of(const fixpoint_t *x) {
+  return -(uint64_t)(x->negative & (mag_of(x) != 0)); // & so as not to branch
+}
+
+/**
+ * Returns an all-ones mask if a fixpoint number has its negative flag
+ * set, even if it is a negative zero. Cheaper than neg_mask_of, for
+ * add_kernel, which gives the same result either way.
+ * param- x pointer to the fixpoint number.
+ */
+static inline uint64_t sign_mask_of(const fixpoint_t *x) {
+  return -(uint64_t)x->negative;
+}
+
+/*
+ * Wide accumulator for sums of exact products. The 128 bit product
+ * of two magnitudes is in units of 2^-64, and summing them needs a
+ * few more bits, so the accumulator is a 192 bit two's complement
+ * value (lo holds the low 128 bits, hi the sign-extended top 64 bits).
+ */
+typedef struct {
+  unsigned __int128 lo;
+  int64_t hi;
+} wide_acc_t;
+
+/**
+ * Adds a signed exact product to a wide accumulator without branching.
+ * param-
+ *  acc pointer to the accumulator.
+ *  p magnitude of the product (units of 2^-64).
+ *  neg all-ones mask if the product is negative, 0 otherwise.
+ */
+static inline void wide_acc_add(wide_acc_t *acc, unsigned __int128 p,
+                                uint64_t neg) {
+  unsigned __int128 m = (unsigned __int128)(__int128)(int64_t)neg;
+  unsigned __int128 v = (p ^ m) - m;                // two's complement of p if neg
+  int64_t ext = (int64_t)(neg & -(uint64_t)(p != 0)); // sign extension (-0 is 0)
+  unsigned __int128 lo = acc->lo + v;
+  acc->hi += ext + (int64_t)(lo < v);                 // carry into top limb
+  acc->lo = lo;
+}
+
+/**
+ * Truncates a wide accumulator to a fixpoint number, with the same
+ * flag and zero-sign rules as fixpoint_mul.
+ * param-
+ *  result pointer to the output num.
+ *  acc pointer to the accumulator.
+ * return- RESULT_OVERFLOW and/or RESULT_UNDERFLOW flags.
+ */
+static result_t wide_acc_finish(fixpoint_t *result, const wide_acc_t *acc) {
+  bool neg = acc->hi < 0;
+  unsigned __int128 lo = acc->lo;
+  uint64_t hi = (uint64_t)acc->hi;
+  if (neg) { // take magnitude of the 192 bit value
+    lo = ~lo + 1;
+    hi = ~hi + (lo == 0);
+  }
+
+  bool overflow = hi != 0 || (uint32_t)(lo >> 96) != 0; // lost high bits
+  bool underflow = (uint32_t)lo != 0;                   // lost low bits
+
+  result->frac = (uint32_t)(lo >> 32);
+  result->whole = (uint32_t)(lo >> 64);
+  result->negative = neg;
+  fixpoint_normalize_zero_mul(result, underflow, overflow, neg);
+
+  return (overflow ? RESULT_OVERFLOW : 0) | (underflow ? RESULT_UNDERFLOW : 0);
+}
+
 ////////////////////////////////////////////////////////////////////////
-// Public API functions
+// Batch kernel helpers
 ////////////////////////////////////////////////////////////////////////
 
-void fixpoint_init(fixpoint_t *val, uint32_t whole, uint32_t frac,
-                   bool negative) {
-  // initialize each field of val with correct field vallues
+/**
+ * Branch-free equivalent of fixpoint_add on unpacked operands, in
+ * 64 bit arithmetic. Both the sum and the difference of the magnitudes
+ * are computed, and the sign masks select between them: with equal
+ * signs the sum is kept (a carry out is an overflow, and the magnitude
+ * is truncated to 64 bits), otherwise the difference, negated if the
+ * right magnitude is larger, in which case the sign is the right one.
+ * As in fixpoint_add, only an overflowed result may be a negative zero.
+ * param-
+ *  result pointer to the output num.
+ *  l_mag,l_neg magnitude and sign mask of the left operand.
+ *  r_mag,r_neg magnitude and sign mask of the right operand.
+ * return- RESULT_OK or RESULT_OVERFLOW.
+ */
+static inline result_t add_kernel(fixpoint_t *result, uint64_t l_mag,
+                                  uint64_t l_neg, uint64_t r_mag,
+                                  uint64_t r_neg) {
+  uint64_t differ = l_neg ^ r_neg;
+  uint64_t sum = l_mag + r_mag;
+  uint64_t swap = -(uint64_t)(l_mag < r_mag) & differ; // |right| is larger
+  uint64_t diff = ((l_mag - r_mag) ^ swap) - swap;
+  uint64_t mag = (sum & ~differ) | (diff & differ);
+  bool overflow = (sum < l_mag) & !differ;
+  uint64_t neg = l_neg ^ (swap & differ);
+  set_mag(result, mag);
+  result->negative = (bool)(neg & 1) & ((mag != 0) | overflow);
+  return overflow ? RESULT_OVERFLOW : RESULT_OK;
+}
 
-  val->whole = whole;
-  val->frac = frac;
-  val->negative = negative;
+/**
+ * Branch-free equivalent of fixpoint_mul on unpacked operands.
+ * param-
+ *  result pointer to the output num.
+ *  l_mag,l_neg magnitude and sign mask of the left operand.
+ *  r_mag,r_neg magnitude and sign mask of the right operand.
+ * return- RESULT_OVERFLOW and/or RESULT_UNDERFLOW flags.
+ */
+static inline result_t mul_kernel(fixpoint_t *result, uint64_t l_mag,
+                                  uint64_t l_neg, uint64_t r_mag,
+                                  uint64_t r_neg) {
+  unsigned __int128 p = (unsigned __int128)l_mag * r_mag;
+  bool overflow = (uint32_t)(p >> 96) != 0;
+  bool underflow = (uint32_t)p != 0;
+  uint64_t mag = (uint64_t)(p >> 32);
+  set_mag(result, mag);
+  result->negative = (bool)((l_neg ^ r_neg) & 1) & ((mag != 0) | overflow | underflow);
+  return (overflow ? RESULT_OVERFLOW : 0) | (underflow ? RESULT_UNDERFLOW : 0);
+}
 
-  // if whole and frac are zero it is not negative
-  if (whole == 0 && frac == 0) {
-    val->negative = false;
-  } else {
-    val->negative = negative;
-  }
+/**
+ * Checks that a rounding mode is one of the fixpoint_round_t values
+ * (the enum type doesn't prevent others).
+ * param-
+ *  mode rounding mode.
+ * return- true if mode is valid.
+ */
+static inline bool valid_round_mode(fixpoint_round_t mode) {
+  return (unsigned)mode <= FIXPOINT_ROUND_CEIL;
 }
 
-uint32_t fixpoint_get_whole(const fixpoint_t *val) {
-  // returns the field value of val after initialization
-  return (*val).whole;
+/**
+ * Maps a rounding mode to its index in the mode tables, which have
+ * ROUND_MODE_SLOTS entries. A mode that isn't a fixpoint_round_t value
+ * violates the callers' precondition and fails the assert; under
+ * NDEBUG the mask still keeps the index inside the tables.
+ * param-
+ *  mode rounding mode.
+ * return- the table index of mode.
+ */
+#define ROUND_MODE_SLOTS 8
+static inline unsigned round_mode_slot(fixpoint_round_t mode) {
+  assert(valid_round_mode(mode));
+  return (unsigned)mode & (ROUND_MODE_SLOTS - 1);
 }
 
-uint32_t fixpoint_get_frac(const fixpoint_t *val) {
-  // returns the frac value of val after initialization
-  return (*val).frac;
+/**
+ * Computes the rounding increment of a magnitude without branching.
+ * The increment for each mode is computed from the discarded 32 bits
+ * below the kept ones (half = their top bit, sticky = the rest) and
+ * the lowest kept bit, and the one for the requested mode is picked.
+ * param-
+ *  kept the kept bits of the magnitude.
+ *  discarded the 32 bits below them.
+ *  neg whether the value is negative.
+ *  mode rounding mode.
+ * return- 1 if the kept magnitude must be incremented, 0 otherwise.
+ */
+static inline uint32_t round_increment(uint64_t kept, uint32_t discarded,
+                                       bool neg, fixpoint_round_t mode) {
+  uint32_t half = discarded >> 31;
+  uint32_t sticky = (discarded & 0x7FFFFFFFu) != 0;
+  uint32_t inexact = discarded != 0;
+  uint32_t incs[ROUND_MODE_SLOTS] = {
+    [FIXPOINT_ROUND_TRUNC] = 0,
+    [FIXPOINT_ROUND_NEAREST_EVEN] = half & (sticky | (uint32_t)(kept & 1)),
+    [FIXPOINT_ROUND_NEAREST_AWAY] = half,
+    [FIXPOINT_ROUND_FLOOR] = neg & inexact,
+    [FIXPOINT_ROUND_CEIL] = (uint32_t)!neg & inexact,
+  };
+  return incs[round_mode_slot(mode)];
 }
 
-bool fixpoint_is_negative(const fixpoint_t *val) {
-  // returns neg value of val after initalizaiton, where we already checked for
-  // 0 in the whole and 0 in the fraction
-  return (*val).negative;
+/**
+ * Rounds a product according to a rounding mode, without branching
+ * (see round_increment).
+ * param-
+ *  result pointer to the output num.
+ *  l_mag,l_neg magnitude and sign mask of the left operand.
+ *  r_mag,r_neg magnitude and sign mask of the right operand.
+ *  mode rounding mode.
+ * return- RESULT_OVERFLOW and/or RESULT_UNDERFLOW flags.
+ */
+static inline result_t mul_rounded_kernel(fixpoint_t *result, uint64_t l_mag,
+                                          uint64_t l_neg, uint64_t r_mag,
+                                          uint64_t r_neg, fixpoint_round_t mode) {
+  uint32_t out_frac, out_whole, discarded;
+  bool overflow, underflow;
+  uint64_t a = l_mag & 0xFFFFFFFFu, A = l_mag >> 32;
+  uint64_t b = r_mag & 0xFFFFFFFFu, B = r_mag >> 32;
+  fixpoint_finalize_mul(a * b, a * B, A * b, A * B, &out_frac, &out_whole,
+               &overflow, &underflow, &discarded);
+
+  bool neg = (l_neg ^ r_neg) & 1;
+  uint64_t mag = ((uint64_t)out_whole << 32) | out_frac;
+  uint64_t rounded = mag + round_increment(mag, discarded, neg, mode);
+  overflow |= rounded < mag; // carry out of the top bit
+
+  result->whole = (uint32_t)(rounded >> 32);
+  result->frac = (uint32_t)rounded;
+  result->negative = neg;
+  fixpoint_normalize_zero_mul(result, underflow, overflow, neg);
+  return (overflow ? RESULT_OVERFLOW : 0) | (underflow ? RESULT_UNDERFLOW : 0);
+}
+
+/**
+ * Clamps a kernel result to the largest magnitude if it overflowed.
+ * The kernels already leave the sign of the exact result in place
+ * when they overflow, so only the magnitude is replaced (by OR-ing
+ * in an all-ones mask, without branching).
+ * param-
+ *  result pointer to the result of add_kernel or mul_kernel.
+ *  flags flags returned by the kernel.
+ * return- flags, unchanged.
+ */
+static inline result_t saturate(fixpoint_t *result, result_t flags) {
+  uint32_t mask = -(uint32_t)(flags & RESULT_OVERFLOW);
+  result->whole |= mask;
+  result->frac |= mask;
+  return flags;
+}
+
+/**
+ * add_kernel for operands with the same sign, which only need their
+ * magnitudes summed.
+ * param-
+ *  result pointer to the output num.
+ *  l_mag,r_mag magnitudes of the operands.
+ *  neg their sign.
+ * return- RESULT_OK or RESULT_OVERFLOW.
+ */
+static inline result_t add_same_sign_kernel(fixpoint_t *result, uint64_t l_mag,
+                                            uint64_t r_mag, bool neg) {
+  uint64_t mag;
+  bool overflow = __builtin_add_overflow(l_mag, r_mag, &mag);
+  set_mag(result, mag);
+  result->negative = neg & ((mag != 0) | overflow);
+  return overflow ? RESULT_OVERFLOW : RESULT_OK;
 }
 
-void fixpoint_negate(fixpoint_t *val) {
-  // if whole and frac are 0 it is not negative
-  if (val->whole == 0 && val->frac == 0) {
-    val->negative = false;
+// Elements handled by add_kernel after a pair of operands with
+// different signs, before add_sub_n looks for a same-sign run again
+#define ADD_MIXED_BLOCK 64
+
+/**
+ * Adds or subtracts arrays element by element. A run of elements whose
+ * operands have the same sign (after negating the right one for a
+ * subtraction) goes through add_same_sign_kernel, and the loop's exit
+ * branch is well predicted while runs are long. A pair with different
+ * signs starts a block of ADD_MIXED_BLOCK elements through add_kernel,
+ * so random signs cost one mispredicted branch per block rather than
+ * one per element as in fixpoint_add. Each element is read before it
+ * is written, so out may be one of the operands.
+ * param-
+ *  out pointer to the n results.
+ *  left,right pointers to the n operands.
+ *  n number of elements.
+ *  subtract true to subtract (a constant at each call site).
+ * return- the bitwise OR of the flags of all elements.
+ */
+static inline result_t add_sub_n(fixpoint_t *out, const fixpoint_t *left,
+                                 const fixpoint_t *right, size_t n,
+                                 bool subtract) {
+  result_t flags = RESULT_OK;
+  size_t i = 0;
+  while (i < n) {
+    for (; i < n && left[i].negative == (right[i].negative != subtract); i++)
+      flags |= add_same_sign_kernel(&out[i], mag_of(&left[i]), mag_of(&right[i]),
+                                    left[i].negative);
+    size_t end = n - i < ADD_MIXED_BLOCK ? n : i + ADD_MIXED_BLOCK;
+    for (; i < end; i++)
+      flags |= add_kernel(&out[i], mag_of(&left[i]), sign_mask_of(&left[i]),
+                          mag_of(&right[i]),
+                          sign_mask_of(&right[i]) ^ -(uint64_t)subtract);
   }
+  return flags;
+}
+
+// Operations supported by batch_status
+enum { BATCH_ADD, BATCH_SUB, BATCH_MUL };
 
-  // switch the negative sign
-  else {
-    val->negative = !val->negative;
+/**
+ * Runs a batch operation and records per-element flags in a status.
+ * Flags are collected into 64-bit words without branching and
+ * merged into the bitmaps once per word. Element i is recorded at
+ * index st->base + i, so the blocks are aligned to the status's
+ * words rather than to the arrays (the first one may be shorter).
+ * param-
+ *  op BATCH_ADD, BATCH_SUB or BATCH_MUL (a constant at each call site).
+ *  out, left, right, n as for the batch operations.
+ *  st pointer to the status to update.
+ * return- OR of the flags of this call.
+ */
+static inline result_t batch_status(int op, fixpoint_t *out,
+                                    const fixpoint_t *left,
+                                    const fixpoint_t *right, size_t n,
+                                    fixpoint_status_t *st) {
+  assert(n <= st->n && st->base <= st->n - n);
+  result_t flags = RESULT_OK;
+  for (size_t start = 0; start < n;) {
+    size_t pos = st->base + start, shift = pos % 64;
+    size_t len = n - start < 64 - shift ? n - start : 64 - shift;
+    uint64_t ov = 0, uf = 0;
+    for (size_t b = 0; b < len; b++) {
+      size_t i = start + b;
+      uint64_t r_neg = neg_mask_of(&right[i]);
+      result_t f;
+      if (op == BATCH_MUL)
+        f = mul_kernel(&out[i], mag_of(&left[i]), neg_mask_of(&left[i]),
+                       mag_of(&right[i]), r_neg);
+      else
+        f = add_kernel(&out[i], mag_of(&left[i]), neg_mask_of(&left[i]),
+                       mag_of(&right[i]), op == BATCH_SUB ? ~r_neg : r_neg);
+      ov |= (uint64_t)(f & RESULT_OVERFLOW) << b;
+      uf |= (uint64_t)((f & RESULT_UNDERFLOW) >> 1) << b;
+    }
+    ov <<= shift;
+    uf <<= shift;
+
+    if (st->overflow)
+      st->overflow[pos / 64] |= ov;
+    if (st->underflow)
+      st->underflow[pos / 64] |= uf;
+    uint64_t any = ov | uf;
+    if (any) {
+      size_t first = pos - shift + (size_t)__builtin_ctzll(any);
+      if (first < st->first)
+        st->first = first;
+      flags |= (ov ? RESULT_OVERFLOW : 0) | (uf ? RESULT_UNDERFLOW : 0);
+    }
+    start += len;
   }
+  st->flags |= flags;
+  return flags;
 }
 
-// stop here for milestone 1
+////////////////////////////////////////////////////////////////////////
+// Numeric conversion helpers
+////////////////////////////////////////////////////////////////////////
 
-result_t fixpoint_add(fixpoint_t *result, const fixpoint_t *left,
-                      const fixpoint_t *right) {
-  // Normalize signs
-  bool lneg = left->negative && !is_zero_mag(left);
-  bool rneg = right->negative && !is_zero_mag(right);
-
-  if (lneg == rneg) {
-    // Same sign: add magnitudes
-    return add_magnitudes_same_sign(result, left, right, lneg);
-  } else {
-    // Opposite signs: subtract magnitudes
-    int cmp = compare_magnitudes(left, right);
-
-    if (cmp == 0) {
-      // x + (−x) = 0
-      result->whole = 0;
-      result->frac = 0;
-      result->negative = false;
-      return RESULT_OK;
+/**
+ * Converts a value already scaled by 2^32 to a fixpoint number,
+ * rounding to an integer as specified by the mode, without branching.
+ * The magnitude is split into its integer part t (exact, since the
+ * conversion to uint64_t truncates) and the remainder r in [0, 1),
+ * and the increment is decided from r like round_increment does from
+ * the discarded bits.
+ * param-
+ *  result pointer to the output num.
+ *  y the value times 2^32.
+ *  mode rounding mode.
+ * return- RESULT_OVERFLOW and/or RESULT_UNDERFLOW flags.
+ */
+static inline result_t from_scaled_kernel(fixpoint_t *result, double y,
+                                          fixpoint_round_t mode) {
+  bool nan = y != y;
+  bool neg = y < 0;
+  double a = neg ? -y : y;
+  bool in_range = a < 0x1p64; // false for NaN
+  uint64_t t = (uint64_t)(in_range ? a : 0);
+  double r = in_range ? a - (double)t : 0; // exact
+  uint32_t half = r >= 0.5;
+  uint32_t sticky = r != 0 && r != 0.5;
+  uint32_t inexact = r != 0;
+  uint32_t incs[ROUND_MODE_SLOTS] = {
+    [FIXPOINT_ROUND_TRUNC] = 0,
+    [FIXPOINT_ROUND_NEAREST_EVEN] = half & (sticky | (uint32_t)(t & 1)),
+    [FIXPOINT_ROUND_NEAREST_AWAY] = half,
+    [FIXPOINT_ROUND_FLOOR] = neg & inexact,
+    [FIXPOINT_ROUND_CEIL] = (uint32_t)!neg & inexact,
+  };
+
+  uint64_t mag = t + incs[round_mode_slot(mode)];
+  bool overflow = !in_range || mag < t; // carry out of the top bit
+  // saturate, except NaN, which becomes zero
+  mag |= -(uint64_t)(overflow & !nan);
+  result->whole = (uint32_t)(mag >> 32);
+  result->frac = (uint32_t)mag;
+  result->negative = neg;
+  fixpoint_normalize_zero_mul(result, inexact, overflow, neg);
+  return (overflow ? RESULT_OVERFLOW : 0) | (inexact ? RESULT_UNDERFLOW : 0);
+}
+
+/**
+ * Rounds a fixpoint number to an integer as specified by the mode.
+ * param-
+ *  val pointer to the number.
+ *  mode rounding mode.
+ *  inexact set to whether the number had a fraction.
+ * return- the rounded value (its magnitude is at most 2^32).
+ */
+static inline int64_t to_integer(const fixpoint_t *val, fixpoint_round_t mode,
+                                 bool *inexact) {
+  bool neg = val->negative;
+  uint64_t mag = (uint64_t)val->whole + round_increment(val->whole, val->frac, neg, mode);
+  *inexact = val->frac != 0;
+  return neg ? -(int64_t)mag : (int64_t)mag;
+}
+
+////////////////////////////////////////////////////////////////////////
+// Matrix multiplication helpers
+////////////////////////////////////////////////////////////////////////
+
+// Register tile (GEMM_MR x GEMM_NR accumulators live in registers),
+// depth of a cache block, and size of the output tile handed to a thread.
+#define GEMM_MR 2
+#define GEMM_NR 2
+#define GEMM_KC 256
+#define GEMM_MC 32
+#define GEMM_NC 64
+
+// Operand element unpacked into magnitude and sign mask
+typedef struct {
+  uint64_t mag;
+  uint64_t neg;
+} packed_t;
+
+// Shared state for the gemm worker threads
+typedef struct {
+  fixpoint_t *c;
+  const packed_t *ap; // A packed in panels of GEMM_MR rows
+  const packed_t *bp; // B packed in panels of GEMM_NR columns
+  size_t m, n, k;
+  size_t tiles_m, tiles_n;
+  size_t next_tile;   // next unclaimed output tile (atomic)
+  result_t flags;     // OR of all flags (atomic)
+} gemm_job_t;
+
+/**
+ * Packs a row-major matrix into panels of `width` rows (or columns)
+ * so the microkernel reads both operands sequentially. Partial panels
+ * are padded with zeros, which contribute nothing to the sums.
+ * param-
+ *  dst packed output, ceil(outer/width) * inner * width elements.
+ *  src source matrix.
+ *  outer number of rows (A) or columns (B) being split into panels.
+ *  inner shared dimension k.
+ *  width panel width.
+ *  outer_stride,inner_stride element strides of src along outer and inner.
+ */
+static void gemm_pack(packed_t *dst, const fixpoint_t *src, size_t outer,
+                      size_t inner, size_t width, size_t outer_stride,
+                      size_t inner_stride) {
+  for (size_t o0 = 0; o0 < outer; o0 += width) {
+    for (size_t p = 0; p < inner; p++) {
+      for (size_t w = 0; w < width; w++, dst++) {
+        if (o0 + w < outer) {
+          const fixpoint_t *x = &src[(o0 + w) * outer_stride + p * inner_stride];
+          dst->mag = mag_of(x);
+          dst->neg = neg_mask_of(x);
+        } else {
+          dst->mag = 0;
+          dst->neg = 0;
+        }
+      }
     }
+  }
+}
+
+/**
+ * Computes one GEMM_MC x GEMM_NC output tile, walking k in cache
+ * blocks of GEMM_KC and keeping GEMM_MR x GEMM_NR accumulators in
+ * registers inside each block.
+ * param-
+ *  job shared job description.
+ *  ti,tj tile row/column index.
+ * return- OR of the flags of the tile's elements.
+ */
+static result_t gemm_tile(const gemm_job_t *job, size_t ti, size_t tj) {
+  wide_acc_t acc[GEMM_MC][GEMM_NC];
+  size_t i0 = ti * GEMM_MC, j0 = tj * GEMM_NC;
+  size_t i1 = i0 + GEMM_MC < job->m ? i0 + GEMM_MC : job->m;
+  size_t j1 = j0 + GEMM_NC < job->n ? j0 + GEMM_NC : job->n;
+  size_t k = job->k;
+
+  memset(acc, 0, sizeof(acc));
+
+  for (size_t p0 = 0; p0 < k; p0 += GEMM_KC) {
+    size_t p1 = p0 + GEMM_KC < k ? p0 + GEMM_KC : k;
+    for (size_t i = i0; i < i1; i += GEMM_MR) {
+      const packed_t *ap = job->ap + (i / GEMM_MR) * k * GEMM_MR;
+      for (size_t j = j0; j < j1; j += GEMM_NR) {
+        const packed_t *bp = job->bp + (j / GEMM_NR) * k * GEMM_NR;
+        wide_acc_t r[GEMM_MR][GEMM_NR];
+        for (int x = 0; x < GEMM_MR; x++)
+          for (int y = 0; y < GEMM_NR; y++)
+            r[x][y] = acc[i - i0 + x][j - j0 + y];
 
-    const fixpoint_t *larger = (cmp > 0) ? left : right;
-    const fixpoint_t *smaller = (cmp > 0) ? right : left;
+        for (size_t p = p0; p < p1; p++) {
+          const packed_t *av = ap + p * GEMM_MR;
+          const packed_t *bv = bp + p * GEMM_NR;
+          for (int x = 0; x < GEMM_MR; x++)
+            for (int y = 0; y < GEMM_NR; y++)
+              wide_acc_add(&r[x][y],
+                           (unsigned __int128)av[x].mag * bv[y].mag,
+                           av[x].neg ^ bv[y].neg);
+        }
 
-    subtract_magnitudes_opposite_sign(result, larger, smaller);
-    return RESULT_OK; // no overflow for opposite signs
+        for (int x = 0; x < GEMM_MR; x++)
+          for (int y = 0; y < GEMM_NR; y++)
+            acc[i - i0 + x][j - j0 + y] = r[x][y];
+      }
+    }
   }
+
+  result_t flags = RESULT_OK;
+  for (size_t i = i0; i < i1; i++)
+    for (size_t j = j0; j < j1; j++)
+      flags |= wide_acc_finish(&job->c[i * job->n + j], &acc[i - i0][j - j0]);
+  return flags;
 }
 
-result_t fixpoint_sub(fixpoint_t *result, const fixpoint_t *left,
-                      const fixpoint_t *right) {
-  // invert second operand
-  fixpoint_t negRight = *right;                 // copy
-  fixpoint_negate(&negRight);                   // negate right
-  return fixpoint_add(result, left, &negRight); // call add lft + -right
+/**
+ * Worker thread: claims output tiles until none are left.
+ * param- arg pointer to the shared gemm_job_t.
+ */
+static void *gemm_worker(void *arg) {
+  gemm_job_t *job = arg;
+  size_t ntiles = job->tiles_m * job->tiles_n;
+  result_t flags = RESULT_OK;
+  size_t t;
+  while ((t = __atomic_fetch_add(&job->next_tile, 1, __ATOMIC_RELAXED)) < ntiles)
+    flags |= gemm_tile(job, t / job->tiles_n, t % job->tiles_n);
+  __atomic_fetch_or(&job->flags, flags, __ATOMIC_RELAXED);
+  return NULL;
 }
 
-result_t fixpoint_mul(fixpoint_t *result, const fixpoint_t *left,
-                      const fixpoint_t *right) {
-  // Determine output sign
-  bool left_neg = left->negative && !is_zero_mag(left);
-  bool right_neg = right->negative && !is_zero_mag(right);
-  bool out_sign = (left_neg ^ right_neg);
-
-  // Split magnitudes
-  uint64_t A = left->whole;
-  uint64_t a = left->frac;
-  uint64_t B = right->whole;
-  uint64_t b = right->frac;
-
-  // Compute partial products
-  uint64_t p0 = a * b;
-  uint64_t p1 = a * B;
-  uint64_t p2 = A * b;
-  uint64_t p3 = A * B;
-
-  // Finalize fraction, whole, and flags
-  uint32_t out_frac, out_whole;
-  bool overflow, underflow;
-  finalize_mul(p0, p1, p2, p3, &out_frac, &out_whole, &overflow, &underflow);
+/**
+ * Unpacked fallback used if the packing buffers cannot be allocated.
+ * Same results as the tiled kernel, just slower.
+ */
+static result_t gemm_unpacked(fixpoint_t *c, const fixpoint_t *a,
+                              const fixpoint_t *b, size_t m, size_t n,
+                              size_t k) {
+  result_t flags = RESULT_OK;
+  for (size_t i = 0; i < m; i++) {
+    for (size_t j = 0; j < n; j++) {
+      wide_acc_t acc = { 0, 0 };
+      for (size_t p = 0; p < k; p++) {
+        const fixpoint_t *x = &a[i * k + p], *y = &b[p * n + j];
+        wide_acc_add(&acc, (unsigned __int128)mag_of(x) * mag_of(y),
+                     neg_mask_of(x) ^ neg_mask_of(y));
+      }
+      flags |= wide_acc_finish(&c[i * n + j], &acc);
+    }
+  }
+  return flags;
+}
 
-  result->frac = out_frac;
-  result->whole = out_whole;
-  result->negative = out_sign;
+////////////////////////////////////////////////////////////////////////
+// FIR filter helpers
+////////////////////////////////////////////////////////////////////////
 
-  normalize_zero_mul(result, underflow, overflow, out_sign);
+// Input samples handled per pass, and output samples computed together
+// (each tap is loaded once per group of FIR_LANES outputs)
+#define FIR_BLOCK 256
+#define FIR_LANES 4
 
+/**
+ * Computes n output samples from a window of packed inputs.
+ * Output i uses window[i .. i + ntaps - 1] and the reversed taps.
+ * param-
+ *  out pointer to the output samples.
+ *  win pointer to n + ntaps - 1 packed input samples.
+ *  taps pointer to the packed taps, in reverse order.
+ *  ntaps number of taps.
+ *  n number of outputs.
+ * return- OR of the flags of the outputs.
+ */
+static result_t fir_block(fixpoint_t *out, const packed_t *win,
+                          const packed_t *taps, size_t ntaps, size_t n) {
   result_t flags = RESULT_OK;
-  if (overflow)
-    flags = flags + RESULT_OVERFLOW;
-  if (underflow)
-    flags = flags + RESULT_UNDERFLOW;
+  size_t i = 0;
 
+  for (; i + FIR_LANES <= n; i += FIR_LANES) {
+    wide_acc_t acc[FIR_LANES] = { { 0, 0 } };
+    for (size_t t = 0; t < ntaps; t++) {
+      const packed_t h = taps[t];
+      const packed_t *x = &win[i + t];
+      for (int l = 0; l < FIR_LANES; l++)
+        wide_acc_add(&acc[l], (unsigned __int128)h.mag * x[l].mag,
+                     h.neg ^ x[l].neg);
+    }
+    for (int l = 0; l < FIR_LANES; l++)
+      flags |= wide_acc_finish(&out[i + l], &acc[l]);
+  }
+
+  for (; i < n; i++) { // leftover outputs
+    wide_acc_t acc = { 0, 0 };
+    for (size_t t = 0; t < ntaps; t++)
+      wide_acc_add(&acc, (unsigned __int128)taps[t].mag * win[i + t].mag,
+                   taps[t].neg ^ win[i + t].neg);
+    flags |= wide_acc_finish(&out[i], &acc);
+  }
   return flags;
 }
-int fixpoint_compare(const fixpoint_t *left, const fixpoint_t *right) {
 
-  if (left->whole != right->whole) { // not equal then comapre
-    return (left->whole < right->whole) ? -1 : 1;
-  } // if whole is equal check frac
-  return (left->frac < right->frac)   ? -1
-         : (left->frac > right->frac) ? 1
-                                      : 0; // 0 when both are false
+////////////////////////////////////////////////////////////////////////
+// Polynomial evaluation helpers
+////////////////////////////////////////////////////////////////////////
+
+// Points evaluated together by fixpoint_poly_eval_n
+#define POLY_LANES 4
+
+/**
+ * Converts a fixpoint magnitude and sign mask to a signed Q63.64 value.
+ * param-
+ *  mag magnitude (units of 2^-32).
+ *  neg all-ones mask if negative, 0 otherwise.
+ * return- the value in units of 2^-64.
+ */
+static inline __int128 q64_of(uint64_t mag, uint64_t neg) {
+  unsigned __int128 m = (unsigned __int128)(__int128)(int64_t)neg;
+  return (__int128)((((unsigned __int128)mag << 32) ^ m) - m);
+}
+
+/**
+ * Computes one Horner step acc * x + c in Q63.64 (acc and the result
+ * are in units of 2^-64, x and c are fixpoint magnitudes/signs).
+ * param-
+ *  acc intermediate value.
+ *  x_mag,x_neg magnitude and sign mask of the point.
+ *  c_mag,c_neg magnitude and sign mask of the coefficient.
+ *  flags pointer to flags to update.
+ * return- new intermediate value (wrapped if it overflowed).
+ */
+static inline __int128 poly_step(__int128 acc, uint64_t x_mag, uint64_t x_neg,
+                                 uint64_t c_mag, uint64_t c_neg,
+                                 result_t *flags) {
+  unsigned __int128 a_neg = (unsigned __int128)(acc >> 127); // all ones if negative
+  unsigned __int128 a = ((unsigned __int128)acc ^ a_neg) - a_neg; // |acc|
+
+  // |acc| * x is 192 bits in units of 2^-96; keep bits 32..159
+  unsigned __int128 lo = (unsigned __int128)(uint64_t)a * x_mag;
+  unsigned __int128 hi = (unsigned __int128)(uint64_t)(a >> 64) * x_mag;
+  unsigned __int128 p = (lo >> 32) + (hi << 32);
+  bool overflow = (hi >> 96) != 0 || p < (hi << 32) || (p >> 127) != 0;
+  bool inexact = (uint32_t)lo != 0;
+
+  unsigned __int128 s = a_neg ^ (unsigned __int128)(__int128)(int64_t)x_neg;
+  __int128 prod = (__int128)((p ^ s) - s);
+
+  __int128 r;
+  overflow |= __builtin_add_overflow(prod, q64_of(c_mag, c_neg), &r);
+
+  *flags |= (overflow ? RESULT_OVERFLOW : 0) | (inexact ? RESULT_UNDERFLOW : 0);
+  return r;
+}
+
+/**
+ * Truncates a Q63.64 intermediate value to a fixpoint number.
+ * param-
+ *  result pointer to the output num.
+ *  acc intermediate value.
+ *  flags flags collected while computing acc.
+ * return- flags including the final truncation.
+ */
+static result_t poly_finish(fixpoint_t *result, __int128 acc, result_t flags) {
+  bool neg = acc < 0;
+  unsigned __int128 a = neg ? -(unsigned __int128)acc : (unsigned __int128)acc;
+  if ((a >> 96) != 0)
+    flags |= RESULT_OVERFLOW;
+  if ((uint32_t)a != 0)
+    flags |= RESULT_UNDERFLOW;
+
+  result->frac = (uint32_t)(a >> 32);
+  result->whole = (uint32_t)(a >> 64);
+  result->negative = neg;
+  fixpoint_normalize_zero_mul(result, flags & RESULT_UNDERFLOW, flags & RESULT_OVERFLOW, neg);
+  return flags;
+}
+
+////////////////////////////////////////////////////////////////////////
+// Batch text conversion helpers
+////////////////////////////////////////////////////////////////////////
+
+static const char hex_chars[16] = "0123456789abcdef";
+
+// Value of each character as a hex digit, or -1
+static const int8_t hex_values[256] = {
+  [0 ... 255] = -1,
+  ['0'] = 0, ['1'] = 1, ['2'] = 2, ['3'] = 3, ['4'] = 4,
+  ['5'] = 5, ['6'] = 6, ['7'] = 7, ['8'] = 8, ['9'] = 9,
+  ['a'] = 10, ['b'] = 11, ['c'] = 12, ['d'] = 13, ['e'] = 14, ['f'] = 15,
+  ['A'] = 10, ['B'] = 11, ['C'] = 12, ['D'] = 13, ['E'] = 14, ['F'] = 15,
+};
+
+/**
+ * Formats one value like fixpoint_format_hex, without snprintf: the
+ * number of whole digits comes from the leading zero count, and the
+ * number of fraction digits from the trailing zero count.
+ * param-
+ *  p where to write the (up to FIXPOINT_HEX_MAX_LEN) characters.
+ *  val pointer to the value.
+ * return- number of characters written (no NUL is written).
+ */
+static inline size_t format_hex_fast(char *p, const fixpoint_t *val) {
+  char *start = p;
+  if (val->negative)
+    *p++ = '-';
+
+  uint32_t w = val->whole;
+  int nwhole = w ? (35 - __builtin_clz(w)) / 4 : 1;
+  for (int d = nwhole - 1; d >= 0; d--)
+    *p++ = hex_chars[(w >> (4 * d)) & 0xF];
+
+  *p++ = '.';
+  uint32_t f = val->frac;
+  int nfrac = f ? 8 - __builtin_ctz(f) / 4 : 1;
+  for (int d = 0; d < nfrac; d++)
+    *p++ = hex_chars[(f >> (28 - 4 * d)) & 0xF];
+  return (size_t)(p - start);
+}
+
+/**
+ * Parses one token with the same rules as fixpoint_parse_hex.
+ * param-
+ *  val pointer to store the value.
+ *  p start of the token.
+ *  end end of the token.
+ * return- true if the token is valid.
+ */
+static inline bool parse_hex_token(fixpoint_t *val, const char *p,
+                                   const char *end) {
+  bool neg = p < end && *p == '-';
+  p += neg;
+
+  uint32_t whole = 0;
+  int ndigits = 0;
+  for (; p < end && hex_values[(unsigned char)*p] >= 0; p++) {
+    if (++ndigits > 8)
+      return false;
+    whole = (whole << 4) | (uint32_t)hex_values[(unsigned char)*p];
+  }
+  if (ndigits == 0 || p == end || *p != '.')
+    return false;
+  p++;
+
+  uint32_t frac = 0;
+  for (ndigits = 0; p < end && hex_values[(unsigned char)*p] >= 0; p++) {
+    if (++ndigits > 8)
+      return false;
+    frac |= (uint32_t)hex_values[(unsigned char)*p] << (32 - 4 * ndigits);
+  }
+  if (ndigits == 0 || p != end)
+    return false;
+
+  fixpoint_init(val, whole, frac, neg);
+  return true;
+}
+
+////////////////////////////////////////////////////////////////////////
+// Public API functions
+////////////////////////////////////////////////////////////////////////
+
+void fixpoint_init(fixpoint_t *val, uint32_t whole, uint32_t frac,
+                   bool negative) {
+  fixpoint_init_inline(val, whole, frac, negative);
+}
+
+uint32_t fixpoint_get_whole(const fixpoint_t *val) {
+  return fixpoint_get_whole_inline(val);
+}
+
+uint32_t fixpoint_get_frac(const fixpoint_t *val) {
+  return fixpoint_get_frac_inline(val);
+}
+
+bool fixpoint_is_negative(const fixpoint_t *val) {
+  return fixpoint_is_negative_inline(val);
+}
+
+void fixpoint_negate(fixpoint_t *val) { fixpoint_negate_inline(val); }
+
+// stop here for milestone 1
+
+result_t fixpoint_add(fixpoint_t *result, const fixpoint_t *left,
+                      const fixpoint_t *right) {
+  FIXPOINT_PROBE_SAVE(left, right);
+  result_t flags = fixpoint_add_inline(result, left, right);
+  FIXPOINT_STATS_RECORD(FIXPOINT_STATS_ADD, flags, false);
+  if (flags)
+    FIXPOINT_PROBE_FLAGS(add, left, right, flags);
+  return flags;
+}
+
+result_t fixpoint_sub(fixpoint_t *result, const fixpoint_t *left,
+                      const fixpoint_t *right) {
+  FIXPOINT_PROBE_SAVE(left, right);
+  result_t flags = fixpoint_sub_inline(result, left, right);
+  FIXPOINT_STATS_RECORD(FIXPOINT_STATS_SUB, flags, false);
+  if (flags)
+    FIXPOINT_PROBE_FLAGS(sub, left, right, flags);
+  return flags;
+}
+
+result_t fixpoint_mul(fixpoint_t *result, const fixpoint_t *left,
+                      const fixpoint_t *right) {
+  FIXPOINT_PROBE_SAVE(left, right);
+  result_t flags = fixpoint_mul_inline(result, left, right);
+  FIXPOINT_STATS_RECORD(FIXPOINT_STATS_MUL, flags, false);
+  if (flags)
+    FIXPOINT_PROBE_FLAGS(mul, left, right, flags);
+  return flags;
+}
+
+int fixpoint_compare(const fixpoint_t *left, const fixpoint_t *right) {
+  return fixpoint_compare_inline(left, right);
 }
 void fixpoint_format_hex(fixpoint_str_t *s, const fixpoint_t *val) {
+  FIXPOINT_PROFILE_BEGIN(FIXPOINT_PROFILE_FORMAT_HEX);
   char buffer[FIXPOINT_STR_MAX_SIZE]; // buffer
   int hexString = 0;
 
@@ -401,9 +990,17 @@ void fixpoint_format_hex(fixpoint_str_t *s, const fixpoint_t *val) {
       formatFracHex(buffer + hexString, sizeof(buffer) - hexString, val->frac);
   // copy full hexidecimal into stuct
   snprintf(s->str, FIXPOINT_STR_MAX_SIZE, "%s", buffer);
+  FIXPOINT_PROFILE_END(FIXPOINT_PROFILE_FORMAT_HEX);
 }
 
-bool fixpoint_parse_hex(fixpoint_t *val, const fixpoint_str_t *s) {
+/**
+ * Parses a base-16 string (fixpoint_parse_hex without the counting).
+ * param-
+ * val pointer to the value to set.
+ * s pointer to the string.
+ * return- true if the string was valid.
+ */
+static bool parse_hex_str(fixpoint_t *val, const fixpoint_str_t *s) {
 
 if (!s || s->str[0] == '\0') return false;
 
@@ -433,3 +1030,467 @@ if (!s || s->str[0] == '\0') return false;
 
     return true;
 }
+
+bool fixpoint_parse_hex(fixpoint_t *val, const fixpoint_str_t *s) {
+  FIXPOINT_PROFILE_BEGIN(FIXPOINT_PROFILE_PARSE_HEX);
+  bool ok = parse_hex_str(val, s);
+  FIXPOINT_PROFILE_END(FIXPOINT_PROFILE_PARSE_HEX);
+  FIXPOINT_STATS_RECORD(FIXPOINT_STATS_PARSE_HEX, RESULT_OK, !ok);
+  if (!ok)
+    FIXPOINT_PROBE_PARSE_HEX_FAIL(s ? s->str : NULL);
+  return ok;
+}
+
+result_t fixpoint_add_n(fixpoint_t *out, const fixpoint_t *left,
+                        const fixpoint_t *right, size_t n) {
+  result_t flags = add_sub_n(out, left, right, n, false);
+  FIXPOINT_STATS_RECORD(FIXPOINT_STATS_ADD_N, flags, false);
+  return flags;
+}
+
+result_t fixpoint_sub_n(fixpoint_t *out, const fixpoint_t *left,
+                        const fixpoint_t *right, size_t n) {
+  result_t flags = add_sub_n(out, left, right, n, true);
+  FIXPOINT_STATS_RECORD(FIXPOINT_STATS_SUB_N, flags, false);
+  return flags;
+}
+
+result_t fixpoint_mul_n(fixpoint_t *out, const fixpoint_t *left,
+                        const fixpoint_t *right, size_t n) {
+  result_t flags = RESULT_OK;
+  for (size_t i = 0; i < n; i++)
+    flags |= mul_kernel(&out[i], mag_of(&left[i]), neg_mask_of(&left[i]),
+                        mag_of(&right[i]), neg_mask_of(&right[i]));
+  FIXPOINT_STATS_RECORD(FIXPOINT_STATS_MUL_N, flags, false);
+  return flags;
+}
+
+void fixpoint_negate_n(fixpoint_t *out, const fixpoint_t *in, size_t n) {
+  for (size_t i = 0; i < n; i++) {
+    out[i].whole = in[i].whole;
+    out[i].frac = in[i].frac;
+    out[i].negative = !in[i].negative & !fixpoint_is_zero_mag(&in[i]);
+  }
+}
+
+result_t fixpoint_add_sat(fixpoint_t *result, const fixpoint_t *left,
+                          const fixpoint_t *right) {
+  result_t flags =
+      saturate(result, add_kernel(result, mag_of(left), neg_mask_of(left),
+                                  mag_of(right), neg_mask_of(right)));
+  FIXPOINT_STATS_RECORD(FIXPOINT_STATS_ADD_SAT, flags, false);
+  return flags;
+}
+
+result_t fixpoint_sub_sat(fixpoint_t *result, const fixpoint_t *left,
+                          const fixpoint_t *right) {
+  result_t flags =
+      saturate(result, add_kernel(result, mag_of(left), neg_mask_of(left),
+                                  mag_of(right), ~neg_mask_of(right)));
+  FIXPOINT_STATS_RECORD(FIXPOINT_STATS_SUB_SAT, flags, false);
+  return flags;
+}
+
+result_t fixpoint_mul_sat(fixpoint_t *result, const fixpoint_t *left,
+                          const fixpoint_t *right) {
+  result_t flags =
+      saturate(result, mul_kernel(result, mag_of(left), neg_mask_of(left),
+                                  mag_of(right), neg_mask_of(right)));
+  FIXPOINT_STATS_RECORD(FIXPOINT_STATS_MUL_SAT, flags, false);
+  return flags;
+}
+
+result_t fixpoint_add_sat_n(fixpoint_t *out, const fixpoint_t *left,
+                            const fixpoint_t *right, size_t n) {
+  result_t flags = RESULT_OK;
+  for (size_t i = 0; i < n; i++)
+    flags |= saturate(&out[i],
+                      add_kernel(&out[i], mag_of(&left[i]), neg_mask_of(&left[i]),
+                                 mag_of(&right[i]), neg_mask_of(&right[i])));
+  FIXPOINT_STATS_RECORD(FIXPOINT_STATS_ADD_SAT_N, flags, false);
+  return flags;
+}
+
+result_t fixpoint_sub_sat_n(fixpoint_t *out, const fixpoint_t *left,
+                            const fixpoint_t *right, size_t n) {
+  result_t flags = RESULT_OK;
+  for (size_t i = 0; i < n; i++)
+    flags |= saturate(&out[i],
+                      add_kernel(&out[i], mag_of(&left[i]), neg_mask_of(&left[i]),
+                                 mag_of(&right[i]), ~neg_mask_of(&right[i])));
+  FIXPOINT_STATS_RECORD(FIXPOINT_STATS_SUB_SAT_N, flags, false);
+  return flags;
+}
+
+result_t fixpoint_mul_sat_n(fixpoint_t *out, const fixpoint_t *left,
+                            const fixpoint_t *right, size_t n) {
+  result_t flags = RESULT_OK;
+  for (size_t i = 0; i < n; i++)
+    flags |= saturate(&out[i],
+                      mul_kernel(&out[i], mag_of(&left[i]), neg_mask_of(&left[i]),
+                                 mag_of(&right[i]), neg_mask_of(&right[i])));
+  FIXPOINT_STATS_RECORD(FIXPOINT_STATS_MUL_SAT_N, flags, false);
+  return flags;
+}
+
+result_t fixpoint_mul_rounded(fixpoint_t *result, const fixpoint_t *left,
+                              const fixpoint_t *right, fixpoint_round_t mode) {
+  result_t flags = mul_rounded_kernel(result, mag_of(left), neg_mask_of(left),
+                                      mag_of(right), neg_mask_of(right), mode);
+  FIXPOINT_STATS_RECORD(FIXPOINT_STATS_MUL_ROUNDED, flags, false);
+  return flags;
+}
+
+result_t fixpoint_mul_rounded_n(fixpoint_t *out, const fixpoint_t *left,
+                                const fixpoint_t *right, size_t n,
+                                fixpoint_round_t mode) {
+  assert(valid_round_mode(mode));
+  result_t flags = RESULT_OK;
+  for (size_t i = 0; i < n; i++)
+    flags |= mul_rounded_kernel(&out[i], mag_of(&left[i]), neg_mask_of(&left[i]),
+                                mag_of(&right[i]), neg_mask_of(&right[i]), mode);
+  FIXPOINT_STATS_RECORD(FIXPOINT_STATS_MUL_ROUNDED_N, flags, false);
+  return flags;
+}
+
+void fixpoint_status_init(fixpoint_status_t *st, uint64_t *overflow,
+                          uint64_t *underflow, size_t n) {
+  st->overflow = overflow;
+  st->underflow = underflow;
+  st->n = n;
+  st->base = 0;
+  st->first = FIXPOINT_STATUS_NONE;
+  st->flags = RESULT_OK;
+  if (overflow)
+    memset(overflow, 0, FIXPOINT_STATUS_WORDS(n) * sizeof(uint64_t));
+  if (underflow)
+    memset(underflow, 0, FIXPOINT_STATUS_WORDS(n) * sizeof(uint64_t));
+}
+
+result_t fixpoint_status_get(const fixpoint_status_t *st, size_t i) {
+  result_t flags = RESULT_OK;
+  if (st->overflow && ((st->overflow[i / 64] >> (i % 64)) & 1))
+    flags |= RESULT_OVERFLOW;
+  if (st->underflow && ((st->underflow[i / 64] >> (i % 64)) & 1))
+    flags |= RESULT_UNDERFLOW;
+  return flags;
+}
+
+result_t fixpoint_add_n_status(fixpoint_t *out, const fixpoint_t *left,
+                               const fixpoint_t *right, size_t n,
+                               fixpoint_status_t *st) {
+  return batch_status(BATCH_ADD, out, left, right, n, st);
+}
+
+result_t fixpoint_sub_n_status(fixpoint_t *out, const fixpoint_t *left,
+                               const fixpoint_t *right, size_t n,
+                               fixpoint_status_t *st) {
+  return batch_status(BATCH_SUB, out, left, right, n, st);
+}
+
+result_t fixpoint_mul_n_status(fixpoint_t *out, const fixpoint_t *left,
+                               const fixpoint_t *right, size_t n,
+                               fixpoint_status_t *st) {
+  return batch_status(BATCH_MUL, out, left, right, n, st);
+}
+
+result_t fixpoint_gemm(fixpoint_t *c, const fixpoint_t *a, const fixpoint_t *b,
+                       size_t m, size_t n, size_t k, unsigned nthreads) {
+  if (m == 0 || n == 0)
+    return RESULT_OK;
+
+  size_t mp = (m + GEMM_MR - 1) / GEMM_MR * GEMM_MR; // padded sizes
+  size_t np = (n + GEMM_NR - 1) / GEMM_NR * GEMM_NR;
+  packed_t *ap = malloc(mp * k * sizeof(packed_t) + 1);
+  packed_t *bp = malloc(np * k * sizeof(packed_t) + 1);
+  if (!ap || !bp) {
+    free(ap);
+    free(bp);
+    return gemm_unpacked(c, a, b, m, n, k);
+  }
+  gemm_pack(ap, a, m, k, GEMM_MR, k, 1); // rows of A
+  gemm_pack(bp, b, n, k, GEMM_NR, 1, n); // columns of B
+
+  gemm_job_t job = { c, ap, bp, m, n, k,
+                     (m + GEMM_MC - 1) / GEMM_MC, (n + GEMM_NC - 1) / GEMM_NC,
+                     0, RESULT_OK };
+
+  // one thread per tile at most; the calling thread is one of the workers
+  size_t ntiles = job.tiles_m * job.tiles_n;
+  if (nthreads == 0) {
+    long ncpu = sysconf(_SC_NPROCESSORS_ONLN);
+    nthreads = ncpu > 0 ? (unsigned)ncpu : 1;
+  }
+  if (nthreads > ntiles)
+    nthreads = (unsigned)ntiles;
+
+  pthread_t *threads = NULL;
+  unsigned started = 0;
+  if (nthreads > 1 && (threads = malloc((nthreads - 1) * sizeof(pthread_t)))) {
+    while (started < nthreads - 1 &&
+           pthread_create(&threads[started], NULL, gemm_worker, &job) == 0)
+      started++; // if creation fails, the remaining workers do more tiles
+  }
+  gemm_worker(&job);
+  for (unsigned t = 0; t < started; t++)
+    pthread_join(threads[t], NULL);
+
+  free(threads);
+  free(ap);
+  free(bp);
+  return job.flags;
+}
+
+bool fixpoint_fir_init(fixpoint_fir_t *fir, const fixpoint_t *taps,
+                       size_t ntaps) {
+  if (ntaps == 0)
+    return false;
+
+  packed_t *t = malloc(ntaps * sizeof(packed_t));
+  packed_t *w = malloc((ntaps - 1 + FIR_BLOCK) * sizeof(packed_t));
+  if (!t || !w) {
+    free(t);
+    free(w);
+    return false;
+  }
+  for (size_t i = 0; i < ntaps; i++) { // reversed, so outputs walk forward
+    t[i].mag = mag_of(&taps[ntaps - 1 - i]);
+    t[i].neg = neg_mask_of(&taps[ntaps - 1 - i]);
+  }
+
+  fir->ntaps = ntaps;
+  fir->taps = t;
+  fir->window = w;
+  fixpoint_fir_reset(fir);
+  return true;
+}
+
+void fixpoint_fir_reset(fixpoint_fir_t *fir) {
+  memset(fir->window, 0, (fir->ntaps - 1) * sizeof(packed_t));
+}
+
+result_t fixpoint_fir_process(fixpoint_fir_t *fir, fixpoint_t *out,
+                              const fixpoint_t *in, size_t n) {
+  packed_t *w = fir->window;
+  size_t hist = fir->ntaps - 1;
+  result_t flags = RESULT_OK;
+
+  while (n > 0) {
+    size_t len = n < FIR_BLOCK ? n : FIR_BLOCK;
+    for (size_t i = 0; i < len; i++) {
+      w[hist + i].mag = mag_of(&in[i]);
+      w[hist + i].neg = neg_mask_of(&in[i]);
+    }
+    flags |= fir_block(out, w, fir->taps, fir->ntaps, len);
+    memmove(w, w + len, hist * sizeof(packed_t)); // keep the newest samples
+    in += len;
+    out += len;
+    n -= len;
+  }
+  return flags;
+}
+
+void fixpoint_fir_cleanup(fixpoint_fir_t *fir) {
+  free(fir->taps);
+  free(fir->window);
+  fir->taps = NULL;
+  fir->window = NULL;
+  fir->ntaps = 0;
+}
+
+result_t fixpoint_convolve(fixpoint_t *out, const fixpoint_t *x, size_t nx,
+                           const fixpoint_t *h, size_t nh) {
+  if (nx == 0 || nh == 0)
+    return RESULT_OK;
+
+  fixpoint_fir_t fir;
+  if (!fixpoint_fir_init(&fir, h, nh)) {
+    // no memory for the filter state, so compute the sums directly
+    result_t flags = RESULT_OK;
+    for (size_t i = 0; i < nx + nh - 1; i++) {
+      wide_acc_t acc = { 0, 0 };
+      for (size_t j = (i >= nx ? i - nx + 1 : 0); j < nh && j <= i; j++)
+        wide_acc_add(&acc, (unsigned __int128)mag_of(&h[j]) * mag_of(&x[i - j]),
+                     neg_mask_of(&h[j]) ^ neg_mask_of(&x[i - j]));
+      flags |= wide_acc_finish(&out[i], &acc);
+    }
+    return flags;
+  }
+
+  result_t flags = fixpoint_fir_process(&fir, out, x, nx);
+
+  // flush the tail of the kernel with zeros
+  fixpoint_t zeros[FIR_BLOCK];
+  memset(zeros, 0, sizeof(zeros));
+  for (size_t done = 0; done < nh - 1;) {
+    size_t len = nh - 1 - done < FIR_BLOCK ? nh - 1 - done : FIR_BLOCK;
+    flags |= fixpoint_fir_process(&fir, out + nx + done, zeros, len);
+    done += len;
+  }
+
+  fixpoint_fir_cleanup(&fir);
+  return flags;
+}
+
+result_t fixpoint_poly_eval_n(const fixpoint_t *coeffs, unsigned degree,
+                              const fixpoint_t *x, fixpoint_t *out, size_t n) {
+  result_t all_flags = RESULT_OK;
+  __int128 top = q64_of(mag_of(&coeffs[degree]), neg_mask_of(&coeffs[degree]));
+
+  for (size_t i = 0; i < n; i += POLY_LANES) {
+    int lanes = n - i < POLY_LANES ? (int)(n - i) : POLY_LANES;
+    uint64_t x_mag[POLY_LANES] = { 0 }, x_neg[POLY_LANES] = { 0 };
+    __int128 acc[POLY_LANES];
+    result_t flags[POLY_LANES];
+    for (int l = 0; l < lanes; l++) {
+      x_mag[l] = mag_of(&x[i + l]);
+      x_neg[l] = neg_mask_of(&x[i + l]);
+    }
+    for (int l = 0; l < POLY_LANES; l++) {
+      acc[l] = top;
+      flags[l] = RESULT_OK;
+    }
+
+    for (unsigned d = degree; d-- > 0;) {
+      uint64_t c_mag = mag_of(&coeffs[d]), c_neg = neg_mask_of(&coeffs[d]);
+      for (int l = 0; l < POLY_LANES; l++)
+        acc[l] = poly_step(acc[l], x_mag[l], x_neg[l], c_mag, c_neg, &flags[l]);
+    }
+
+    for (int l = 0; l < lanes; l++)
+      all_flags |= poly_finish(&out[i + l], acc[l], flags[l]);
+  }
+  return all_flags;
+}
+
+size_t fixpoint_format_hex_n(char *buf, const fixpoint_t *vals, size_t n,
+                             char sep) {
+  FIXPOINT_PROFILE_BEGIN(FIXPOINT_PROFILE_FORMAT_HEX_N);
+  char *p = buf;
+  for (size_t i = 0; i < n; i++) {
+    p += format_hex_fast(p, &vals[i]);
+    *p++ = sep;
+  }
+  FIXPOINT_PROFILE_END(FIXPOINT_PROFILE_FORMAT_HEX_N);
+  return (size_t)(p - buf);
+}
+
+size_t fixpoint_parse_hex_n(fixpoint_t *vals, size_t max_vals, const char *buf,
+                            size_t len, char sep, uint64_t *invalid,
+                            size_t *consumed) {
+  FIXPOINT_PROFILE_BEGIN(FIXPOINT_PROFILE_PARSE_HEX_N);
+  const char *p = buf, *end = buf + len;
+  size_t n = 0;
+  bool any_invalid = false;
+  while (p < end && n < max_vals) {
+    const char *tok_end = memchr(p, sep, (size_t)(end - p));
+    if (!tok_end)
+      tok_end = end;
+    if (!parse_hex_token(&vals[n], p, tok_end)) {
+      fixpoint_init(&vals[n], 0, 0, false);
+      any_invalid = true;
+      FIXPOINT_PROBE_PARSE_HEX_N_FAIL(n, p, (size_t)(tok_end - p));
+      if (invalid)
+        invalid[n / 64] |= (uint64_t)1 << (n % 64);
+    }
+    n++;
+    p = tok_end + (tok_end < end); // skip the separator
+  }
+  if (consumed)
+    *consumed = (size_t)(p - buf);
+  FIXPOINT_PROFILE_END(FIXPOINT_PROFILE_PARSE_HEX_N);
+  FIXPOINT_STATS_RECORD(FIXPOINT_STATS_PARSE_HEX_N, RESULT_OK, any_invalid);
+  return n;
+}
+
+result_t fixpoint_from_double_n(fixpoint_t *out, const double *in, size_t n,
+                                fixpoint_round_t mode) {
+  assert(valid_round_mode(mode));
+  result_t flags = RESULT_OK;
+  for (size_t i = 0; i < n; i++) // scaling by 2^32 is exact (or infinite)
+    flags |= from_scaled_kernel(&out[i], in[i] * 0x1p32, mode);
+  return flags;
+}
+
+result_t fixpoint_from_float_n(fixpoint_t *out, const float *in, size_t n,
+                               fixpoint_round_t mode) {
+  assert(valid_round_mode(mode));
+  result_t flags = RESULT_OK;
+  for (size_t i = 0; i < n; i++) // every float is exact as a double
+    flags |= from_scaled_kernel(&out[i], (double)in[i] * 0x1p32, mode);
+  return flags;
+}
+
+result_t fixpoint_to_double_n(double *out, const fixpoint_t *in, size_t n) {
+  bool inexact = false;
+  for (size_t i = 0; i < n; i++) {
+    uint64_t mag = mag_of(&in[i]);
+    double d = (double)mag; // the only rounding; scaling by 2^-32 is exact
+    bool fits = d < 0x1p64;  // rounding can carry up to 2^64
+    inexact |= !fits | ((uint64_t)(fits ? d : 0) != mag);
+    d *= 0x1p-32;
+    out[i] = in[i].negative ? -d : d;
+  }
+  return inexact ? RESULT_UNDERFLOW : RESULT_OK;
+}
+
+result_t fixpoint_to_float_n(float *out, const fixpoint_t *in, size_t n) {
+  bool inexact = false;
+  for (size_t i = 0; i < n; i++) {
+    uint64_t mag = mag_of(&in[i]);
+    float f = (float)mag;
+    bool fits = f < 0x1p64f;
+    inexact |= !fits | ((uint64_t)(fits ? f : 0) != mag);
+    f *= 0x1p-32f;
+    out[i] = in[i].negative ? -f : f;
+  }
+  return inexact ? RESULT_UNDERFLOW : RESULT_OK;
+}
+
+void fixpoint_from_int32_n(fixpoint_t *out, const int32_t *in, size_t n) {
+  for (size_t i = 0; i < n; i++) {
+    out[i].whole = in[i] < 0 ? 0 - (uint32_t)in[i] : (uint32_t)in[i];
+    out[i].frac = 0;
+    out[i].negative = in[i] < 0;
+  }
+}
+
+result_t fixpoint_from_int64_n(fixpoint_t *out, const int64_t *in, size_t n) {
+  bool overflow = false;
+  for (size_t i = 0; i < n; i++) {
+    uint64_t mag = in[i] < 0 ? 0 - (uint64_t)in[i] : (uint64_t)in[i];
+    bool big = (mag >> 32) != 0;
+    overflow |= big;
+    out[i].whole = (uint32_t)mag | -(uint32_t)big;
+    out[i].frac = -(uint32_t)big;
+    out[i].negative = in[i] < 0;
+  }
+  return overflow ? RESULT_OVERFLOW : RESULT_OK;
+}
+
+result_t fixpoint_to_int32_n(int32_t *out, const fixpoint_t *in, size_t n,
+                             fixpoint_round_t mode) {
+  assert(valid_round_mode(mode));
+  bool inexact = false, overflow = false;
+  for (size_t i = 0; i < n; i++) {
+    bool frac;
+    int64_t v = to_integer(&in[i], mode, &frac);
+    inexact |= frac;
+    overflow |= v < INT32_MIN || v > INT32_MAX;
+    v = v < INT32_MIN ? INT32_MIN : v > INT32_MAX ? INT32_MAX : v;
+    out[i] = (int32_t)v;
+  }
+  return (overflow ? RESULT_OVERFLOW : 0) | (inexact ? RESULT_UNDERFLOW : 0);
+}
+
+result_t fixpoint_to_int64_n(int64_t *out, const fixpoint_t *in, size_t n,
+                             fixpoint_round_t mode) {
+  assert(valid_round_mode(mode));
+  bool inexact = false;
+  for (size_t i = 0; i < n; i++) {
+    bool frac;
+    out[i] = to_integer(&in[i], mode, &frac);
+    inexact |= frac;
+  }
+  return inexact ? RESULT_UNDERFLOW : RESULT_OK;
+}
@@ -5,6 +5,10 @@
 #include <stdbool.h>
 #include <stddef.h>
 
+#ifdef __cplusplus
+extern "C" {
+#endif
+
 ////////////////////////////////////////////////////////////////////////
 // Data types
 ////////////////////////////////////////////////////////////////////////
@@ -193,6 +197,519 @@ fixpoint_format_hex( fixpoint_str_t *s, const fixpoint_t *val );
 bool
 fixpoint_parse_hex( fixpoint_t *val, const fixpoint_str_t *s );
 
+////////////////////////////////////////////////////////////////////////
+// Rounded multiplication
+////////////////////////////////////////////////////////////////////////
+
+//! Rounding modes for fixpoint_mul_rounded. Passing any other value to
+//! a function that takes a mode is a precondition violation, which
+//! fails an assert (the result is unspecified under NDEBUG).
+typedef enum {
+  FIXPOINT_ROUND_TRUNC,        //!< toward zero (what fixpoint_mul does)
+  FIXPOINT_ROUND_NEAREST_EVEN, //!< to nearest, ties to an even last bit
+  FIXPOINT_ROUND_NEAREST_AWAY, //!< to nearest, ties away from zero
+  FIXPOINT_ROUND_FLOOR,        //!< toward negative infinity
+  FIXPOINT_ROUND_CEIL,         //!< toward positive infinity
+} fixpoint_round_t;
+
+//! Compute the product of two fixpoint_t values, rounding the
+//! discarded low 32 bits of the intermediate product according to
+//! the given mode instead of always truncating them. Truncation
+//! biases long chains of multiplications toward zero; the
+//! round-to-nearest modes do not.
+//! The flags have the same meaning as for fixpoint_mul:
+//! RESULT_UNDERFLOW if the discarded low bits were not all 0 (i.e.,
+//! the result is inexact), RESULT_OVERFLOW if the high 32 bits were
+//! not all 0 or rounding carried out of the magnitude.
+//!
+//! @param result pointer to result fixpoint_t instance (where product is stored)
+//! @param left pointer to left value to be multiplied
+//! @param right pointer to right value to be multiplied
+//! @param mode the rounding mode
+//! @return RESULT_OK, or RESULT_OVERFLOW, or RESULT_UNDERFLOW,
+//!         or (RESULT_OVERFLOW|RESULT_UNDERFLOW)
+result_t
+fixpoint_mul_rounded( fixpoint_t *result, const fixpoint_t *left, const fixpoint_t *right,
+                      fixpoint_round_t mode );
+
+//! Compute out[i] = left[i] * right[i] for i in 0..n-1, rounding
+//! each element like fixpoint_mul_rounded.
+//!
+//! @param out pointer to the n results
+//! @param left pointer to the n left operands
+//! @param right pointer to the n right operands
+//! @param n number of elements
+//! @param mode the rounding mode
+//! @return the bitwise OR of the flags fixpoint_mul_rounded would return
+result_t
+fixpoint_mul_rounded_n( fixpoint_t *out, const fixpoint_t *left, const fixpoint_t *right,
+                        size_t n, fixpoint_round_t mode );
+
+////////////////////////////////////////////////////////////////////////
+// Saturating arithmetic
+////////////////////////////////////////////////////////////////////////
+
+//! Compute the sum of two fixpoint_t values, saturating on overflow.
+//! Same as fixpoint_add, except that if the magnitude of the sum is
+//! too large, *result is set to the largest magnitude (0xFFFFFFFF.FFFFFFFF)
+//! with the sign of the exact sum, rather than to the truncated sum.
+//!
+//! @param result pointer to result fixpoint_t instance (where the sum is stored)
+//! @param left the left value to be added
+//! @param right the right value to be added
+//! @return RESULT_OK or RESULT_OVERFLOW (if the result was clamped)
+result_t
+fixpoint_add_sat( fixpoint_t *result, const fixpoint_t *left, const fixpoint_t *right );
+
+//! Compute the difference of two fixpoint_t values, saturating on
+//! overflow (see fixpoint_add_sat).
+//!
+//! @param result pointer to result fixpoint_t instance (where the difference is stored)
+//! @param left the left value in the subtraction (the minuend)
+//! @param right the right value in the subtraction (the subtrahend)
+//! @return RESULT_OK or RESULT_OVERFLOW (if the result was clamped)
+result_t
+fixpoint_sub_sat( fixpoint_t *result, const fixpoint_t *left, const fixpoint_t *right );
+
+//! Compute the product of two fixpoint_t values, saturating on
+//! overflow. Same as fixpoint_mul, except that if the high 32 bits
+//! of the intermediate product are not all 0, *result is set to the
+//! largest magnitude with the sign of the product. Low bits are
+//! still truncated and reported as RESULT_UNDERFLOW.
+//!
+//! @param result pointer to result fixpoint_t instance (where product is stored)
+//! @param left pointer to left value to be multiplied
+//! @param right pointer to right value to be multiplied
+//! @return RESULT_OK, or RESULT_OVERFLOW, or RESULT_UNDERFLOW,
+//!         or (RESULT_OVERFLOW|RESULT_UNDERFLOW)
+result_t
+fixpoint_mul_sat( fixpoint_t *result, const fixpoint_t *left, const fixpoint_t *right );
+
+////////////////////////////////////////////////////////////////////////
+// Batch operations
+////////////////////////////////////////////////////////////////////////
+
+//! Compute out[i] = left[i] + right[i] for i in 0..n-1.
+//! Each element gets exactly the result fixpoint_add would store,
+//! but the loop has no data-dependent branches.
+//! The output array may be the same as either input array.
+//!
+//! @param out pointer to the n results
+//! @param left pointer to the n left operands
+//! @param right pointer to the n right operands
+//! @param n number of elements
+//! @return the bitwise OR of the flags fixpoint_add would return
+result_t
+fixpoint_add_n( fixpoint_t *out, const fixpoint_t *left, const fixpoint_t *right, size_t n );
+
+//! Compute out[i] = left[i] - right[i] for i in 0..n-1, with the
+//! same per-element results as fixpoint_sub.
+//!
+//! @param out pointer to the n results
+//! @param left pointer to the n left operands
+//! @param right pointer to the n right operands
+//! @param n number of elements
+//! @return the bitwise OR of the flags fixpoint_sub would return
+result_t
+fixpoint_sub_n( fixpoint_t *out, const fixpoint_t *left, const fixpoint_t *right, size_t n );
+
+//! Compute out[i] = left[i] * right[i] for i in 0..n-1, with the
+//! same per-element results as fixpoint_mul.
+//!
+//! @param out pointer to the n results
+//! @param left pointer to the n left operands
+//! @param right pointer to the n right operands
+//! @param n number of elements
+//! @return the bitwise OR of the flags fixpoint_mul would return
+result_t
+fixpoint_mul_n( fixpoint_t *out, const fixpoint_t *left, const fixpoint_t *right, size_t n );
+
+//! Compute out[i] = -in[i] for i in 0..n-1, with the same
+//! per-element results as fixpoint_negate.
+//!
+//! @param out pointer to the n results (may be the same as in)
+//! @param in pointer to the n operands
+//! @param n number of elements
+void
+fixpoint_negate_n( fixpoint_t *out, const fixpoint_t *in, size_t n );
+
+//! Compute out[i] = left[i] + right[i] for i in 0..n-1, saturating
+//! each element like fixpoint_add_sat.
+//!
+//! @param out pointer to the n results
+//! @param left pointer to the n left operands
+//! @param right pointer to the n right operands
+//! @param n number of elements
+//! @return the bitwise OR of the flags fixpoint_add_sat would return
+result_t
+fixpoint_add_sat_n( fixpoint_t *out, const fixpoint_t *left, const fixpoint_t *right, size_t n );
+
+//! Compute out[i] = left[i] - right[i] for i in 0..n-1, saturating
+//! each element like fixpoint_sub_sat.
+//!
+//! @param out pointer to the n results
+//! @param left pointer to the n left operands
+//! @param right pointer to the n right operands
+//! @param n number of elements
+//! @return the bitwise OR of the flags fixpoint_sub_sat would return
+result_t
+fixpoint_sub_sat_n( fixpoint_t *out, const fixpoint_t *left, const fixpoint_t *right, size_t n );
+
+//! Compute out[i] = left[i] * right[i] for i in 0..n-1, saturating
+//! each element like fixpoint_mul_sat.
+//!
+//! @param out pointer to the n results
+//! @param left pointer to the n left operands
+//! @param right pointer to the n right operands
+//! @param n number of elements
+//! @return the bitwise OR of the flags fixpoint_mul_sat would return
+result_t
+fixpoint_mul_sat_n( fixpoint_t *out, const fixpoint_t *left, const fixpoint_t *right, size_t n );
+
+//! Value of fixpoint_status_t.first when no element had a flag set.
+#define FIXPOINT_STATUS_NONE ( (size_t) -1 )
+
+//! Number of uint64_t words needed for a status bitmap of n elements.
+#define FIXPOINT_STATUS_WORDS( n ) ( ( (n) + 63 ) / 64 )
+
+//! Deferred ("sticky") per-element status of batch operations.
+//! Instead of the caller checking a result_t for every element,
+//! the _status variants of the batch operations record which
+//! elements overflowed or underflowed in bitmaps (bit i % 64 of
+//! word i / 64 describes element i), without branching on the flags.
+//! The status is sticky: flags are OR-ed in, so several operations
+//! over the same rows accumulate into one status, which can be
+//! inspected after the hot loop. Either bitmap may be NULL if only
+//! the first failing index and the combined flags are needed.
+//! To process a large array in pieces with one status, set base to
+//! the index of each piece's first element before its calls: element
+//! i of a call is recorded as element base + i. The calls don't
+//! change base, so operations over the same piece still accumulate.
+typedef struct {
+  uint64_t *overflow;  //!< RESULT_OVERFLOW bitmap, or NULL
+  uint64_t *underflow; //!< RESULT_UNDERFLOW bitmap, or NULL
+  size_t n;            //!< number of elements covered by the bitmaps
+  size_t base;         //!< status index of element 0 of the next call (0 after init)
+  size_t first;        //!< lowest index with a flag set, or FIXPOINT_STATUS_NONE
+  result_t flags;      //!< bitwise OR of all recorded flags
+} fixpoint_status_t;
+
+//! Initialize a status for n elements, clear its bitmaps and set its
+//! base to 0.
+//!
+//! @param st pointer to the fixpoint_status_t instance to initialize
+//! @param overflow bitmap of FIXPOINT_STATUS_WORDS(n) words, or NULL
+//! @param underflow bitmap of FIXPOINT_STATUS_WORDS(n) words, or NULL
+//! @param n number of elements
+void
+fixpoint_status_init( fixpoint_status_t *st, uint64_t *overflow, uint64_t *underflow, size_t n );
+
+//! Return the recorded flags of one element. Flags whose bitmap
+//! is NULL are not reported.
+//!
+//! @param st pointer to a fixpoint_status_t instance
+//! @param i index of the element (less than st->n)
+//! @return the flags recorded for element i
+result_t
+fixpoint_status_get( const fixpoint_status_t *st, size_t i );
+
+//! Same as fixpoint_add_n, but also records each element's flags in
+//! a status. base + n must not be greater than the status's n.
+//!
+//! @param out pointer to the n results
+//! @param left pointer to the n left operands
+//! @param right pointer to the n right operands
+//! @param n number of elements
+//! @param st pointer to the status to update
+//! @return the bitwise OR of the flags of this call
+result_t
+fixpoint_add_n_status( fixpoint_t *out, const fixpoint_t *left, const fixpoint_t *right,
+                       size_t n, fixpoint_status_t *st );
+
+//! Same as fixpoint_sub_n, but also records each element's flags in
+//! a status. base + n must not be greater than the status's n.
+//!
+//! @param out pointer to the n results
+//! @param left pointer to the n left operands
+//! @param right pointer to the n right operands
+//! @param n number of elements
+//! @param st pointer to the status to update
+//! @return the bitwise OR of the flags of this call
+result_t
+fixpoint_sub_n_status( fixpoint_t *out, const fixpoint_t *left, const fixpoint_t *right,
+                       size_t n, fixpoint_status_t *st );
+
+//! Same as fixpoint_mul_n, but also records each element's flags in
+//! a status. base + n must not be greater than the status's n.
+//!
+//! @param out pointer to the n results
+//! @param left pointer to the n left operands
+//! @param right pointer to the n right operands
+//! @param n number of elements
+//! @param st pointer to the status to update
+//! @return the bitwise OR of the flags of this call
+result_t
+fixpoint_mul_n_status( fixpoint_t *out, const fixpoint_t *left, const fixpoint_t *right,
+                       size_t n, fixpoint_status_t *st );
+
+////////////////////////////////////////////////////////////////////////
+// Dense kernels
+////////////////////////////////////////////////////////////////////////
+
+//! Compute the matrix product C = A * B, where A is an m x k matrix,
+//! B is a k x n matrix, and C is an m x n matrix, all stored in
+//! row-major order. Each element of C is accumulated exactly (the
+//! full 128-bit products are summed in a wide accumulator) and is
+//! truncated only once, when it is stored. So, the result is generally
+//! more accurate than a loop of fixpoint_mul and fixpoint_add calls,
+//! and the flags describe the final stored value in the same way as
+//! fixpoint_mul: RESULT_OVERFLOW if the magnitude of the exact sum
+//! does not fit in a fixpoint_t, RESULT_UNDERFLOW if nonzero bits
+//! below 2^-32 were discarded. The work is divided into output tiles,
+//! which are computed in parallel.
+//!
+//! @param c pointer to the m x n result matrix (must not overlap a or b)
+//! @param a pointer to the m x k left matrix
+//! @param b pointer to the k x n right matrix
+//! @param m number of rows of A and C
+//! @param n number of columns of B and C
+//! @param k number of columns of A and rows of B
+//! @param nthreads maximum number of threads to use, or 0 to use
+//!                 one thread per online CPU
+//! @return the bitwise OR of the flags of all elements of C
+result_t
+fixpoint_gemm( fixpoint_t *c, const fixpoint_t *a, const fixpoint_t *b,
+               size_t m, size_t n, size_t k, unsigned nthreads );
+
+//! State of a streaming FIR filter. The taps are converted once by
+//! fixpoint_fir_init, and the last ntaps - 1 input samples are kept
+//! between calls to fixpoint_fir_process, so a long stream can be
+//! filtered one block at a time. The fields are managed by the
+//! fixpoint_fir_ functions and should not be accessed directly.
+typedef struct {
+  size_t ntaps;  //!< number of filter taps
+  void *taps;    //!< precomputed taps, in reverse order
+  void *window;  //!< input history followed by room for one block
+} fixpoint_fir_t;
+
+//! Initialize a FIR filter with the given taps, so that output sample
+//! y[i] is the sum of taps[j] * x[i - j] for j in 0..ntaps-1.
+//! Samples before the start of the stream are treated as 0.
+//!
+//! @param fir pointer to the fixpoint_fir_t instance to initialize
+//! @param taps pointer to the filter coefficients
+//! @param ntaps number of filter coefficients (must be at least 1)
+//! @return true if successful, false if ntaps is 0 or memory could
+//!         not be allocated
+bool
+fixpoint_fir_init( fixpoint_fir_t *fir, const fixpoint_t *taps, size_t ntaps );
+
+//! Clear the input history of a FIR filter, as if no samples had
+//! been processed yet.
+//!
+//! @param fir pointer to an initialized fixpoint_fir_t instance
+void
+fixpoint_fir_reset( fixpoint_fir_t *fir );
+
+//! Filter the next block of a stream. Each output sample is
+//! accumulated exactly and truncated once, with the same flag rules
+//! as fixpoint_gemm.
+//!
+//! @param fir pointer to an initialized fixpoint_fir_t instance
+//! @param out pointer to n output samples (must not overlap in)
+//! @param in pointer to the next n input samples
+//! @param n number of samples
+//! @return the bitwise OR of the flags of all output samples
+result_t
+fixpoint_fir_process( fixpoint_fir_t *fir, fixpoint_t *out, const fixpoint_t *in, size_t n );
+
+//! Free the memory used by a FIR filter.
+//!
+//! @param fir pointer to an initialized fixpoint_fir_t instance
+void
+fixpoint_fir_cleanup( fixpoint_fir_t *fir );
+
+//! Compute the full 1-D convolution of x and h, which has
+//! nx + nh - 1 samples (none if either input is empty).
+//! Uses the same exact accumulation as fixpoint_fir_process.
+//!
+//! @param out pointer to nx + nh - 1 output samples
+//! @param x pointer to the input signal
+//! @param nx number of input samples
+//! @param h pointer to the kernel
+//! @param nh number of kernel samples
+//! @return the bitwise OR of the flags of all output samples
+result_t
+fixpoint_convolve( fixpoint_t *out, const fixpoint_t *x, size_t nx,
+                   const fixpoint_t *h, size_t nh );
+
+//! Evaluate a polynomial at n points using Horner's rule.
+//! The coefficient of x^i is coeffs[i], for i in 0..degree.
+//! The intermediate values are kept in a signed Q63.64 format
+//! (32 more fraction bits and 31 more integer bits than fixpoint_t),
+//! and each result is truncated once when it is stored. Several
+//! points are evaluated together in independent lanes.
+//! RESULT_OVERFLOW is reported for a point if its result or an
+//! intermediate value was out of range, and RESULT_UNDERFLOW if any
+//! nonzero bits were discarded along the way.
+//!
+//! @param coeffs pointer to the degree + 1 coefficients
+//! @param degree degree of the polynomial
+//! @param x pointer to the n points
+//! @param out pointer to the n results (may be the same as x)
+//! @param n number of points
+//! @return the bitwise OR of the flags of all points
+result_t
+fixpoint_poly_eval_n( const fixpoint_t *coeffs, unsigned degree,
+                      const fixpoint_t *x, fixpoint_t *out, size_t n );
+
+////////////////////////////////////////////////////////////////////////
+// Batch text conversion
+////////////////////////////////////////////////////////////////////////
+
+//! Maximum length of a base-16 value produced by fixpoint_format_hex
+//! (sign, 8 whole digits, point, 8 fraction digits), without the NUL.
+#define FIXPOINT_HEX_MAX_LEN 18
+
+//! Format n values in base 16, each followed by the separator sep,
+//! into one buffer. Each value is formatted exactly as by
+//! fixpoint_format_hex, but without going through snprintf.
+//! The output is not NUL-terminated.
+//!
+//! @param buf pointer to the output buffer, which must have room for
+//!            n * (FIXPOINT_HEX_MAX_LEN + 1) characters
+//! @param vals pointer to the n values
+//! @param n number of values
+//! @param sep separator written after each value (e.g., '\n')
+//! @return number of characters written
+size_t
+fixpoint_format_hex_n( char *buf, const fixpoint_t *vals, size_t n, char sep );
+
+//! Parse base-16 values separated by sep (e.g., one per line) from a
+//! buffer. A token is valid if and only if fixpoint_parse_hex would
+//! accept it as a string, and the whole token is examined (there is
+//! no NUL to stop at). A separator at the very end of the buffer does
+//! not start another token. An invalid token is stored as zero and
+//! the bit for its index is set in the invalid bitmap (the other bits
+//! are left unchanged, so the bitmap should start cleared, e.g. with
+//! FIXPOINT_STATUS_WORDS(max_vals) zero words).
+//!
+//! @param vals pointer to the parsed values
+//! @param max_vals maximum number of values to parse
+//! @param buf pointer to the text (need not be NUL-terminated)
+//! @param len length of the text
+//! @param sep separator between values
+//! @param invalid bitmap recording invalid tokens, or NULL
+//! @param consumed if not NULL, set to the number of characters of
+//!                 buf used (less than len if max_vals was reached)
+//! @return number of tokens parsed
+size_t
+fixpoint_parse_hex_n( fixpoint_t *vals, size_t max_vals, const char *buf, size_t len,
+                      char sep, uint64_t *invalid, size_t *consumed );
+
+////////////////////////////////////////////////////////////////////////
+// Batch numeric conversion
+////////////////////////////////////////////////////////////////////////
+
+// Conversions between arrays of fixpoint_t and arrays of double,
+// float, int32_t and int64_t. Like the batch operations, the loops
+// have no data-dependent branches, so the compiler can vectorize them.
+// Flags follow the rules of the arithmetic: RESULT_UNDERFLOW means a
+// value was inexact (bits were rounded off), RESULT_OVERFLOW means it
+// was out of range. Out-of-range values saturate to the largest
+// magnitude of the target type, with their sign. As with
+// fixpoint_mul_rounded, the mode must be a fixpoint_round_t value.
+
+//! Convert doubles to fixpoint_t, rounding each value to a multiple
+//! of 2^-32 as specified by mode. Values whose rounded magnitude is
+//! 2^32 or more (including infinities) saturate to the largest
+//! magnitude; NaN converts to zero with RESULT_OVERFLOW. As with
+//! fixpoint_mul, a negative value that is rounded to zero keeps its
+//! sign (-0.0 is converted to zero).
+//!
+//! @param out pointer to the n results
+//! @param in pointer to the n values
+//! @param n number of elements
+//! @param mode rounding mode
+//! @return the bitwise OR of the flags of all elements
+result_t
+fixpoint_from_double_n( fixpoint_t *out, const double *in, size_t n, fixpoint_round_t mode );
+
+//! Convert floats to fixpoint_t (see fixpoint_from_double_n).
+//!
+//! @param out pointer to the n results
+//! @param in pointer to the n values
+//! @param n number of elements
+//! @param mode rounding mode
+//! @return the bitwise OR of the flags of all elements
+result_t
+fixpoint_from_float_n( fixpoint_t *out, const float *in, size_t n, fixpoint_round_t mode );
+
+//! Convert fixpoint_t values to doubles, rounding to nearest (ties to
+//! even). Values with more than 53 significant bits are inexact.
+//!
+//! @param out pointer to the n results
+//! @param in pointer to the n values
+//! @param n number of elements
+//! @return RESULT_UNDERFLOW if any value was inexact, RESULT_OK otherwise
+result_t
+fixpoint_to_double_n( double *out, const fixpoint_t *in, size_t n );
+
+//! Convert fixpoint_t values to floats, rounding to nearest (ties to
+//! even). Values with more than 24 significant bits are inexact.
+//!
+//! @param out pointer to the n results
+//! @param in pointer to the n values
+//! @param n number of elements
+//! @return RESULT_UNDERFLOW if any value was inexact, RESULT_OK otherwise
+result_t
+fixpoint_to_float_n( float *out, const fixpoint_t *in, size_t n );
+
+//! Convert 32 bit integers to fixpoint_t (always exact).
+//!
+//! @param out pointer to the n results
+//! @param in pointer to the n values
+//! @param n number of elements
+void
+fixpoint_from_int32_n( fixpoint_t *out, const int32_t *in, size_t n );
+
+//! Convert 64 bit integers to fixpoint_t. Values whose magnitude is
+//! 2^32 or more saturate to the largest magnitude.
+//!
+//! @param out pointer to the n results
+//! @param in pointer to the n values
+//! @param n number of elements
+//! @return RESULT_OVERFLOW if any value was out of range, RESULT_OK otherwise
+result_t
+fixpoint_from_int64_n( fixpoint_t *out, const int64_t *in, size_t n );
+
+//! Convert fixpoint_t values to 32 bit integers, rounding as specified
+//! by mode. Values out of range saturate to INT32_MIN or INT32_MAX.
+//!
+//! @param out pointer to the n results
+//! @param in pointer to the n values
+//! @param n number of elements
+//! @param mode rounding mode
+//! @return the bitwise OR of RESULT_UNDERFLOW (a value had a fraction)
+//!         and RESULT_OVERFLOW (a value was out of range)
+result_t
+fixpoint_to_int32_n( int32_t *out, const fixpoint_t *in, size_t n, fixpoint_round_t mode );
+
+//! Convert fixpoint_t values to 64 bit integers, rounding as specified
+//! by mode (every value is in range).
+//!
+//! @param out pointer to the n results
+//! @param in pointer to the n values
+//! @param n number of elements
+//! @param mode rounding mode
+//! @return RESULT_UNDERFLOW if a value had a fraction, RESULT_OK otherwise
+result_t
+fixpoint_to_int64_n( int64_t *out, const fixpoint_t *in, size_t n, fixpoint_round_t mode );
+
 // TODO: add prototypes for helper functions you want to test using unit tests
 
+#ifdef __cplusplus
+}
+#endif
+
 #endif // FIXPOINT_H
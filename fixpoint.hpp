@@ -0,0 +1,240 @@
+#ifndef FIXPOINT_HPP
+#define FIXPOINT_HPP
+
+#include <cstdint>
+#include <type_traits>
+#include "fixpoint.h"
+
+////////////////////////////////////////////////////////////////////////
+// Compile-time parameterized Qm.n fixed point values
+////////////////////////////////////////////////////////////////////////
+
+namespace fixpoint_detail {
+
+//! Smallest unsigned integer type with at least Bits bits.
+template <unsigned Bits>
+using uint_least_t =
+  std::conditional_t<(Bits <= 8), std::uint8_t,
+  std::conditional_t<(Bits <= 16), std::uint16_t,
+  std::conditional_t<(Bits <= 32), std::uint32_t,
+  std::conditional_t<(Bits <= 64), std::uint64_t, unsigned __int128>>>>;
+
+//! Value of a hex digit, or -1 if c is not a hex digit.
+constexpr int hex_value( char c ) {
+  return ( c >= '0' && c <= '9' ) ? c - '0'
+       : ( c >= 'a' && c <= 'f' ) ? c - 'a' + 10
+       : ( c >= 'A' && c <= 'F' ) ? c - 'A' + 10
+       : -1;
+}
+
+} // namespace fixpoint_detail
+
+//! A sign-magnitude fixed point value with IntBits bits of whole part
+//! and FracBits bits of fractional part (a QIntBits.FracBits format).
+//! The magnitude is stored in the smallest unsigned integer type that
+//! holds IntBits + FracBits bits, so Q16.16 takes 4 bytes plus the sign.
+//!
+//! All operations have the same semantics as the corresponding
+//! functions in fixpoint.c, generalized to the format's widths:
+//! results are truncated and flagged with RESULT_OVERFLOW and
+//! RESULT_UNDERFLOW exactly as fixpoint_add, fixpoint_sub and
+//! fixpoint_mul do, and formatting/parsing uses the same hex syntax
+//! with up to IntBits/4 whole digits and FracBits/4 fraction digits.
+//! fixpoint<32, 32> gives bit-for-bit the same results as the C API.
+//! Everything is constexpr, so values can be computed at compile time.
+template <unsigned IntBits, unsigned FracBits>
+class fixpoint {
+  static_assert( IntBits >= 4 && FracBits >= 4, "each part needs at least one hex digit" );
+  static_assert( IntBits % 4 == 0 && FracBits % 4 == 0, "widths must be whole hex digits" );
+  static_assert( IntBits + FracBits <= 64, "at most 64 bits of magnitude are supported" );
+
+public:
+  static constexpr unsigned int_bits = IntBits;
+  static constexpr unsigned frac_bits = FracBits;
+  static constexpr unsigned total_bits = IntBits + FracBits;
+
+  //! Unsigned type holding the magnitude (and each of its parts).
+  using storage_type = fixpoint_detail::uint_least_t<total_bits>;
+
+  //! Maximum length of a formatted value, including the sign and NUL.
+  static constexpr unsigned str_max_size = 1 + IntBits / 4 + 1 + FracBits / 4 + 1;
+
+  //! A formatted value.
+  struct str_type {
+    char str[str_max_size];
+  };
+
+  //! Zero.
+  constexpr fixpoint() : m_mag( 0 ), m_negative( false ) { }
+
+  //! Create a value from its parts, like fixpoint_init (bits of whole
+  //! and frac beyond the format's widths are ignored, and zero is
+  //! never negative).
+  static constexpr fixpoint from_parts( storage_type whole, storage_type frac, bool negative ) {
+    return from_raw( static_cast<storage_type>( ( wide_type( whole & int_mask ) << FracBits ) |
+                                                ( frac & frac_mask ) ),
+                     negative );
+  }
+
+  //! Create a value from its magnitude in units of 2^-FracBits.
+  static constexpr fixpoint from_raw( storage_type mag, bool negative ) {
+    fixpoint val;
+    val.m_mag = static_cast<storage_type>( mag & mag_mask );
+    val.m_negative = negative && val.m_mag != 0;
+    return val;
+  }
+
+  constexpr storage_type whole() const { return static_cast<storage_type>( wide_type( m_mag ) >> FracBits ); }
+  constexpr storage_type frac() const { return static_cast<storage_type>( m_mag & frac_mask ); }
+  constexpr storage_type raw() const { return m_mag; }
+  constexpr bool is_negative() const { return m_negative; }
+
+  //! Like fixpoint_negate: flips the sign of nonzero values.
+  constexpr fixpoint negated() const {
+    fixpoint val = *this;
+    val.m_negative = ( m_mag != 0 ) ? !m_negative : false;
+    return val;
+  }
+
+  //! Like fixpoint_add.
+  static constexpr result_t add( fixpoint &result, const fixpoint &left, const fixpoint &right ) {
+    bool lneg = left.m_negative && left.m_mag != 0;
+    bool rneg = right.m_negative && right.m_mag != 0;
+
+    if ( lneg == rneg ) {
+      wide_type sum = wide_type( left.m_mag ) + right.m_mag;
+      bool overflow = ( sum >> total_bits ) != 0;
+      result.m_mag = static_cast<storage_type>( sum & mag_mask );
+      // only an overflowed negative sum may be a negative zero
+      result.m_negative = lneg && ( result.m_mag != 0 || overflow );
+      return overflow ? RESULT_OVERFLOW : RESULT_OK;
+    }
+
+    const fixpoint &larger = ( left.m_mag >= right.m_mag ) ? left : right;
+    const fixpoint &smaller = ( left.m_mag >= right.m_mag ) ? right : left;
+    storage_type mag = static_cast<storage_type>( larger.m_mag - smaller.m_mag );
+    result.m_negative = ( mag != 0 ) && larger.m_negative;
+    result.m_mag = mag;
+    return RESULT_OK;
+  }
+
+  //! Like fixpoint_sub.
+  static constexpr result_t sub( fixpoint &result, const fixpoint &left, const fixpoint &right ) {
+    return add( result, left, right.negated() );
+  }
+
+  //! Like fixpoint_mul: the exact product is computed in a type twice
+  //! as wide, and its low FracBits and high IntBits bits are discarded.
+  static constexpr result_t mul( fixpoint &result, const fixpoint &left, const fixpoint &right ) {
+    bool lneg = left.m_negative && left.m_mag != 0;
+    bool rneg = right.m_negative && right.m_mag != 0;
+    product_type p = product_type( left.m_mag ) * right.m_mag;
+    bool overflow = ( p >> ( FracBits + total_bits ) ) != 0;
+    bool underflow = ( p & frac_mask ) != 0;
+
+    result.m_mag = static_cast<storage_type>( ( p >> FracBits ) & mag_mask );
+    result.m_negative = ( lneg != rneg ) && ( result.m_mag != 0 || overflow || underflow );
+    return ( overflow ? RESULT_OVERFLOW : 0 ) | ( underflow ? RESULT_UNDERFLOW : 0 );
+  }
+
+  //! Like fixpoint_compare, which compares the magnitudes.
+  static constexpr int compare( const fixpoint &left, const fixpoint &right ) {
+    return ( left.m_mag < right.m_mag ) ? -1 : ( left.m_mag > right.m_mag ) ? 1 : 0;
+  }
+
+  //! Like fixpoint_format_hex.
+  constexpr str_type format_hex() const {
+    str_type s{};
+    unsigned n = 0;
+    if ( m_negative )
+      s.str[n++] = '-';
+
+    storage_type w = whole();
+    int top = IntBits / 4 - 1;
+    while ( top > 0 && ( ( w >> ( 4 * top ) ) & 0xF ) == 0 )
+      top--; // no leading zeroes
+    for ( int d = top; d >= 0; d-- )
+      s.str[n++] = digits[( w >> ( 4 * d ) ) & 0xF];
+
+    s.str[n++] = '.';
+    storage_type f = frac();
+    int last = 0;
+    while ( last < int( FracBits / 4 ) - 1 && ( ( f >> ( 4 * last ) ) & 0xF ) == 0 )
+      last++; // no trailing zeroes
+    for ( int d = FracBits / 4 - 1; d >= last; d-- )
+      s.str[n++] = digits[( f >> ( 4 * d ) ) & 0xF];
+
+    s.str[n] = '\0';
+    return s;
+  }
+
+  //! Like fixpoint_parse_hex. Returns false if s is not well-formed.
+  static constexpr bool parse_hex( fixpoint &val, const char *s ) {
+    if ( !s )
+      return false;
+    bool neg = false;
+    if ( *s == '-' ) {
+      neg = true;
+      s++;
+    }
+
+    storage_type whole = 0, frac = 0;
+    unsigned ndig = 0;
+    for ( ; fixpoint_detail::hex_value( *s ) >= 0; s++, ndig++ ) {
+      if ( ndig == IntBits / 4 )
+        return false; // too many digits
+      whole = static_cast<storage_type>( ( wide_type( whole ) << 4 ) | fixpoint_detail::hex_value( *s ) );
+    }
+    if ( ndig == 0 || *s != '.' )
+      return false;
+    s++;
+
+    for ( ndig = 0; fixpoint_detail::hex_value( *s ) >= 0; s++, ndig++ ) {
+      if ( ndig == FracBits / 4 )
+        return false;
+      frac = static_cast<storage_type>( frac | ( wide_type( fixpoint_detail::hex_value( *s ) ) << ( FracBits - 4 * ( ndig + 1 ) ) ) );
+    }
+    if ( ndig == 0 || *s != '\0' )
+      return false;
+
+    val = from_parts( whole, frac, neg );
+    return true;
+  }
+
+  //! Conversions to and from the C type, for the Q32.32 format only.
+  template <unsigned I = IntBits, unsigned F = FracBits,
+            typename = std::enable_if_t<I == 32 && F == 32>>
+  static constexpr fixpoint from_c( const fixpoint_t &val ) {
+    fixpoint result;
+    result.m_mag = ( std::uint64_t( val.whole ) << 32 ) | val.frac;
+    result.m_negative = val.negative; // keep the bits exactly as they are
+    return result;
+  }
+
+  template <unsigned I = IntBits, unsigned F = FracBits,
+            typename = std::enable_if_t<I == 32 && F == 32>>
+  constexpr fixpoint_t to_c() const {
+    fixpoint_t val{};
+    val.whole = static_cast<std::uint32_t>( m_mag >> 32 );
+    val.frac = static_cast<std::uint32_t>( m_mag );
+    val.negative = m_negative;
+    return val;
+  }
+
+private:
+  using wide_type = fixpoint_detail::uint_least_t<total_bits + 1>;
+  using product_type = fixpoint_detail::uint_least_t<2 * total_bits>;
+
+  static constexpr storage_type mag_mask =
+    static_cast<storage_type>( ( wide_type( 1 ) << total_bits ) - 1 );
+  static constexpr storage_type frac_mask =
+    static_cast<storage_type>( ( wide_type( 1 ) << FracBits ) - 1 );
+  static constexpr storage_type int_mask =
+    static_cast<storage_type>( ( wide_type( 1 ) << IntBits ) - 1 );
+  static constexpr char digits[] = "0123456789abcdef";
+
+  storage_type m_mag;
+  bool m_negative;
+};
+
+#endif // FIXPOINT_HPP
@@ -0,0 +1,261 @@
+#include "fixpoint_atomic.h"
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+////////////////////////////////////////////////////////////////////////
+// Helper functions
+////////////////////////////////////////////////////////////////////////
+
+/**
+ * Packs a value into a two's complement word.
+ * param- val: the value.
+ * param- bits: set to the value times 2^32, wrapped around if it
+ *        doesn't fit.
+ * return- true if it fits.
+ */
+static bool to_bits(const fixpoint_t *val, int64_t *bits) {
+  uint64_t mag = ((uint64_t)val->whole << 32) | val->frac;
+  if (val->negative) {
+    *bits = (int64_t)(0 - mag);
+    return mag <= (UINT64_C(1) << 63);
+  }
+  *bits = (int64_t)mag;
+  return mag <= (uint64_t)INT64_MAX;
+}
+
+/**
+ * Unpacks a two's complement word.
+ * param- bits: the value times 2^32.
+ * param- val: set to the value.
+ */
+static void from_bits(int64_t bits, fixpoint_t *val) {
+  uint64_t mag = bits < 0 ? 0 - (uint64_t)bits : (uint64_t)bits;
+  val->whole = (uint32_t)(mag >> 32);
+  val->frac = (uint32_t)mag;
+  val->negative = bits < 0;
+}
+
+/**
+ * Records an overflow in the accumulator's sticky flag.
+ * param- acc: the accumulator.
+ * return- RESULT_OVERFLOW.
+ */
+static result_t set_overflow(fixpoint_atomic_t *acc) {
+  atomic_fetch_or_explicit(&acc->flags, RESULT_OVERFLOW, memory_order_relaxed);
+  return RESULT_OVERFLOW;
+}
+
+/**
+ * Atomically adds or subtracts a value.
+ * param- acc: the accumulator.
+ * param- val: the value to add or subtract.
+ * param- subtract: true to subtract.
+ * param- prev: set to the previous value (may be NULL).
+ * return- RESULT_OVERFLOW if val didn't fit or the result wrapped.
+ */
+static result_t add_or_sub(fixpoint_atomic_t *acc, const fixpoint_t *val,
+                           bool subtract, fixpoint_t *prev) {
+  int64_t delta, old, res;
+  bool fits = to_bits(val, &delta);
+  // atomic arithmetic on signed types wraps around (C11 7.17.7.5)
+  if (subtract) {
+    old = atomic_fetch_sub_explicit(&acc->bits, delta, memory_order_acq_rel);
+    res = (int64_t)((uint64_t)old - (uint64_t)delta);
+    // wrapped if the operands have different signs and the result
+    // doesn't have the sign of old
+    fits = fits && ((old ^ delta) & (old ^ res)) >= 0;
+  } else {
+    old = atomic_fetch_add_explicit(&acc->bits, delta, memory_order_acq_rel);
+    res = (int64_t)((uint64_t)old + (uint64_t)delta);
+    // wrapped if both operands have the other sign than the result
+    fits = fits && ((old ^ res) & (delta ^ res)) >= 0;
+  }
+  if (prev)
+    from_bits(old, prev);
+  return fits ? RESULT_OK : set_overflow(acc);
+}
+
+// Cells are 128 bytes apart: x86 CPUs fetch cache lines in pairs, so
+// cells on neighboring 64 byte lines would still contend.
+#define CELL_ALIGN 128
+#define MAX_DEFAULT_CELLS 256
+
+// One cell of a sharded accumulator. The value added to it is
+// (whole + whole_carry * 2^64) * 2^32 + frac + frac_carry * 2^64;
+// the carries count the times the signed 64 bit sums wrapped around.
+typedef struct {
+  _Alignas(CELL_ALIGN) _Atomic int64_t whole;
+  _Atomic int64_t frac;
+  _Atomic int64_t whole_carry;
+  _Atomic int64_t frac_carry;
+} adder_cell_t;
+
+// Cell index of each thread (0 until the thread's first add)
+static _Atomic unsigned next_thread_index;
+static _Thread_local unsigned thread_index;
+
+/**
+ * Atomically adds to one part of a cell, counting a wraparound.
+ * param- sum: the part.
+ * param- carry: its carry count.
+ * param- delta: the value to add.
+ */
+static inline void cell_add(_Atomic int64_t *sum, _Atomic int64_t *carry,
+                            int64_t delta) {
+  if (!delta)
+    return;
+  int64_t old = atomic_fetch_add_explicit(sum, delta, memory_order_relaxed);
+  int64_t res = (int64_t)((uint64_t)old + (uint64_t)delta);
+  if (((old ^ res) & (delta ^ res)) < 0)
+    atomic_fetch_add_explicit(carry, delta < 0 ? -1 : 1, memory_order_relaxed);
+}
+
+/**
+ * Adds a value to the calling thread's cell.
+ * param- adder: the accumulator.
+ * param- val: the value.
+ * param- negate: true to subtract it instead.
+ */
+static void adder_add(fixpoint_adder_t *adder, const fixpoint_t *val,
+                      bool negate) {
+  unsigned i = thread_index;
+  if (!i)
+    thread_index = i =
+        atomic_fetch_add_explicit(&next_thread_index, 1, memory_order_relaxed) + 1;
+  adder_cell_t *cell = (adder_cell_t *)adder->cells + (i & (adder->ncells - 1));
+  bool neg = val->negative != negate;
+  int64_t whole = val->whole, frac = val->frac;
+  cell_add(&cell->whole, &cell->whole_carry, neg ? -whole : whole);
+  cell_add(&cell->frac, &cell->frac_carry, neg ? -frac : frac);
+}
+
+////////////////////////////////////////////////////////////////////////
+// Public functions
+////////////////////////////////////////////////////////////////////////
+
+bool fixpoint_atomic_fits(const fixpoint_t *val) {
+  int64_t bits;
+  return to_bits(val, &bits);
+}
+
+result_t fixpoint_atomic_init(fixpoint_atomic_t *acc, const fixpoint_t *val) {
+  int64_t bits;
+  bool fits = to_bits(val, &bits);
+  atomic_init(&acc->bits, bits);
+  atomic_init(&acc->flags, fits ? RESULT_OK : RESULT_OVERFLOW);
+  return fits ? RESULT_OK : RESULT_OVERFLOW;
+}
+
+result_t fixpoint_atomic_load(fixpoint_atomic_t *acc, fixpoint_t *val) {
+  from_bits(atomic_load_explicit(&acc->bits, memory_order_acquire), val);
+  return (result_t)atomic_load_explicit(&acc->flags, memory_order_relaxed);
+}
+
+result_t fixpoint_atomic_store(fixpoint_atomic_t *acc, const fixpoint_t *val) {
+  int64_t bits;
+  bool fits = to_bits(val, &bits);
+  atomic_store_explicit(&acc->bits, bits, memory_order_release);
+  return fits ? RESULT_OK : set_overflow(acc);
+}
+
+result_t fixpoint_atomic_add(fixpoint_atomic_t *acc, const fixpoint_t *val,
+                             fixpoint_t *prev) {
+  return add_or_sub(acc, val, false, prev);
+}
+
+result_t fixpoint_atomic_sub(fixpoint_atomic_t *acc, const fixpoint_t *val,
+                             fixpoint_t *prev) {
+  return add_or_sub(acc, val, true, prev);
+}
+
+bool fixpoint_atomic_compare_exchange(fixpoint_atomic_t *acc, fixpoint_t *expected,
+                                      const fixpoint_t *desired) {
+  int64_t want, next;
+  bool fits = to_bits(desired, &next);
+  // an expected value that doesn't fit can't match (but its wrapped
+  // bits could)
+  if (!to_bits(expected, &want)) {
+    from_bits(atomic_load_explicit(&acc->bits, memory_order_acquire), expected);
+    return false;
+  }
+  if (atomic_compare_exchange_strong_explicit(&acc->bits, &want, next,
+                                              memory_order_acq_rel,
+                                              memory_order_acquire)) {
+    if (!fits) // the wrapped value was stored, as by fixpoint_atomic_store
+      set_overflow(acc);
+    return true;
+  }
+  from_bits(want, expected);
+  return false;
+}
+
+result_t fixpoint_atomic_clear_flags(fixpoint_atomic_t *acc) {
+  return (result_t)atomic_exchange_explicit(&acc->flags, RESULT_OK,
+                                            memory_order_relaxed);
+}
+
+bool fixpoint_adder_init(fixpoint_adder_t *adder, size_t ncells) {
+  if (!ncells) {
+    long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    ncells = cpus > 0 ? (size_t)cpus : 1;
+    if (ncells > MAX_DEFAULT_CELLS)
+      ncells = MAX_DEFAULT_CELLS;
+  }
+  size_t n = 1;
+  while (n < ncells)
+    n *= 2;
+  adder->cells = aligned_alloc(CELL_ALIGN, n * sizeof(adder_cell_t));
+  if (!adder->cells)
+    return false;
+  adder->ncells = n;
+  memset(adder->cells, 0, n * sizeof(adder_cell_t));
+  return true;
+}
+
+void fixpoint_adder_add(fixpoint_adder_t *adder, const fixpoint_t *val) {
+  adder_add(adder, val, false);
+}
+
+void fixpoint_adder_sub(fixpoint_adder_t *adder, const fixpoint_t *val) {
+  adder_add(adder, val, true);
+}
+
+result_t fixpoint_adder_sum(fixpoint_adder_t *adder, fixpoint_t *result) {
+  // whole parts and fraction parts are merged separately, in units of
+  // 1 and 2^-32, and each fits easily in 128 bits
+  __int128 whole = 0, frac = 0;
+  adder_cell_t *cells = adder->cells;
+  for (size_t i = 0; i < adder->ncells; i++) {
+    whole += atomic_load_explicit(&cells[i].whole, memory_order_relaxed);
+    whole += (__int128)atomic_load_explicit(&cells[i].whole_carry,
+                                            memory_order_relaxed) << 64;
+    frac += atomic_load_explicit(&cells[i].frac, memory_order_relaxed);
+    frac += (__int128)atomic_load_explicit(&cells[i].frac_carry,
+                                           memory_order_relaxed) << 64;
+  }
+  // whole * 2^32 can't overflow unless some 2^95 values were added
+  __int128 total = whole * ((__int128)1 << 32) + frac;
+  unsigned __int128 mag = total < 0 ? -(unsigned __int128)total
+                                    : (unsigned __int128)total;
+  result->whole = (uint32_t)(mag >> 32);
+  result->frac = (uint32_t)mag;
+  result->negative = total < 0;
+  return (mag >> 64) ? RESULT_OVERFLOW : RESULT_OK;
+}
+
+void fixpoint_adder_reset(fixpoint_adder_t *adder) {
+  adder_cell_t *cells = adder->cells;
+  for (size_t i = 0; i < adder->ncells; i++) {
+    atomic_store_explicit(&cells[i].whole, 0, memory_order_relaxed);
+    atomic_store_explicit(&cells[i].frac, 0, memory_order_relaxed);
+    atomic_store_explicit(&cells[i].whole_carry, 0, memory_order_relaxed);
+    atomic_store_explicit(&cells[i].frac_carry, 0, memory_order_relaxed);
+  }
+}
+
+void fixpoint_adder_cleanup(fixpoint_adder_t *adder) {
+  free(adder->cells);
+  adder->cells = NULL;
+  adder->ncells = 0;
+}
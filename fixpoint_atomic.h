@@ -0,0 +1,196 @@
+#ifndef FIXPOINT_ATOMIC_H
+#define FIXPOINT_ATOMIC_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdatomic.h>
+#include "fixpoint.h"
+
+////////////////////////////////////////////////////////////////////////
+// Lock-free accumulator
+////////////////////////////////////////////////////////////////////////
+
+// fixpoint_atomic_t holds a value that many threads can update without
+// a lock, e.g. a shared total. The value is packed into one 64 bit
+// two's complement word with 32 fraction bits (like fixpoint_t), so
+// add and sub are a single atomic fetch-and-add, and load, store and
+// compare-exchange are single atomic operations on that word.
+//
+// Packing the sign into the word halves the range: values from -2^31
+// to 2^31 - 2^-32 fit, where fixpoint_t goes up to 2^32 - 2^-32 either
+// way. Values in that range convert to and from fixpoint_t exactly (a
+// negative zero is stored as zero). An operation whose result doesn't
+// fit wraps around modulo 2^32, sign included (the word is two's
+// complement, so a total past 2^31 comes back negative); this differs
+// from fixpoint_add, which keeps the sign and truncates the magnitude.
+// Such an operation returns RESULT_OVERFLOW and sets an overflow flag
+// in the accumulator that stays set until it is cleared, so a total
+// can be checked once after all threads are done. There is no
+// underflow: sums of values with 32 fraction bits are exact.
+//
+// This is a C11 interface; it isn't available to C++.
+
+//! A fixpoint value that can be updated atomically.
+typedef struct {
+  _Atomic int64_t bits;     //!< the value, times 2^32
+  _Atomic unsigned flags;   //!< RESULT_OVERFLOW once anything overflowed
+} fixpoint_atomic_t;
+
+//! Check whether a value is in the range of fixpoint_atomic_t.
+//!
+//! @param val the value
+//! @return true if it can be stored exactly
+bool
+fixpoint_atomic_fits( const fixpoint_t *val );
+
+//! Initialize an accumulator (not atomically; no other thread may use
+//! it yet) and clear its overflow flag.
+//!
+//! @param acc the accumulator
+//! @param val the initial value
+//! @return RESULT_OVERFLOW if val doesn't fit (the stored value
+//!         wraps around), RESULT_OK otherwise
+result_t
+fixpoint_atomic_init( fixpoint_atomic_t *acc, const fixpoint_t *val );
+
+//! Atomically read an accumulator.
+//!
+//! @param acc the accumulator
+//! @param val set to its value
+//! @return RESULT_OVERFLOW if any operation on the accumulator
+//!         overflowed since it was initialized or its flag was
+//!         cleared, RESULT_OK otherwise
+result_t
+fixpoint_atomic_load( fixpoint_atomic_t *acc, fixpoint_t *val );
+
+//! Atomically replace the value of an accumulator.
+//!
+//! @param acc the accumulator
+//! @param val the new value
+//! @return RESULT_OVERFLOW if val doesn't fit (the stored value wraps
+//!         around), RESULT_OK otherwise
+result_t
+fixpoint_atomic_store( fixpoint_atomic_t *acc, const fixpoint_t *val );
+
+//! Atomically add a value to an accumulator.
+//!
+//! @param acc the accumulator
+//! @param val the value to add
+//! @param prev set to the value before the addition (may be NULL)
+//! @return RESULT_OVERFLOW if val doesn't fit or the sum doesn't fit
+//!         (the stored sum wraps around), RESULT_OK otherwise
+result_t
+fixpoint_atomic_add( fixpoint_atomic_t *acc, const fixpoint_t *val, fixpoint_t *prev );
+
+//! Atomically subtract a value from an accumulator.
+//!
+//! @param acc the accumulator
+//! @param val the value to subtract
+//! @param prev set to the value before the subtraction (may be NULL)
+//! @return RESULT_OVERFLOW if val doesn't fit or the difference doesn't
+//!         fit (the stored difference wraps around), RESULT_OK otherwise
+result_t
+fixpoint_atomic_sub( fixpoint_atomic_t *acc, const fixpoint_t *val, fixpoint_t *prev );
+
+//! Atomically replace the value of an accumulator if it equals an
+//! expected value (numerically, so zero matches negative zero).
+//!
+//! @param acc the accumulator
+//! @param expected the expected value; if the accumulator has a
+//!                 different value, set to that value
+//! @param desired the new value; if it doesn't fit, the stored value
+//!                wraps around and the overflow flag is set, as with
+//!                fixpoint_atomic_store
+//! @return true if the value was replaced
+bool
+fixpoint_atomic_compare_exchange( fixpoint_atomic_t *acc, fixpoint_t *expected,
+                                  const fixpoint_t *desired );
+
+//! Clear the overflow flag of an accumulator.
+//!
+//! @param acc the accumulator
+//! @return the flag before it was cleared (RESULT_OVERFLOW or RESULT_OK)
+result_t
+fixpoint_atomic_clear_flags( fixpoint_atomic_t *acc );
+
+////////////////////////////////////////////////////////////////////////
+// Sharded accumulator
+////////////////////////////////////////////////////////////////////////
+
+// Under heavy contention even a single atomic add is slow, since every
+// thread needs the accumulator's cache line. fixpoint_adder_t spreads
+// the total over cells, each on its own cache lines; each thread adds
+// to one cell (threads are assigned cells round robin on first use),
+// so with at least as many cells as threads an add never contends.
+// fixpoint_adder_sum merges the cells.
+//
+// Each cell keeps the whole and fraction parts of the values added to
+// it as separate signed 64 bit sums with carry counts, so the total is
+// exact no matter how many values are added, and it has the full
+// range of fixpoint_t. The sum is truncated once, with the result and
+// flag rules of fixpoint_add: when the total fits, the result is
+// exactly what a sequence of fixpoint_add calls without intermediate
+// overflow gives; otherwise RESULT_OVERFLOW is returned with the
+// magnitude truncated to 64 bits. (A running total that goes out of
+// range and comes back is not an overflow, as in fixpoint_gemm.)
+//
+// fixpoint_adder_sum is not an atomic snapshot: adds that run
+// concurrently with it may or may not be included (or, as an add
+// updates two parts, be half included). Once the adding threads are
+// done, the sum is exact.
+
+//! A sharded accumulator. The fields are managed by the fixpoint_adder_
+//! functions and should not be accessed directly.
+typedef struct {
+  size_t ncells; //!< number of cells (a power of 2)
+  void *cells;   //!< the cells, each on its own cache lines
+} fixpoint_adder_t;
+
+//! Initialize a sharded accumulator to zero.
+//!
+//! @param adder pointer to the fixpoint_adder_t instance to initialize
+//! @param ncells number of cells (rounded up to a power of 2), or 0 for
+//!               one per online CPU
+//! @return true if successful, false if memory could not be allocated
+bool
+fixpoint_adder_init( fixpoint_adder_t *adder, size_t ncells );
+
+//! Add a value to a sharded accumulator (any thread may call this
+//! concurrently).
+//!
+//! @param adder pointer to an initialized fixpoint_adder_t instance
+//! @param val the value to add
+void
+fixpoint_adder_add( fixpoint_adder_t *adder, const fixpoint_t *val );
+
+//! Subtract a value from a sharded accumulator (any thread may call
+//! this concurrently).
+//!
+//! @param adder pointer to an initialized fixpoint_adder_t instance
+//! @param val the value to subtract
+void
+fixpoint_adder_sub( fixpoint_adder_t *adder, const fixpoint_t *val );
+
+//! Compute the total of a sharded accumulator.
+//!
+//! @param adder pointer to an initialized fixpoint_adder_t instance
+//! @param result set to the total (truncated if it overflows)
+//! @return RESULT_OK or RESULT_OVERFLOW
+result_t
+fixpoint_adder_sum( fixpoint_adder_t *adder, fixpoint_t *result );
+
+//! Set a sharded accumulator back to zero. Adds that run concurrently
+//! may be partly lost.
+//!
+//! @param adder pointer to an initialized fixpoint_adder_t instance
+void
+fixpoint_adder_reset( fixpoint_adder_t *adder );
+
+//! Free the memory used by a sharded accumulator.
+//!
+//! @param adder pointer to an initialized fixpoint_adder_t instance
+void
+fixpoint_adder_cleanup( fixpoint_adder_t *adder );
+
+#endif // FIXPOINT_ATOMIC_H
@@ -0,0 +1,1007 @@
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <getopt.h>
+#include <sched.h>
+#include <pthread.h>
+#include <unistd.h>
+#include "bench.h"
+#include "fixpoint.h"
+#include "fixpoint_atomic.h"
+#include "fixpoint_expr.h"
+
+// Benchmark driver for the fixpoint operations and kernels.
+// Usage: fixpoint_bench [ops|kernels|all] [size [threads]]
+//        fixpoint_bench counters [adds [threads]]
+//        fixpoint_bench compare [-b baseline.json] [-s save.json] [-t trials]
+//                               [-w warmup] [-c cpu] [-a alpha] [-r threshold]
+//
+// "ops" measures every scalar operation in ns, cycles, instructions and
+// branch misses per operation on several input distributions, next to
+// double, int64_t and __int128 baselines; "kernels" compares the dense
+// kernels with the equivalent scalar loops.
+//
+// "counters" has 1, 2, 4, ... up to threads (default twice the CPUs)
+// threads each add adds values (default 2^20) to one shared total,
+// protected by a mutex, as a fixpoint_atomic_t and as a
+// fixpoint_adder_t.
+//
+// "compare" is for catching performance regressions: it pins itself to
+// one CPU (-c, default the current one, -1 to not pin), records -t
+// samples (default 30) of each fixpoint function on each distribution
+// after -w warmup trials (default 3), and drops outliers. The trials of
+// the different functions are interleaved, so that slow drifts of the
+// machine's speed spread over all samples instead of shifting some
+// functions' samples. -s saves the samples as a JSON baseline. With -b,
+// each function is compared with the baseline using a one-sided
+// Mann-Whitney U test, and it is a regression if it is significantly
+// slower (p < alpha, default 0.01), its median is more than the
+// threshold slower (-r, default 0.05, i.e. 5%), and its lower quartile
+// is above the baseline's upper quartile. The exit status is 1 if there
+// is any regression. Run it on an otherwise idle machine; on a shared
+// one, raise -t and -r.
+//
+// Each round of trials starts with a control kernel that the library
+// can't make slower or faster (the int64_t and double loops of "ops"),
+// and the baseline holds its samples too. If the control itself passes
+// the test for a change, the machine (its clock speed, its load, or the
+// machine itself) is not the one the baseline was recorded on, and no
+// verdict is given: the exit status is 2, as for a baseline without
+// control samples.
+
+// The straightforward way to multiply matrices with the scalar API
+static result_t gemm_scalar( fixpoint_t *c, const fixpoint_t *a, const fixpoint_t *b,
+                             size_t m, size_t n, size_t k ) {
+  result_t flags = RESULT_OK;
+  for ( size_t i = 0; i < m; i++ ) {
+    for ( size_t j = 0; j < n; j++ ) {
+      fixpoint_t sum, prod;
+      fixpoint_init( &sum, 0, 0, false );
+      for ( size_t p = 0; p < k; p++ ) {
+        flags |= fixpoint_mul( &prod, &a[i * k + p], &b[p * n + j] );
+        flags |= fixpoint_add( &sum, &sum, &prod );
+      }
+      c[i * n + j] = sum;
+    }
+  }
+  return flags;
+}
+
+// Multiply two size x size matrices with the scalar loop and with
+// fixpoint_gemm, reporting GOPS (one multiply-add counts as 2 ops)
+static void bench_gemm( size_t size, unsigned nthreads ) {
+  fixpoint_t *a = malloc( size * size * sizeof( fixpoint_t ) );
+  fixpoint_t *b = malloc( size * size * sizeof( fixpoint_t ) );
+  fixpoint_t *c = malloc( size * size * sizeof( fixpoint_t ) );
+  if ( !a || !b || !c ) {
+    fprintf( stderr, "out of memory\n" );
+    exit( 1 );
+  }
+  uint64_t state = 42;
+  bench_fill_random( a, size * size, &state );
+  bench_fill_random( b, size * size, &state );
+  double ops = 2.0 * size * size * size;
+
+  double start = bench_now_sec();
+  gemm_scalar( c, a, b, size, size, size );
+  double scalar = bench_now_sec() - start;
+
+  start = bench_now_sec();
+  fixpoint_gemm( c, a, b, size, size, size, nthreads );
+  double gemm = bench_now_sec() - start;
+
+  printf( "gemm %zux%zu  scalar: %8.3f GOPS  fixpoint_gemm(%u threads): %8.3f GOPS  (%.1fx)\n",
+          size, size, ops / scalar * 1e-9, nthreads, ops / gemm * 1e-9, scalar / gemm );
+
+  free( a );
+  free( b );
+  free( c );
+}
+
+// Filter a stream with a FIR filter built from fixpoint_mul/fixpoint_add
+// and with fixpoint_fir_process, reporting millions of samples per second
+static void bench_fir( size_t ntaps, size_t nsamples ) {
+  fixpoint_t *taps = malloc( ntaps * sizeof( fixpoint_t ) );
+  fixpoint_t *in = malloc( nsamples * sizeof( fixpoint_t ) );
+  fixpoint_t *out = malloc( nsamples * sizeof( fixpoint_t ) );
+  if ( !taps || !in || !out ) {
+    fprintf( stderr, "out of memory\n" );
+    exit( 1 );
+  }
+  uint64_t state = 43;
+  bench_fill_random( taps, ntaps, &state );
+  bench_fill_random( in, nsamples, &state );
+
+  double start = bench_now_sec();
+  for ( size_t i = 0; i < nsamples; i++ ) {
+    fixpoint_t sum, prod;
+    fixpoint_init( &sum, 0, 0, false );
+    for ( size_t j = 0; j < ntaps && j <= i; j++ ) {
+      fixpoint_mul( &prod, &taps[j], &in[i - j] );
+      fixpoint_add( &sum, &sum, &prod );
+    }
+    out[i] = sum;
+  }
+  double scalar = bench_now_sec() - start;
+
+  fixpoint_fir_t fir;
+  if ( !fixpoint_fir_init( &fir, taps, ntaps ) ) {
+    fprintf( stderr, "out of memory\n" );
+    exit( 1 );
+  }
+  start = bench_now_sec();
+  for ( size_t i = 0; i < nsamples; i += 1024 )
+    fixpoint_fir_process( &fir, out + i, in + i, nsamples - i < 1024 ? nsamples - i : 1024 );
+  double fir_time = bench_now_sec() - start;
+  fixpoint_fir_cleanup( &fir );
+
+  printf( "fir %zu taps  scalar: %8.3f Msamples/s  fixpoint_fir_process: %8.3f Msamples/s  (%.1fx)\n",
+          ntaps, nsamples / scalar * 1e-6, nsamples / fir_time * 1e-6, scalar / fir_time );
+
+  free( taps );
+  free( in );
+  free( out );
+}
+
+// Evaluate a degree 9 polynomial with a fixpoint_mul/fixpoint_add
+// Horner loop and with fixpoint_poly_eval_n
+static void bench_poly( size_t npoints ) {
+  enum { DEGREE = 9 };
+  fixpoint_t coeffs[DEGREE + 1];
+  fixpoint_t *x = malloc( npoints * sizeof( fixpoint_t ) );
+  fixpoint_t *out = malloc( npoints * sizeof( fixpoint_t ) );
+  if ( !x || !out ) {
+    fprintf( stderr, "out of memory\n" );
+    exit( 1 );
+  }
+  uint64_t state = 44;
+  bench_fill_random( coeffs, DEGREE + 1, &state );
+  for ( size_t i = 0; i < npoints; i++ ) // points in (-1, 1)
+    fixpoint_init( &x[i], 0, (uint32_t) bench_rand( &state ), bench_rand( &state ) & 1 );
+
+  double start = bench_now_sec();
+  for ( size_t i = 0; i < npoints; i++ ) {
+    fixpoint_t acc = coeffs[DEGREE];
+    for ( int d = DEGREE - 1; d >= 0; d-- ) {
+      fixpoint_mul( &acc, &acc, &x[i] );
+      fixpoint_add( &acc, &acc, &coeffs[d] );
+    }
+    out[i] = acc;
+  }
+  double scalar = bench_now_sec() - start;
+
+  start = bench_now_sec();
+  fixpoint_poly_eval_n( coeffs, DEGREE, x, out, npoints );
+  double poly = bench_now_sec() - start;
+
+  printf( "poly degree %d  scalar: %8.3f Mpoints/s  fixpoint_poly_eval_n: %8.3f Mpoints/s  (%.1fx)\n",
+          DEGREE, npoints / scalar * 1e-6, npoints / poly * 1e-6, scalar / poly );
+
+  free( x );
+  free( out );
+}
+
+// Columns, compiled formula and output for bench_expr
+typedef struct {
+  fixpoint_t *cols[4];
+  fixpoint_t *out;
+  fixpoint_expr_t *e;
+  size_t n;
+} expr_ctx_t;
+
+static void expr_scalar( void *arg ) {
+  expr_ctx_t *ctx = arg;
+  fixpoint_t half;
+  fixpoint_init( &half, 0, 0x80000000, false );
+  for ( size_t i = 0; i < ctx->n; i++ ) {
+    fixpoint_t ab, dh;
+    fixpoint_mul( &ab, &ctx->cols[0][i], &ctx->cols[1][i] );
+    fixpoint_add( &ctx->out[i], &ab, &ctx->cols[2][i] );
+    fixpoint_mul( &dh, &ctx->cols[3][i], &half );
+    fixpoint_sub( &ctx->out[i], &ctx->out[i], &dh );
+  }
+}
+
+static void expr_vm( void *arg ) {
+  expr_ctx_t *ctx = arg;
+  fixpoint_expr_eval( ctx->e, ctx->out, (const fixpoint_t *const *) ctx->cols, ctx->n );
+}
+
+// Evaluate "a*b + c - d*0.5" with a hand-written scalar loop and
+// with the bytecode interpreter (each warmed up and timed best of
+// EXPR_REPS runs), and check that both give the same results
+static void bench_expr( size_t n ) {
+  enum { EXPR_REPS = 5 };
+  const char *vars[] = { "a", "b", "c", "d" };
+  expr_ctx_t ctx = { .n = n };
+  fixpoint_t *scalar_out = malloc( n * sizeof( fixpoint_t ) );
+  fixpoint_t *vm_out = malloc( n * sizeof( fixpoint_t ) );
+  uint64_t state = 45;
+  if ( !scalar_out || !vm_out ) {
+    fprintf( stderr, "out of memory\n" );
+    exit( 1 );
+  }
+  for ( int i = 0; i < 4; i++ ) {
+    ctx.cols[i] = malloc( n * sizeof( fixpoint_t ) );
+    if ( !ctx.cols[i] ) {
+      fprintf( stderr, "out of memory\n" );
+      exit( 1 );
+    }
+    bench_fill_random( ctx.cols[i], n, &state );
+  }
+  ctx.e = fixpoint_expr_compile( "a*b + c - d*0.5", vars, 4, NULL );
+  if ( !ctx.e ) {
+    fprintf( stderr, "expr: could not compile the formula\n" );
+    exit( 1 );
+  }
+
+  bench_cost_t scalar, vm;
+  ctx.out = scalar_out;
+  bench_measure( &scalar, NULL, expr_scalar, &ctx, n, EXPR_REPS );
+  ctx.out = vm_out;
+  bench_measure( &vm, NULL, expr_vm, &ctx, n, EXPR_REPS );
+  fixpoint_expr_destroy( ctx.e );
+
+  for ( size_t i = 0; i < n; i++ ) {
+    if ( scalar_out[i].whole != vm_out[i].whole || scalar_out[i].frac != vm_out[i].frac ||
+         scalar_out[i].negative != vm_out[i].negative ) {
+      fprintf( stderr, "expr: row %zu differs: scalar %s%08x.%08x, fixpoint_expr_eval %s%08x.%08x\n",
+               i, scalar_out[i].negative ? "-" : "", scalar_out[i].whole, scalar_out[i].frac,
+               vm_out[i].negative ? "-" : "", vm_out[i].whole, vm_out[i].frac );
+      exit( 1 );
+    }
+  }
+
+  printf( "expr a*b+c-d*0.5  scalar: %8.3f Mrows/s  fixpoint_expr_eval: %8.3f Mrows/s  (%.1fx)\n",
+          1e3 / scalar.ns, 1e3 / vm.ns, scalar.ns / vm.ns );
+
+  for ( int i = 0; i < 4; i++ )
+    free( ctx.cols[i] );
+  free( scalar_out );
+  free( vm_out );
+}
+
+// Add two arrays while keeping track of which elements overflowed:
+// checking each fixpoint_add result versus a sticky status
+static void bench_status( size_t n ) {
+  fixpoint_t *a = malloc( n * sizeof( fixpoint_t ) );
+  fixpoint_t *b = malloc( n * sizeof( fixpoint_t ) );
+  fixpoint_t *out = malloc( n * sizeof( fixpoint_t ) );
+  uint64_t *bits = malloc( FIXPOINT_STATUS_WORDS( n ) * sizeof( uint64_t ) );
+  if ( !a || !b || !out || !bits ) {
+    fprintf( stderr, "out of memory\n" );
+    exit( 1 );
+  }
+  uint64_t state = 46;
+  for ( size_t i = 0; i < n; i++ ) { // about 1 in 4 sums overflow
+    uint64_t r = bench_rand( &state );
+    fixpoint_init( &a[i], (uint32_t) ( r >> 32 ) | 0x80000000, (uint32_t) r, false );
+    fixpoint_init( &b[i], (uint32_t) ( r >> 34 ), (uint32_t) r, false );
+  }
+
+  memset( bits, 0, FIXPOINT_STATUS_WORDS( n ) * sizeof( uint64_t ) );
+  double start = bench_now_sec();
+  size_t count = 0;
+  for ( size_t i = 0; i < n; i++ ) {
+    if ( fixpoint_add( &out[i], &a[i], &b[i] ) & RESULT_OVERFLOW ) {
+      bits[i / 64] |= (uint64_t) 1 << ( i % 64 );
+      count++;
+    }
+  }
+  double scalar = bench_now_sec() - start;
+
+  fixpoint_status_t st;
+  fixpoint_status_init( &st, bits, NULL, n );
+  start = bench_now_sec();
+  fixpoint_add_n_status( out, a, b, n, &st );
+  double sticky = bench_now_sec() - start;
+
+  printf( "add with overflow tracking (%zu overflows)  scalar: %8.3f Mops/s  fixpoint_add_n_status: %8.3f Mops/s  (%.1fx)\n",
+          count, n / scalar * 1e-6, n / sticky * 1e-6, scalar / sticky );
+
+  free( a );
+  free( b );
+  free( out );
+  free( bits );
+}
+
+////////////////////////////////////////////////////////////////////////
+// Shared totals
+////////////////////////////////////////////////////////////////////////
+
+enum { COUNTER_MUTEX, COUNTER_ATOMIC, COUNTER_ADDER, NUM_COUNTERS };
+
+static const char *const counter_names[NUM_COUNTERS] = { "mutex", "fixpoint_atomic_t",
+                                                         "fixpoint_adder_t" };
+
+typedef struct {
+  int kind;
+  size_t adds;
+  pthread_barrier_t start;
+  pthread_mutex_t lock;
+  fixpoint_t total;
+  fixpoint_atomic_t atomic;
+  fixpoint_adder_t adder;
+} counter_ctx_t;
+
+typedef struct {
+  counter_ctx_t *ctx;
+  double start, end; // when the thread started and finished adding
+} counter_thread_t;
+
+static void *counter_thread( void *arg ) {
+  counter_thread_t *self = arg;
+  counter_ctx_t *ctx = self->ctx;
+  fixpoint_t val;
+  fixpoint_init( &val, 0, 0x10000, false );
+  pthread_barrier_wait( &ctx->start );
+  self->start = bench_now_sec();
+  for ( size_t i = 0; i < ctx->adds; i++ ) {
+    switch ( ctx->kind ) {
+    case COUNTER_MUTEX:
+      pthread_mutex_lock( &ctx->lock );
+      fixpoint_add( &ctx->total, &ctx->total, &val );
+      pthread_mutex_unlock( &ctx->lock );
+      break;
+    case COUNTER_ATOMIC:
+      fixpoint_atomic_add( &ctx->atomic, &val, NULL );
+      break;
+    default:
+      fixpoint_adder_add( &ctx->adder, &val );
+      break;
+    }
+  }
+  self->end = bench_now_sec();
+  return NULL;
+}
+
+// Time nthreads threads adding to one total, returning millions of
+// adds per second; the total is checked
+static double bench_counter( int kind, size_t adds, unsigned nthreads ) {
+  counter_ctx_t ctx;
+  pthread_t *threads = malloc( nthreads * sizeof( pthread_t ) );
+  counter_thread_t *args = malloc( nthreads * sizeof( counter_thread_t ) );
+  if ( !threads || !args || !fixpoint_adder_init( &ctx.adder, 0 ) ) {
+    fprintf( stderr, "out of memory\n" );
+    exit( 1 );
+  }
+  ctx.kind = kind;
+  ctx.adds = adds;
+  pthread_barrier_init( &ctx.start, NULL, nthreads + 1 );
+  pthread_mutex_init( &ctx.lock, NULL );
+  fixpoint_init( &ctx.total, 0, 0, false );
+  fixpoint_atomic_init( &ctx.atomic, &ctx.total );
+
+  for ( unsigned t = 0; t < nthreads; t++ ) {
+    args[t].ctx = &ctx;
+    if ( pthread_create( &threads[t], NULL, counter_thread, &args[t] ) != 0 ) {
+      fprintf( stderr, "pthread_create failed\n" );
+      exit( 1 );
+    }
+  }
+  pthread_barrier_wait( &ctx.start );
+  double start = 0, end = 0;
+  for ( unsigned t = 0; t < nthreads; t++ ) {
+    pthread_join( threads[t], NULL );
+    if ( t == 0 || args[t].start < start )
+      start = args[t].start;
+    if ( args[t].end > end )
+      end = args[t].end;
+  }
+  double sec = end - start;
+
+  fixpoint_t total;
+  if ( kind == COUNTER_ATOMIC )
+    fixpoint_atomic_load( &ctx.atomic, &total );
+  else if ( kind == COUNTER_ADDER )
+    fixpoint_adder_sum( &ctx.adder, &total );
+  else
+    total = ctx.total;
+  uint64_t expected = (uint64_t) adds * nthreads * 0x10000; // in units of 2^-32
+  if ( ( ( (uint64_t) total.whole << 32 ) | total.frac ) != expected ) {
+    fprintf( stderr, "%s: wrong total\n", counter_names[kind] );
+    exit( 1 );
+  }
+
+  pthread_barrier_destroy( &ctx.start );
+  pthread_mutex_destroy( &ctx.lock );
+  fixpoint_adder_cleanup( &ctx.adder );
+  free( threads );
+  free( args );
+  return (double) adds * nthreads / sec * 1e-6;
+}
+
+static void bench_counters( size_t adds, unsigned max_threads ) {
+  if ( !max_threads ) {
+    long cpus = sysconf( _SC_NPROCESSORS_ONLN );
+    max_threads = cpus > 0 ? 2 * (unsigned) cpus : 2;
+  }
+  printf( "shared total, Madds/s  %8s", "threads" );
+  for ( int k = 0; k < NUM_COUNTERS; k++ )
+    printf( " %18s", counter_names[k] );
+  printf( "\n" );
+  for ( unsigned n = 1;; n *= 2 ) {
+    if ( n > max_threads )
+      n = max_threads; // the last row is always max_threads
+    printf( "%22s %8u", "", n );
+    for ( int k = 0; k < NUM_COUNTERS; k++ )
+      printf( " %18.2f", bench_counter( k, adds, n ) );
+    printf( "\n" );
+    if ( n == max_threads )
+      break;
+  }
+}
+
+////////////////////////////////////////////////////////////////////////
+// Per-operation costs
+////////////////////////////////////////////////////////////////////////
+
+#define OPS_N 4096
+#define OPS_REPS 20
+
+// Input distributions for the per-operation benchmarks
+enum {
+  DIST_RANDOM_SIGN,    // |x| < 2^16 with random signs: half the adds subtract
+  DIST_OVERFLOW_HEAVY, // |x| >= 2^31, same sign: sums and products overflow
+  DIST_SMALL,          // 0 <= x < 1: products underflow
+  NUM_DISTS
+};
+static const char *const dist_names[NUM_DISTS] = { "random-sign", "overflow-heavy", "small" };
+
+// Operands in every representation, and space for the results
+typedef struct {
+  fixpoint_t a[OPS_N], b[OPS_N], out[OPS_N];
+  fixpoint_str_t strs[OPS_N];
+  double da[OPS_N], db[OPS_N], dout[OPS_N];
+  int64_t ia[OPS_N], ib[OPS_N], iout[OPS_N];
+  __int128 wa[OPS_N], wb[OPS_N], wout[OPS_N];
+} ops_ctx_t;
+
+static void fill_dist( fixpoint_t *vals, size_t n, int dist, uint64_t *state ) {
+  for ( size_t i = 0; i < n; i++ ) {
+    uint64_t r = bench_rand( state );
+    switch ( dist ) {
+    case DIST_RANDOM_SIGN:
+      fixpoint_init( &vals[i], (uint32_t) ( r >> 48 ), (uint32_t) r, r & 0x100 );
+      break;
+    case DIST_OVERFLOW_HEAVY:
+      fixpoint_init( &vals[i], (uint32_t) ( r >> 32 ) | 0x80000000, (uint32_t) r, false );
+      break;
+    default:
+      fixpoint_init( &vals[i], 0, (uint32_t) r, false );
+      break;
+    }
+  }
+}
+
+static void ops_setup( ops_ctx_t *ctx, int dist ) {
+  uint64_t state = 47 + dist;
+  fill_dist( ctx->a, OPS_N, dist, &state );
+  fill_dist( ctx->b, OPS_N, dist, &state );
+  for ( size_t i = 0; i < OPS_N; i++ ) {
+    fixpoint_format_hex( &ctx->strs[i], &ctx->a[i] );
+    const fixpoint_t *x[2] = { &ctx->a[i], &ctx->b[i] };
+    double *d[2] = { &ctx->da[i], &ctx->db[i] };
+    int64_t *q[2] = { &ctx->ia[i], &ctx->ib[i] };
+    __int128 *w[2] = { &ctx->wa[i], &ctx->wb[i] };
+    for ( int k = 0; k < 2; k++ ) { // the same values as Q32.32 two's complement
+      uint64_t mag = ( (uint64_t) x[k]->whole << 32 ) | x[k]->frac;
+      *d[k] = ( x[k]->negative ? -1.0 : 1.0 ) * ( x[k]->whole + x[k]->frac * 0x1p-32 );
+      *q[k] = (int64_t) ( x[k]->negative ? 0 - mag : mag ); // wraps like the int64_t ops
+      *w[k] = x[k]->negative ? -(__int128) mag : (__int128) mag;
+    }
+  }
+}
+
+static void op_init( void *arg ) {
+  ops_ctx_t *ctx = arg;
+  for ( size_t i = 0; i < OPS_N; i++ )
+    fixpoint_init( &ctx->out[i], ctx->a[i].whole, ctx->b[i].frac, ctx->a[i].negative );
+}
+
+static void op_get_whole( void *arg ) {
+  ops_ctx_t *ctx = arg;
+  uint64_t sum = 0;
+  for ( size_t i = 0; i < OPS_N; i++ )
+    sum += fixpoint_get_whole( &ctx->a[i] );
+  bench_sink( sum );
+}
+
+static void op_get_frac( void *arg ) {
+  ops_ctx_t *ctx = arg;
+  uint64_t sum = 0;
+  for ( size_t i = 0; i < OPS_N; i++ )
+    sum += fixpoint_get_frac( &ctx->a[i] );
+  bench_sink( sum );
+}
+
+static void op_is_negative( void *arg ) {
+  ops_ctx_t *ctx = arg;
+  uint64_t count = 0;
+  for ( size_t i = 0; i < OPS_N; i++ )
+    count += fixpoint_is_negative( &ctx->a[i] );
+  bench_sink( count );
+}
+
+static void op_negate( void *arg ) {
+  ops_ctx_t *ctx = arg;
+  for ( size_t i = 0; i < OPS_N; i++ ) {
+    ctx->out[i] = ctx->a[i];
+    fixpoint_negate( &ctx->out[i] );
+  }
+}
+
+static void op_add( void *arg ) {
+  ops_ctx_t *ctx = arg;
+  for ( size_t i = 0; i < OPS_N; i++ )
+    fixpoint_add( &ctx->out[i], &ctx->a[i], &ctx->b[i] );
+}
+
+static void op_sub( void *arg ) {
+  ops_ctx_t *ctx = arg;
+  for ( size_t i = 0; i < OPS_N; i++ )
+    fixpoint_sub( &ctx->out[i], &ctx->a[i], &ctx->b[i] );
+}
+
+static void op_mul( void *arg ) {
+  ops_ctx_t *ctx = arg;
+  for ( size_t i = 0; i < OPS_N; i++ )
+    fixpoint_mul( &ctx->out[i], &ctx->a[i], &ctx->b[i] );
+}
+
+static void op_compare( void *arg ) {
+  ops_ctx_t *ctx = arg;
+  uint64_t sum = 0;
+  for ( size_t i = 0; i < OPS_N; i++ )
+    sum += fixpoint_compare( &ctx->a[i], &ctx->b[i] );
+  bench_sink( sum );
+}
+
+static void op_format_hex( void *arg ) {
+  ops_ctx_t *ctx = arg;
+  fixpoint_str_t s;
+  for ( size_t i = 0; i < OPS_N; i++ ) {
+    fixpoint_format_hex( &s, &ctx->a[i] );
+    bench_sink( (uint8_t) s.str[0] );
+  }
+}
+
+static void op_parse_hex( void *arg ) {
+  ops_ctx_t *ctx = arg;
+  for ( size_t i = 0; i < OPS_N; i++ )
+    fixpoint_parse_hex( &ctx->out[i], &ctx->strs[i] );
+}
+
+static void op_add_sat( void *arg ) {
+  ops_ctx_t *ctx = arg;
+  for ( size_t i = 0; i < OPS_N; i++ )
+    fixpoint_add_sat( &ctx->out[i], &ctx->a[i], &ctx->b[i] );
+}
+
+static void op_mul_sat( void *arg ) {
+  ops_ctx_t *ctx = arg;
+  for ( size_t i = 0; i < OPS_N; i++ )
+    fixpoint_mul_sat( &ctx->out[i], &ctx->a[i], &ctx->b[i] );
+}
+
+static void op_mul_rounded( void *arg ) {
+  ops_ctx_t *ctx = arg;
+  for ( size_t i = 0; i < OPS_N; i++ )
+    fixpoint_mul_rounded( &ctx->out[i], &ctx->a[i], &ctx->b[i], FIXPOINT_ROUND_NEAREST_EVEN );
+}
+
+static void op_add_n( void *arg ) {
+  ops_ctx_t *ctx = arg;
+  fixpoint_add_n( ctx->out, ctx->a, ctx->b, OPS_N );
+}
+
+static void op_mul_n( void *arg ) {
+  ops_ctx_t *ctx = arg;
+  fixpoint_mul_n( ctx->out, ctx->a, ctx->b, OPS_N );
+}
+
+// Baselines: the same values as double, int64_t (Q32.32) and __int128
+static void base_double_add( void *arg ) {
+  ops_ctx_t *ctx = arg;
+  for ( size_t i = 0; i < OPS_N; i++ )
+    ctx->dout[i] = ctx->da[i] + ctx->db[i];
+}
+
+static void base_double_mul( void *arg ) {
+  ops_ctx_t *ctx = arg;
+  for ( size_t i = 0; i < OPS_N; i++ )
+    ctx->dout[i] = ctx->da[i] * ctx->db[i];
+}
+
+static void base_int64_add( void *arg ) {
+  ops_ctx_t *ctx = arg;
+  for ( size_t i = 0; i < OPS_N; i++ )
+    ctx->iout[i] = (int64_t) ( (uint64_t) ctx->ia[i] + (uint64_t) ctx->ib[i] ); // wraps
+}
+
+static void base_int64_mul( void *arg ) {
+  ops_ctx_t *ctx = arg;
+  for ( size_t i = 0; i < OPS_N; i++ )
+    ctx->iout[i] = (int64_t) ( ( (__int128) ctx->ia[i] * ctx->ib[i] ) >> 32 );
+}
+
+static void base_int128_add( void *arg ) {
+  ops_ctx_t *ctx = arg;
+  for ( size_t i = 0; i < OPS_N; i++ )
+    ctx->wout[i] = ctx->wa[i] + ctx->wb[i];
+}
+
+static void base_int128_mul( void *arg ) {
+  ops_ctx_t *ctx = arg;
+  for ( size_t i = 0; i < OPS_N; i++ )
+    ctx->wout[i] = ( ctx->wa[i] * ctx->wb[i] ) >> 32;
+}
+
+static const struct {
+  const char *name;
+  void ( *fn )( void *arg );
+} bench_ops[] = {
+  { "fixpoint_init", op_init },
+  { "fixpoint_get_whole", op_get_whole },
+  { "fixpoint_get_frac", op_get_frac },
+  { "fixpoint_is_negative", op_is_negative },
+  { "fixpoint_negate", op_negate },
+  { "fixpoint_add", op_add },
+  { "fixpoint_sub", op_sub },
+  { "fixpoint_mul", op_mul },
+  { "fixpoint_compare", op_compare },
+  { "fixpoint_format_hex", op_format_hex },
+  { "fixpoint_parse_hex", op_parse_hex },
+  { "fixpoint_add_sat", op_add_sat },
+  { "fixpoint_mul_sat", op_mul_sat },
+  { "fixpoint_mul_rounded", op_mul_rounded },
+  { "fixpoint_add_n", op_add_n },
+  { "fixpoint_mul_n", op_mul_n },
+  { "double +", base_double_add },
+  { "double *", base_double_mul },
+  { "int64_t +", base_int64_add },
+  { "int64_t *", base_int64_mul },
+  { "__int128 +", base_int128_add },
+  { "__int128 *", base_int128_mul },
+};
+
+// Print a cost, or "-" if it couldn't be measured
+static void print_cost( double val ) {
+  if ( val < 0 )
+    printf( " %9s", "-" );
+  else
+    printf( " %9.2f", val );
+}
+
+// Measure every operation on every input distribution
+static void bench_ops_all( void ) {
+  ops_ctx_t *ctx = malloc( sizeof( ops_ctx_t ) );
+  if ( !ctx ) {
+    fprintf( stderr, "out of memory\n" );
+    exit( 1 );
+  }
+  bench_perf_t perf;
+  bool have_perf = bench_perf_open( &perf );
+  if ( !have_perf )
+    printf( "(hardware counters unavailable: perf_event_open failed)\n" );
+
+  printf( "%-22s %-15s %9s %9s %9s %9s\n", "operation", "inputs", "ns/op", "cycles/op",
+          "instr/op", "brmiss/op" );
+  for ( int dist = 0; dist < NUM_DISTS; dist++ ) {
+    ops_setup( ctx, dist );
+    for ( size_t i = 0; i < sizeof( bench_ops ) / sizeof( bench_ops[0] ); i++ ) {
+      bench_cost_t cost;
+      bench_measure( &cost, have_perf ? &perf : NULL, bench_ops[i].fn, ctx, OPS_N, OPS_REPS );
+      printf( "%-22s %-15s", bench_ops[i].name, dist_names[dist] );
+      print_cost( cost.ns );
+      print_cost( cost.cycles );
+      print_cost( cost.instructions );
+      print_cost( cost.branch_misses );
+      printf( "\n" );
+    }
+  }
+
+  bench_perf_close( &perf );
+  free( ctx );
+}
+
+////////////////////////////////////////////////////////////////////////
+// Regression comparison
+////////////////////////////////////////////////////////////////////////
+
+#define COMPARE_MAX_TRIALS 1000
+#define COMPARE_MAX_BENCHES 256
+#define COMPARE_TRIAL_SEC 0.002
+
+// Name of the control kernel's samples
+#define COMPARE_CONTROL "control"
+
+// Samples of one benchmark ("function/distribution")
+typedef struct {
+  char name[64];
+  size_t n;
+  double *samples; // sorted, outliers removed
+  void ( *fn )( void *arg );
+  ops_ctx_t *ctx;
+  size_t calls; // calls per trial
+  size_t nops;  // operations per call
+} compare_entry_t;
+
+// The control kernel: plain int64_t and double arithmetic
+static void control_kernel( void *arg ) {
+  base_int64_add( arg );
+  base_int64_mul( arg );
+  base_double_add( arg );
+  base_double_mul( arg );
+}
+
+// Set up the samples of a function for trials
+static void compare_entry_init( compare_entry_t *e, const char *name, void ( *fn )( void *arg ),
+                                ops_ctx_t *ctx, size_t nops, size_t trials ) {
+  snprintf( e->name, sizeof( e->name ), "%s", name );
+  e->fn = fn;
+  e->ctx = ctx;
+  e->nops = nops;
+  e->calls = bench_calibrate( fn, ctx, COMPARE_TRIAL_SEC );
+  e->n = 0;
+  if ( !( e->samples = malloc( trials * sizeof( double ) ) ) ) {
+    fprintf( stderr, "out of memory\n" );
+    exit( 2 );
+  }
+}
+
+// Find the samples of a benchmark by name (NULL if there are none)
+static const compare_entry_t *compare_find( const compare_entry_t *entries, size_t n,
+                                            const char *name ) {
+  for ( size_t i = 0; i < n; i++ )
+    if ( strcmp( entries[i].name, name ) == 0 )
+      return &entries[i];
+  return NULL;
+}
+
+// Compare samples with the baseline's: 1 if they are slower, -1 if
+// faster, 0 if neither can be told. change is set to the relative
+// change of the median and p to the p-value of the direction tested.
+static int compare_samples( const compare_entry_t *was, const compare_entry_t *now, double alpha,
+                            double threshold, double *change, double *p ) {
+  double was_med = bench_median( was->samples, was->n );
+  *change = ( bench_median( now->samples, now->n ) - was_med ) / was_med;
+  double p_slower = bench_mann_whitney_p( was->samples, was->n, now->samples, now->n );
+  double p_faster = bench_mann_whitney_p( now->samples, now->n, was->samples, was->n );
+  // the interquartile ranges must not overlap either: on a busy machine
+  // a burst of interference can make many samples slow at once, which
+  // the rank test alone would call significant
+  double now_q1 = bench_quantile( now->samples, now->n, 0.25 );
+  double now_q3 = bench_quantile( now->samples, now->n, 0.75 );
+  double was_q1 = bench_quantile( was->samples, was->n, 0.25 );
+  double was_q3 = bench_quantile( was->samples, was->n, 0.75 );
+  *p = p_slower;
+  if ( p_slower < alpha && *change > threshold && now_q1 > was_q3 )
+    return 1;
+  if ( p_faster < alpha && -*change > threshold && now_q3 < was_q1 ) {
+    *p = p_faster;
+    return -1;
+  }
+  return 0;
+}
+
+// Read a baseline written by save_baseline (only the fields used here
+// are parsed, so the file may be pretty-printed or have extra fields)
+static size_t load_baseline( const char *path, compare_entry_t *entries, size_t max ) {
+  FILE *f = fopen( path, "r" );
+  if ( !f ) {
+    perror( path );
+    exit( 2 );
+  }
+  fseek( f, 0, SEEK_END );
+  long size = ftell( f );
+  fseek( f, 0, SEEK_SET );
+  char *text = malloc( (size_t) size + 1 );
+  if ( !text || fread( text, 1, (size_t) size, f ) != (size_t) size ) {
+    fprintf( stderr, "%s: read failed\n", path );
+    exit( 2 );
+  }
+  text[size] = '\0';
+  fclose( f );
+
+  size_t n = 0;
+  const char *p = text;
+  while ( n < max && ( p = strstr( p, "\"name\"" ) ) ) {
+    compare_entry_t *e = &entries[n];
+    const char *q = strchr( p + 6, '"' ), *end = q ? strchr( q + 1, '"' ) : NULL;
+    const char *arr = end ? strstr( end, "\"samples\"" ) : NULL;
+    arr = arr ? strchr( arr, '[' ) : NULL;
+    if ( !arr || (size_t) ( end - q - 1 ) >= sizeof( e->name ) ) {
+      fprintf( stderr, "%s: malformed baseline\n", path );
+      exit( 2 );
+    }
+    memcpy( e->name, q + 1, (size_t) ( end - q - 1 ) );
+    e->name[end - q - 1] = '\0';
+
+    e->samples = malloc( COMPARE_MAX_TRIALS * sizeof( double ) );
+    e->n = 0;
+    p = arr + 1;
+    while ( e->samples && e->n < COMPARE_MAX_TRIALS ) {
+      char *next;
+      double v = strtod( p, &next );
+      if ( next == p )
+        break;
+      e->samples[e->n++] = v;
+      p = next;
+      while ( *p == ',' || *p == ' ' || *p == '\n' )
+        p++;
+    }
+    n++;
+  }
+  free( text );
+  return n;
+}
+
+static void save_baseline( const char *path, const compare_entry_t *entries, size_t n ) {
+  FILE *f = fopen( path, "w" );
+  if ( !f ) {
+    perror( path );
+    exit( 2 );
+  }
+  fprintf( f, "{\n  \"benchmarks\": [\n" );
+  for ( size_t i = 0; i < n; i++ ) {
+    fprintf( f, "    { \"name\": \"%s\", \"median_ns\": %.4f, \"samples\": [",
+             entries[i].name, bench_median( entries[i].samples, entries[i].n ) );
+    for ( size_t j = 0; j < entries[i].n; j++ )
+      fprintf( f, "%s%.4f", j ? ", " : "", entries[i].samples[j] );
+    fprintf( f, "] }%s\n", i + 1 < n ? "," : "" );
+  }
+  fprintf( f, "  ]\n}\n" );
+  if ( fclose( f ) != 0 ) {
+    perror( path );
+    exit( 2 );
+  }
+}
+
+static int bench_compare( int argc, char **argv ) {
+  const char *baseline = NULL, *save = NULL;
+  size_t trials = 30;
+  int warmup = 3, cpu = sched_getcpu();
+  double alpha = 0.01, threshold = 0.05;
+  int opt;
+  while ( ( opt = getopt( argc, argv, "b:s:t:w:c:a:r:" ) ) != -1 ) {
+    switch ( opt ) {
+    case 'b': baseline = optarg; break;
+    case 's': save = optarg; break;
+    case 't': trials = (size_t) strtoul( optarg, NULL, 10 ); break;
+    case 'w': warmup = atoi( optarg ); break;
+    case 'c': cpu = atoi( optarg ); break;
+    case 'a': alpha = atof( optarg ); break;
+    case 'r': threshold = atof( optarg ); break;
+    default:
+      fprintf( stderr, "Usage: fixpoint_bench compare [-b baseline.json] [-s save.json] [-t trials] "
+                       "[-w warmup] [-c cpu] [-a alpha] [-r threshold]\n" );
+      return 2;
+    }
+  }
+  if ( trials < 4 || trials > COMPARE_MAX_TRIALS ) {
+    fprintf( stderr, "trials must be between 4 and %d\n", COMPARE_MAX_TRIALS );
+    return 2;
+  }
+  if ( cpu >= 0 && !bench_pin_cpu( cpu ) )
+    fprintf( stderr, "warning: could not pin to CPU %d\n", cpu );
+
+  static compare_entry_t base[COMPARE_MAX_BENCHES], cur[COMPARE_MAX_BENCHES];
+  size_t nbase = baseline ? load_baseline( baseline, base, COMPARE_MAX_BENCHES ) : 0;
+  size_t ncur = 0;
+  if ( baseline && !compare_find( base, nbase, COMPARE_CONTROL ) ) {
+    fprintf( stderr, "%s: no %s samples (an older baseline); record it again\n", baseline,
+             COMPARE_CONTROL );
+    return 2;
+  }
+
+  static ops_ctx_t *ctxs[NUM_DISTS];
+  for ( int dist = 0; dist < NUM_DISTS; dist++ ) {
+    if ( !( ctxs[dist] = malloc( sizeof( ops_ctx_t ) ) ) ) {
+      fprintf( stderr, "out of memory\n" );
+      return 2;
+    }
+    ops_setup( ctxs[dist], dist );
+    if ( dist == 0 ) // the control goes first in each round
+      compare_entry_init( &cur[ncur++], COMPARE_CONTROL, control_kernel, ctxs[dist], 4 * OPS_N,
+                          trials );
+    for ( size_t i = 0; i < sizeof( bench_ops ) / sizeof( bench_ops[0] ); i++ ) {
+      if ( strncmp( bench_ops[i].name, "fixpoint_", 9 ) != 0 )
+        continue; // the baselines aren't ours to regress
+      char name[64];
+      snprintf( name, sizeof( name ), "%s/%s", bench_ops[i].name, dist_names[dist] );
+      compare_entry_init( &cur[ncur++], name, bench_ops[i].fn, ctxs[dist], OPS_N, trials );
+    }
+  }
+
+  // round-robin over the benchmarks, one trial each
+  for ( int t = -warmup; t < (int) trials; t++ ) {
+    for ( size_t i = 0; i < ncur; i++ ) {
+      double ns = bench_trial( cur[i].fn, cur[i].ctx, cur[i].calls, cur[i].nops );
+      if ( t >= 0 )
+        cur[i].samples[cur[i].n++] = ns;
+    }
+  }
+  for ( size_t i = 0; i < ncur; i++ )
+    cur[i].n = bench_reject_outliers( cur[i].samples, cur[i].n );
+  for ( int dist = 0; dist < NUM_DISTS; dist++ )
+    free( ctxs[dist] );
+
+  // no verdict if the machine isn't the baseline's
+  const compare_entry_t *bc = compare_find( base, nbase, COMPARE_CONTROL ), *cc = &cur[0];
+  double change, p;
+  int moved = bc ? compare_samples( bc, cc, alpha, threshold, &change, &p ) : 0;
+
+  int regressions = 0;
+  printf( "%-40s %10s %10s %8s %9s  %s\n", "benchmark", "base ns", "now ns", "change", "p", "verdict" );
+  for ( size_t i = 0; i < ncur; i++ ) {
+    double now = bench_median( cur[i].samples, cur[i].n );
+    const compare_entry_t *b = compare_find( base, nbase, cur[i].name );
+    if ( !b ) {
+      printf( "%-40s %10s %10.3f %8s %9s  %s\n", cur[i].name, "-", now, "-", "-",
+              baseline ? "new" : "" );
+      continue;
+    }
+    int c = compare_samples( b, &cur[i], alpha, threshold, &change, &p );
+    const char *verdict = c > 0 ? "slower" : c < 0 ? "faster" : "same";
+    if ( &cur[i] == cc )
+      verdict = moved ? "MACHINE CHANGED" : "same machine";
+    else if ( c > 0 && !moved ) {
+      verdict = "REGRESSION";
+      regressions++;
+    }
+    printf( "%-40s %10.3f %10.3f %+7.1f%% %9.2g  %s\n", cur[i].name,
+            bench_median( b->samples, b->n ), now, change * 100, p, verdict );
+  }
+
+  if ( save )
+    save_baseline( save, cur, ncur );
+  for ( size_t i = 0; i < ncur; i++ )
+    free( cur[i].samples );
+  for ( size_t i = 0; i < nbase; i++ )
+    free( base[i].samples );
+
+  if ( moved ) {
+    printf( "the control changed, so the machine differs from the baseline's: no verdict\n" );
+    return 2;
+  }
+  if ( baseline )
+    printf( "%d regression(s)\n", regressions );
+  return regressions ? 1 : 0;
+}
+
+int main( int argc, char **argv ) {
+  const char *suite = "all";
+  if ( argc > 1 && ( argv[1][0] < '0' || argv[1][0] > '9' ) ) {
+    suite = argv[1];
+    argc--;
+    argv++;
+  }
+  if ( strcmp( suite, "compare" ) == 0 )
+    return bench_compare( argc, argv );
+  if ( strcmp( suite, "counters" ) == 0 ) {
+    bench_counters( argc > 1 ? (size_t) strtoul( argv[1], NULL, 10 ) : (size_t) 1 << 20,
+                    argc > 2 ? (unsigned) strtoul( argv[2], NULL, 10 ) : 0 );
+    return 0;
+  }
+  size_t size = argc > 1 ? (size_t) strtoul( argv[1], NULL, 10 ) : 256;
+  unsigned nthreads = argc > 2 ? (unsigned) strtoul( argv[2], NULL, 10 ) : 0;
+
+  bool all = strcmp( suite, "all" ) == 0;
+  if ( !all && strcmp( suite, "ops" ) != 0 && strcmp( suite, "kernels" ) != 0 ) {
+    fprintf( stderr, "Usage: fixpoint_bench [ops|kernels|all|compare|counters] [size [threads]]\n" );
+    return 1;
+  }
+
+  if ( all || strcmp( suite, "ops" ) == 0 )
+    bench_ops_all();
+  if ( all || strcmp( suite, "kernels" ) == 0 ) {
+    bench_gemm( size, nthreads );
+    bench_fir( 32, 1 << 18 );
+    bench_poly( 1 << 20 );
+    bench_expr( 1 << 20 );
+    bench_status( 1 << 22 );
+  }
+  return 0;
+}
@@ -0,0 +1,371 @@
+#include "fixpoint_column.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+////////////////////////////////////////////////////////////////////////
+// Helper functions
+////////////////////////////////////////////////////////////////////////
+
+#define HEADER_SIZE 64
+#define DATA_OFFSET 4096 // values start on a page boundary
+#define BYTE_ORDER_MARK 0x01020304u
+
+// Header fields (byte offsets)
+#define H_MAGIC 0
+#define H_VERSION 8
+#define H_BYTE_ORDER 12
+#define H_VALUE_SIZE 16
+#define H_CHUNK_VALUES 20
+#define H_COUNT 24
+#define H_DATA_OFFSET 32
+#define H_CHECKSUM_OFFSET 40
+#define H_CRC 60
+
+static const char magic[8] = "FXPTCOL";
+
+// The file holds fixpoint_t values as they are in memory
+_Static_assert(sizeof(fixpoint_t) == 12, "fixpoint_t is 12 bytes");
+_Static_assert(offsetof(fixpoint_t, whole) == 0 && offsetof(fixpoint_t, frac) == 4 &&
+                   offsetof(fixpoint_t, negative) == 8,
+               "fixpoint_t layout");
+
+static uint32_t crc_table[8][256];
+static pthread_once_t crc_once = PTHREAD_ONCE_INIT;
+
+/**
+ * Fills the tables of the slicing-by-8 CRC-32C.
+ */
+static void crc_init(void) {
+  for (uint32_t i = 0; i < 256; i++) {
+    uint32_t c = i;
+    for (int k = 0; k < 8; k++)
+      c = (c & 1) ? (c >> 1) ^ 0x82F63B78u : c >> 1; // reflected polynomial
+    crc_table[0][i] = c;
+  }
+  for (int t = 1; t < 8; t++)
+    for (int i = 0; i < 256; i++)
+      crc_table[t][i] =
+          (crc_table[t - 1][i] >> 8) ^ crc_table[0][crc_table[t - 1][i] & 0xFF];
+}
+
+/**
+ * Stores a 32 bit field in little-endian byte order.
+ * param- p: where to store it.
+ * param- v: the value.
+ */
+static void put32(unsigned char *p, uint32_t v) {
+  for (int i = 0; i < 4; i++)
+    p[i] = (unsigned char)(v >> (8 * i));
+}
+
+/**
+ * Stores a 64 bit field in little-endian byte order.
+ * param- p: where to store it.
+ * param- v: the value.
+ */
+static void put64(unsigned char *p, uint64_t v) {
+  for (int i = 0; i < 8; i++)
+    p[i] = (unsigned char)(v >> (8 * i));
+}
+
+/**
+ * Loads a little-endian 32 bit field.
+ * param- p: the field.
+ * return- its value.
+ */
+static uint32_t get32(const unsigned char *p) {
+  uint32_t v = 0;
+  for (int i = 3; i >= 0; i--)
+    v = (v << 8) | p[i];
+  return v;
+}
+
+/**
+ * Loads a little-endian 64 bit field.
+ * param- p: the field.
+ * return- its value.
+ */
+static uint64_t get64(const unsigned char *p) {
+  uint64_t v = 0;
+  for (int i = 7; i >= 0; i--)
+    v = (v << 8) | p[i];
+  return v;
+}
+
+/**
+ * Writes a whole buffer at an offset.
+ * param- fd: the file.
+ * param- buf: the data.
+ * param- len: its length.
+ * param- offset: where to write it.
+ * return- true if successful (otherwise errno is set).
+ */
+static bool write_all(int fd, const void *buf, size_t len, uint64_t offset) {
+  const char *p = buf;
+  while (len > 0) {
+    ssize_t n = pwrite(fd, p, len, (off_t)offset);
+    if (n < 0 && errno == EINTR)
+      continue;
+    if (n <= 0)
+      return false;
+    p += n;
+    len -= (size_t)n;
+    offset += (uint64_t)n;
+  }
+  return true;
+}
+
+/**
+ * Records the first error of a writer.
+ * param- w: the writer.
+ * param- status: the error.
+ * return- the first error.
+ */
+static fixpoint_column_status_t writer_fail(fixpoint_column_writer_t *w,
+                                            fixpoint_column_status_t status) {
+  if (w->status == FIXPOINT_COLUMN_OK) {
+    w->status = status;
+    w->saved_errno = errno;
+  }
+  return w->status;
+}
+
+/**
+ * Writes the current chunk and records its checksum.
+ * param- w: the writer.
+ * return- FIXPOINT_COLUMN_OK or an error.
+ */
+static fixpoint_column_status_t flush_chunk(fixpoint_column_writer_t *w) {
+  if (w->in_chunk == 0)
+    return FIXPOINT_COLUMN_OK;
+  if (w->nchunks == w->cap) {
+    size_t cap = w->cap ? 2 * w->cap : 64;
+    uint32_t *checksums = realloc(w->checksums, cap * sizeof(uint32_t));
+    if (!checksums)
+      return writer_fail(w, FIXPOINT_COLUMN_ERR_NO_MEMORY);
+    w->checksums = checksums;
+    w->cap = cap;
+  }
+  size_t len = w->in_chunk * sizeof(fixpoint_t);
+  uint64_t first = w->count - w->in_chunk;
+  if (!write_all(w->fd, w->chunk, len, DATA_OFFSET + first * sizeof(fixpoint_t)))
+    return writer_fail(w, FIXPOINT_COLUMN_ERR_IO);
+  w->checksums[w->nchunks++] = fixpoint_column_crc32c(0, w->chunk, len);
+  w->in_chunk = 0;
+  return FIXPOINT_COLUMN_OK;
+}
+
+/**
+ * Checks that stored values are valid fixpoint_t objects: the byte of
+ * negative is 0 or 1 (anything else is not a bool) and the padding
+ * after it is zero, as the writer leaves it. The bytes are read as
+ * such, since loading a bad bool is undefined.
+ * param- vals: the values.
+ * param- n: number of values.
+ * return- true if all values are valid.
+ */
+static bool values_valid(const fixpoint_t *vals, size_t n) {
+  const unsigned char *p = (const unsigned char *)vals;
+  unsigned bad = 0;
+  for (size_t i = 0; i < n; i++, p += sizeof(fixpoint_t))
+    bad |= (p[8] > 1) | p[9] | p[10] | p[11];
+  return bad == 0;
+}
+
+////////////////////////////////////////////////////////////////////////
+// Public functions
+////////////////////////////////////////////////////////////////////////
+
+uint32_t fixpoint_column_crc32c(uint32_t crc, const void *data, size_t len) {
+  pthread_once(&crc_once, crc_init);
+  const unsigned char *p = data;
+  crc = ~crc;
+  for (; len >= 8; p += 8, len -= 8) {
+    uint64_t v = get64(p) ^ crc;
+    crc = crc_table[7][v & 0xFF] ^ crc_table[6][(v >> 8) & 0xFF] ^
+          crc_table[5][(v >> 16) & 0xFF] ^ crc_table[4][(v >> 24) & 0xFF] ^
+          crc_table[3][(v >> 32) & 0xFF] ^ crc_table[2][(v >> 40) & 0xFF] ^
+          crc_table[1][(v >> 48) & 0xFF] ^ crc_table[0][v >> 56];
+  }
+  for (; len > 0; p++, len--)
+    crc = crc_table[0][(crc ^ *p) & 0xFF] ^ (crc >> 8);
+  return ~crc;
+}
+
+fixpoint_column_status_t fixpoint_column_writer_open(fixpoint_column_writer_t *w,
+                                                     const char *path,
+                                                     uint32_t chunk_values) {
+  memset(w, 0, sizeof(*w));
+  w->chunk_values = chunk_values ? chunk_values : FIXPOINT_COLUMN_DEFAULT_CHUNK;
+  // zeroed, so the padding bytes of the values (and their checksums)
+  // are always the same
+  w->chunk = calloc(w->chunk_values, sizeof(fixpoint_t));
+  if (!w->chunk)
+    return FIXPOINT_COLUMN_ERR_NO_MEMORY;
+  w->fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0666);
+  if (w->fd < 0) {
+    free(w->chunk);
+    w->chunk = NULL;
+    return FIXPOINT_COLUMN_ERR_IO;
+  }
+  return FIXPOINT_COLUMN_OK;
+}
+
+fixpoint_column_status_t fixpoint_column_write(fixpoint_column_writer_t *w,
+                                               const fixpoint_t *vals, size_t n) {
+  for (size_t i = 0; i < n && w->status == FIXPOINT_COLUMN_OK; i++) {
+    // field by field, so the padding stays zero
+    fixpoint_t *out = &w->chunk[w->in_chunk++];
+    out->whole = vals[i].whole;
+    out->frac = vals[i].frac;
+    out->negative = vals[i].negative;
+    w->count++;
+    if (w->in_chunk == w->chunk_values)
+      flush_chunk(w);
+  }
+  return w->status;
+}
+
+fixpoint_column_status_t fixpoint_column_writer_close(fixpoint_column_writer_t *w) {
+  flush_chunk(w);
+  if (w->status == FIXPOINT_COLUMN_OK) {
+    uint64_t checksum_offset = DATA_OFFSET + w->count * sizeof(fixpoint_t);
+    unsigned char header[HEADER_SIZE] = {0};
+    memcpy(header + H_MAGIC, magic, sizeof(magic));
+    put32(header + H_VERSION, FIXPOINT_COLUMN_VERSION);
+    put32(header + H_VALUE_SIZE, sizeof(fixpoint_t));
+    put32(header + H_CHUNK_VALUES, w->chunk_values);
+    put64(header + H_COUNT, w->count);
+    put64(header + H_DATA_OFFSET, DATA_OFFSET);
+    put64(header + H_CHECKSUM_OFFSET, checksum_offset);
+    // the mark in the byte order of the values
+    uint32_t mark = BYTE_ORDER_MARK;
+    memcpy(header + H_BYTE_ORDER, &mark, sizeof(mark));
+    put32(header + H_CRC, fixpoint_column_crc32c(0, header, H_CRC));
+
+    // the checksums are in host byte order like the values; the
+    // header goes last, so an unfinished file has no magic
+    if (!write_all(w->fd, w->checksums, w->nchunks * sizeof(uint32_t), checksum_offset) ||
+        ftruncate(w->fd, (off_t)(checksum_offset + w->nchunks * sizeof(uint32_t))) != 0 ||
+        !write_all(w->fd, header, sizeof(header), 0))
+      writer_fail(w, FIXPOINT_COLUMN_ERR_IO);
+  }
+  if (close(w->fd) != 0)
+    writer_fail(w, FIXPOINT_COLUMN_ERR_IO);
+  free(w->chunk);
+  free(w->checksums);
+  w->chunk = NULL;
+  w->checksums = NULL;
+  w->fd = -1;
+  errno = w->saved_errno;
+  return w->status;
+}
+
+fixpoint_column_status_t fixpoint_column_open(fixpoint_column_t *col, const char *path,
+                                              bool verify) {
+  memset(col, 0, sizeof(*col));
+  int fd = open(path, O_RDONLY);
+  if (fd < 0)
+    return FIXPOINT_COLUMN_ERR_IO;
+  struct stat st;
+  if (fstat(fd, &st) != 0) {
+    close(fd);
+    return FIXPOINT_COLUMN_ERR_IO;
+  }
+  if (!S_ISREG(st.st_mode) || st.st_size < DATA_OFFSET) {
+    close(fd);
+    return FIXPOINT_COLUMN_ERR_NOT_COLUMN;
+  }
+  size_t size = (size_t)st.st_size;
+  void *map = mmap(NULL, size, PROT_READ, MAP_SHARED, fd, 0);
+  close(fd); // the mapping stays
+  if (map == MAP_FAILED)
+    return FIXPOINT_COLUMN_ERR_IO;
+
+  const unsigned char *h = map;
+  uint32_t mark;
+  memcpy(&mark, h + H_BYTE_ORDER, sizeof(mark));
+  fixpoint_column_status_t status = FIXPOINT_COLUMN_OK;
+  uint64_t count = get64(h + H_COUNT), data_offset = get64(h + H_DATA_OFFSET);
+  uint64_t checksum_offset = get64(h + H_CHECKSUM_OFFSET);
+  uint32_t chunk_values = get32(h + H_CHUNK_VALUES);
+  uint64_t nchunks = chunk_values ? count / chunk_values + (count % chunk_values != 0) : 0;
+  if (memcmp(h + H_MAGIC, magic, sizeof(magic)) != 0 || mark != BYTE_ORDER_MARK)
+    status = FIXPOINT_COLUMN_ERR_NOT_COLUMN;
+  else if (get32(h + H_VERSION) != FIXPOINT_COLUMN_VERSION)
+    status = FIXPOINT_COLUMN_ERR_VERSION;
+  else if (get32(h + H_CRC) != fixpoint_column_crc32c(0, h, H_CRC) ||
+           get32(h + H_VALUE_SIZE) != sizeof(fixpoint_t) || chunk_values == 0 ||
+           data_offset < HEADER_SIZE || data_offset > size ||
+           data_offset % sizeof(uint32_t) != 0 ||
+           count > (size - data_offset) / sizeof(fixpoint_t) ||
+           checksum_offset != data_offset + count * sizeof(fixpoint_t) ||
+           nchunks > (size - checksum_offset) / sizeof(uint32_t))
+    status = FIXPOINT_COLUMN_ERR_CORRUPT; // (also a truncated file)
+  if (status != FIXPOINT_COLUMN_OK) {
+    munmap(map, size);
+    return status;
+  }
+
+  col->vals = (const fixpoint_t *)(h + data_offset);
+  col->count = count;
+  col->chunk_values = chunk_values;
+  col->nchunks = nchunks;
+  col->checksums = (const uint32_t *)(h + checksum_offset);
+  col->map = map;
+  col->map_size = size;
+  for (uint64_t i = 0; verify && i < nchunks; i++) {
+    if (fixpoint_column_verify_chunk(col, i) != FIXPOINT_COLUMN_OK) {
+      fixpoint_column_close(col);
+      return FIXPOINT_COLUMN_ERR_CORRUPT;
+    }
+  }
+  return FIXPOINT_COLUMN_OK;
+}
+
+fixpoint_column_status_t fixpoint_column_verify_chunk(const fixpoint_column_t *col,
+                                                      uint64_t chunk) {
+  size_t n;
+  const fixpoint_t *vals = fixpoint_column_chunk(col, chunk, &n);
+  uint32_t crc = fixpoint_column_crc32c(0, vals, n * sizeof(fixpoint_t));
+  return crc == col->checksums[chunk] && values_valid(vals, n) ? FIXPOINT_COLUMN_OK
+                                                              : FIXPOINT_COLUMN_ERR_CORRUPT;
+}
+
+const fixpoint_t *fixpoint_column_chunk(const fixpoint_column_t *col, uint64_t chunk,
+                                        size_t *n) {
+  uint64_t first = chunk * col->chunk_values;
+  uint64_t left = col->count - first;
+  *n = (size_t)(left < col->chunk_values ? left : col->chunk_values);
+  return col->vals + first;
+}
+
+void fixpoint_column_close(fixpoint_column_t *col) {
+  if (col->map)
+    munmap(col->map, col->map_size);
+  memset(col, 0, sizeof(*col));
+}
+
+const char *fixpoint_column_strerror(fixpoint_column_status_t status) {
+  switch (status) {
+  case FIXPOINT_COLUMN_OK:
+    return "success";
+  case FIXPOINT_COLUMN_ERR_IO:
+    return strerror(errno);
+  case FIXPOINT_COLUMN_ERR_NO_MEMORY:
+    return "out of memory";
+  case FIXPOINT_COLUMN_ERR_NOT_COLUMN:
+    return "not a column file";
+  case FIXPOINT_COLUMN_ERR_VERSION:
+    return "unsupported column file version";
+  case FIXPOINT_COLUMN_ERR_CORRUPT:
+    return "corrupt column file";
+  }
+  return "unknown error";
+}
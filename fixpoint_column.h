@@ -0,0 +1,171 @@
+#ifndef FIXPOINT_COLUMN_H
+#define FIXPOINT_COLUMN_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "fixpoint.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+////////////////////////////////////////////////////////////////////////
+// Column files
+////////////////////////////////////////////////////////////////////////
+
+// A column file stores an array of fixpoint_t values in the in-memory
+// layout of fixpoint_t, so an opened file is used in place: the values
+// are mapped into memory and can be passed straight to the batch
+// kernels, with nothing to parse or copy. The layout is
+//
+//   offset 0                  header (64 bytes, see below)
+//   data_offset (4096)        count values, sizeof(fixpoint_t) bytes each
+//   data_offset + 12 * count  one CRC-32C per chunk (uint32_t)
+//
+// The values are split into chunks of chunk_values values (the last
+// one may be shorter), each with a checksum, so damage can be found
+// (and reported) chunk by chunk. The header holds, in little-endian
+// byte order: the magic "FXPTCOL\0", the format version, a byte order
+// mark, the size of a value, chunk_values, count, data_offset, the
+// offset of the checksums, and at offset 60 a CRC-32C of the bytes
+// before it.
+//
+// The values and checksums are stored in the byte order of the machine
+// that wrote them, and so is the byte order mark (0x01020304); a
+// machine with the other byte order rejects the file as not being a
+// column file. The header is written last, so a file whose writer
+// didn't finish is rejected the same way.
+
+//! Current version of the column file format.
+#define FIXPOINT_COLUMN_VERSION 1
+
+//! Default number of values per chunk.
+#define FIXPOINT_COLUMN_DEFAULT_CHUNK 65536
+
+//! Results of the column file functions.
+typedef enum {
+  FIXPOINT_COLUMN_OK,             //!< success
+  FIXPOINT_COLUMN_ERR_IO,         //!< a system call failed (see errno)
+  FIXPOINT_COLUMN_ERR_NO_MEMORY,  //!< memory could not be allocated
+  FIXPOINT_COLUMN_ERR_NOT_COLUMN, //!< not a (complete) column file
+  FIXPOINT_COLUMN_ERR_VERSION,    //!< a column file of another version
+  FIXPOINT_COLUMN_ERR_CORRUPT,    //!< inconsistent header or a checksum mismatch
+} fixpoint_column_status_t;
+
+//! Writes a column file. The fields are managed by the
+//! fixpoint_column_writer_ functions and should not be accessed
+//! directly.
+typedef struct {
+  int fd;                          //!< the file
+  uint32_t chunk_values;           //!< values per chunk
+  uint64_t count;                  //!< values written so far
+  fixpoint_t *chunk;               //!< the values of the current chunk
+  uint32_t in_chunk;               //!< number of them
+  uint32_t *checksums;             //!< checksums of the complete chunks
+  size_t nchunks, cap;             //!< number of complete chunks, capacity of checksums
+  fixpoint_column_status_t status; //!< first error
+  int saved_errno;                 //!< errno of the first error
+} fixpoint_column_writer_t;
+
+//! A column file opened for reading.
+typedef struct {
+  const fixpoint_t *vals;    //!< the values (in the mapped file)
+  uint64_t count;            //!< number of values
+  uint32_t chunk_values;     //!< values per chunk
+  uint64_t nchunks;          //!< number of chunks
+  const uint32_t *checksums; //!< checksum of each chunk (in the mapped file)
+  void *map;                 //!< the mapping
+  size_t map_size;           //!< its size
+} fixpoint_column_t;
+
+//! Create (or truncate) a column file for writing.
+//!
+//! @param w the writer
+//! @param path name of the file
+//! @param chunk_values values per chunk, or 0 for
+//!                     FIXPOINT_COLUMN_DEFAULT_CHUNK
+//! @return FIXPOINT_COLUMN_OK, ERR_IO or ERR_NO_MEMORY
+fixpoint_column_status_t
+fixpoint_column_writer_open( fixpoint_column_writer_t *w, const char *path, uint32_t chunk_values );
+
+//! Append values to a column file. After an error, further calls do
+//! nothing and return the same error.
+//!
+//! @param w the writer
+//! @param vals the values
+//! @param n number of values
+//! @return FIXPOINT_COLUMN_OK, ERR_IO or ERR_NO_MEMORY
+fixpoint_column_status_t
+fixpoint_column_write( fixpoint_column_writer_t *w, const fixpoint_t *vals, size_t n );
+
+//! Finish a column file (write the last chunk, the checksums and the
+//! header) and close it. If an error occurred, the file is left
+//! without a header and is not a valid column file.
+//!
+//! @param w the writer
+//! @return FIXPOINT_COLUMN_OK or the first error (for ERR_IO, errno is
+//!         set as it was then)
+fixpoint_column_status_t
+fixpoint_column_writer_close( fixpoint_column_writer_t *w );
+
+//! Open a column file and map it into memory (read only).
+//!
+//! @param col set to the column
+//! @param path name of the file
+//! @param verify true to check all chunks now (see
+//!               fixpoint_column_verify_chunk); false trusts the file:
+//!               the values are used as they are, and a damaged or
+//!               crafted one (e.g. a negative byte that isn't 0 or 1)
+//!               is undefined behavior when read as a fixpoint_t
+//! @return FIXPOINT_COLUMN_OK or an error (then there is nothing to
+//!         close)
+fixpoint_column_status_t
+fixpoint_column_open( fixpoint_column_t *col, const char *path, bool verify );
+
+//! Check one chunk: its checksum, and that every value is a valid
+//! fixpoint_t (negative stored as 0 or 1, zero padding).
+//!
+//! @param col the column
+//! @param chunk the chunk index (less than col->nchunks)
+//! @return FIXPOINT_COLUMN_OK or FIXPOINT_COLUMN_ERR_CORRUPT
+fixpoint_column_status_t
+fixpoint_column_verify_chunk( const fixpoint_column_t *col, uint64_t chunk );
+
+//! Get the values of one chunk.
+//!
+//! @param col the column
+//! @param chunk the chunk index (less than col->nchunks)
+//! @param n set to the number of values in the chunk
+//! @return pointer to its first value
+const fixpoint_t *
+fixpoint_column_chunk( const fixpoint_column_t *col, uint64_t chunk, size_t *n );
+
+//! Unmap a column file.
+//!
+//! @param col the column
+void
+fixpoint_column_close( fixpoint_column_t *col );
+
+//! Get a description of a status.
+//!
+//! @param status the status
+//! @return a string such as "corrupt column file" (for
+//!         FIXPOINT_COLUMN_ERR_IO, the description of errno)
+const char *
+fixpoint_column_strerror( fixpoint_column_status_t status );
+
+//! Compute a CRC-32C (Castagnoli), as used for the checksums.
+//!
+//! @param crc the CRC of the data before (0 to start)
+//! @param data the data
+//! @param len its length
+//! @return the CRC of all the data
+uint32_t
+fixpoint_column_crc32c( uint32_t crc, const void *data, size_t len );
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // FIXPOINT_COLUMN_H
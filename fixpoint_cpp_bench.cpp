@@ -0,0 +1,98 @@
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+#include "bench.h"
+#include "fixpoint.hpp"
+#include "fixpoint_value.hpp"
+
+// Benchmark for the C++ wrappers: out = a*b + c over arrays with the C
+// API, a hand-written inline loop, and the expression templates.
+// Usage: fixpoint_cpp_bench [n [reps]]
+// Time fixpoint_cpp_bench_opt (make opt): unoptimized, the expression
+// templates aren't inlined and the comparison means nothing.
+
+typedef fixpoint<32, 32> q32_32;
+
+// One call per operation through the C API
+static result_t fma_c_api( fixpoint_t *out, const fixpoint_t *a, const fixpoint_t *b,
+                           const fixpoint_t *c, size_t n ) {
+  result_t flags = RESULT_OK;
+  for ( size_t i = 0; i < n; i++ ) {
+    fixpoint_t prod;
+    flags |= fixpoint_mul( &prod, &a[i], &b[i] );
+    flags |= fixpoint_add( &out[i], &prod, &c[i] );
+  }
+  return flags;
+}
+
+// The same loop written by hand with the inline template
+static result_t fma_by_hand( fixpoint_t *out, const fixpoint_t *a, const fixpoint_t *b,
+                             const fixpoint_t *c, size_t n ) {
+  result_t flags = RESULT_OK;
+  for ( size_t i = 0; i < n; i++ ) {
+    q32_32 prod, sum;
+    flags |= q32_32::mul( prod, q32_32::from_c( a[i] ), q32_32::from_c( b[i] ) );
+    flags |= q32_32::add( sum, prod, q32_32::from_c( c[i] ) );
+    out[i] = sum.to_c();
+  }
+  return flags;
+}
+
+static result_t fma_expr( fixpoint_t *out, const fixpoint_t *a, const fixpoint_t *b,
+                          const fixpoint_t *c, size_t n ) {
+  return fixpoint_eval( out, n, fixpoint_span( a, n ) * fixpoint_span( b, n ) + fixpoint_span( c, n ) );
+}
+
+// Field-by-field comparison (memcmp would also compare the padding)
+static bool same_results( const fixpoint_t *x, const fixpoint_t *y, size_t n ) {
+  for ( size_t i = 0; i < n; i++ )
+    if ( x[i].whole != y[i].whole || x[i].frac != y[i].frac || x[i].negative != y[i].negative )
+      return false;
+  return true;
+}
+
+typedef result_t ( *fma_fn )( fixpoint_t *, const fixpoint_t *, const fixpoint_t *,
+                              const fixpoint_t *, size_t );
+
+// Best of reps runs, in ns per element
+static double time_fma( fma_fn fn, fixpoint_t *out, const fixpoint_t *a, const fixpoint_t *b,
+                        const fixpoint_t *c, size_t n, int reps ) {
+  double best = 1e30;
+  for ( int r = 0; r < reps; r++ ) {
+    double start = bench_now_sec();
+    fn( out, a, b, c, n );
+    double t = bench_now_sec() - start;
+    if ( t < best )
+      best = t;
+  }
+  return best / n * 1e9;
+}
+
+int main( int argc, char **argv ) {
+  size_t n = argc > 1 ? (size_t) strtoul( argv[1], NULL, 10 ) : 1 << 20;
+  int reps = argc > 2 ? atoi( argv[2] ) : 5;
+
+  std::vector<fixpoint_t> a( n ), b( n ), c( n ), out_c( n ), out_hand( n ), out_expr( n );
+  uint64_t state = 42;
+  bench_fill_random( a.data(), n, &state );
+  bench_fill_random( b.data(), n, &state );
+  bench_fill_random( c.data(), n, &state );
+
+  double t_c = time_fma( fma_c_api, out_c.data(), a.data(), b.data(), c.data(), n, reps );
+  double t_hand = time_fma( fma_by_hand, out_hand.data(), a.data(), b.data(), c.data(), n, reps );
+  double t_expr = time_fma( fma_expr, out_expr.data(), a.data(), b.data(), c.data(), n, reps );
+
+  // all three must produce the same bits
+  if ( !same_results( out_c.data(), out_hand.data(), n ) ||
+       !same_results( out_c.data(), out_expr.data(), n ) ||
+       fma_c_api( out_c.data(), a.data(), b.data(), c.data(), n ) !=
+         fma_expr( out_expr.data(), a.data(), b.data(), c.data(), n ) ) {
+    fprintf( stderr, "results differ\n" );
+    return 1;
+  }
+
+  printf( "a*b+c n=%zu  C API: %6.2f ns/elem  by hand: %6.2f ns/elem  expression: %6.2f ns/elem"
+          "  (expression/hand %.2f)\n",
+          n, t_c, t_hand, t_expr, t_expr / t_hand );
+  return 0;
+}
@@ -0,0 +1,399 @@
+#include <cstdint>
+#include <cstring>
+#include "tctest.h"
+#include "fixpoint.hpp"
+#include "fixpoint_value.hpp"
+
+typedef fixpoint<32, 32> q32_32;
+typedef fixpoint<16, 16> q16_16;
+typedef fixpoint<48, 16> q48_16;
+typedef fixpoint<4, 4> q4_4;
+
+// The parameterized type needs no fixture, but tctest's TEST()
+// macro calls setup() and cleanup() for every test
+typedef struct {
+  int unused;
+} TestObjs;
+
+TestObjs *setup( void );
+void cleanup( TestObjs *objs );
+
+// Macro to check a Q32.32 value against a fixpoint_t for exact equality
+#define TEST_EQUAL_C( cpp, c ) \
+do { \
+  ASSERT( (cpp).whole() == (c)->whole ); \
+  ASSERT( (cpp).frac() == (c)->frac ); \
+  ASSERT( (cpp).is_negative() == (c)->negative ); \
+} while ( 0 )
+
+// Deterministic pseudo-random values (xorshift64*), as in fixpoint_tests.c
+static uint64_t test_rand( uint64_t *state ) {
+  *state ^= *state >> 12;
+  *state ^= *state << 25;
+  *state ^= *state >> 27;
+  return *state * 0x2545F4914F6CDD1DULL;
+}
+
+// Operands for the differential tests: every pair of some edge values
+// followed by random values with a random sign
+#define TEST_EDGES 10
+#define TEST_N ( TEST_EDGES * TEST_EDGES + 2000 )
+static void test_operands( fixpoint_t *left, fixpoint_t *right ) {
+  static const uint32_t edges[TEST_EDGES][3] = {
+    { 0, 0, 0 }, { 0, 0, 1 }, { 1, 0, 0 }, { 1, 0, 1 },
+    { 0xFFFFFFFF, 0xFFFFFFFF, 0 }, { 0xFFFFFFFF, 0xFFFFFFFF, 1 },
+    { 0, 1, 1 }, { 0, 0xFFFFFFFF, 0 }, { 0x80000000, 0, 1 }, { 0x10000, 0x10000, 0 },
+  };
+  size_t k = 0;
+  for ( int i = 0; i < TEST_EDGES; i++ ) {
+    for ( int j = 0; j < TEST_EDGES; j++, k++ ) {
+      left[k].whole = edges[i][0];
+      left[k].frac = edges[i][1];
+      left[k].negative = edges[i][2];
+      right[k].whole = edges[j][0];
+      right[k].frac = edges[j][1];
+      right[k].negative = edges[j][2];
+    }
+  }
+  uint64_t state = 33;
+  for ( ; k < TEST_N; k++ ) {
+    uint64_t r = test_rand( &state );
+    uint64_t s = test_rand( &state );
+    left[k].whole = (uint32_t) ( r >> 32 );
+    left[k].frac = (uint32_t) r;
+    left[k].negative = s & 1;
+    // keep some right operands small so that products don't always overflow
+    right[k].whole = (uint32_t) ( s >> 32 ) & ( ( s & 2 ) ? 0xFFFFFFFF : 0x1FFFF );
+    right[k].frac = (uint32_t) s;
+    right[k].negative = ( s >> 2 ) & 1;
+  }
+}
+
+// Values computed at compile time
+static_assert( sizeof( q16_16::storage_type ) == 4, "Q16.16 is stored in 32 bits" );
+static_assert( sizeof( q4_4::storage_type ) == 1, "Q4.4 is stored in 8 bits" );
+static_assert( q16_16::from_parts( 3, 0x8000, true ).negated().raw() == 0x38000, "negate" );
+static_assert( !q16_16::from_parts( 0, 0, true ).is_negative(), "zero is not negative" );
+
+static constexpr q16_16 const_sum() {
+  q16_16 sum;
+  q16_16::add( sum, q16_16::from_parts( 1, 0x8000, false ), q16_16::from_parts( 2, 0xC000, false ) );
+  return sum;
+}
+static_assert( const_sum().whole() == 4 && const_sum().frac() == 0x4000, "constexpr add" );
+
+static constexpr bool const_parse() {
+  q48_16 val;
+  return q48_16::parse_hex( val, "-123456789abc.8" ) && val.whole() == 0x123456789abcULL &&
+         val.frac() == 0x8000 && val.is_negative();
+}
+static_assert( const_parse(), "constexpr parse" );
+
+// Prototypes for test functions
+void test_q32_add_matches_c( TestObjs *objs );
+void test_q32_sub_matches_c( TestObjs *objs );
+void test_q32_mul_matches_c( TestObjs *objs );
+void test_q32_compare_matches_c( TestObjs *objs );
+void test_q32_format_matches_c( TestObjs *objs );
+void test_q32_parse_matches_c( TestObjs *objs );
+void test_q16_16_arith( TestObjs *objs );
+void test_q16_16_hex( TestObjs *objs );
+void test_q48_16_arith( TestObjs *objs );
+void test_q48_16_hex( TestObjs *objs );
+void test_q4_4_exhaustive( TestObjs *objs );
+void test_value_ops_match_c( TestObjs *objs );
+void test_value_fused_matches_c( TestObjs *objs );
+void test_value_misc( TestObjs *objs );
+
+int main( int argc, char **argv ) {
+  if ( argc > 1 )
+    tctest_testname_to_execute = argv[1];
+
+  TEST_INIT();
+
+  TEST( test_q32_add_matches_c );
+  TEST( test_q32_sub_matches_c );
+  TEST( test_q32_mul_matches_c );
+  TEST( test_q32_compare_matches_c );
+  TEST( test_q32_format_matches_c );
+  TEST( test_q32_parse_matches_c );
+  TEST( test_q16_16_arith );
+  TEST( test_q16_16_hex );
+  TEST( test_q48_16_arith );
+  TEST( test_q48_16_hex );
+  TEST( test_q4_4_exhaustive );
+  TEST( test_value_ops_match_c );
+  TEST( test_value_fused_matches_c );
+  TEST( test_value_misc );
+
+  TEST_FINI();
+}
+
+TestObjs *setup( void ) {
+  return new TestObjs();
+}
+
+void cleanup( TestObjs *objs ) {
+  delete objs;
+}
+
+void test_q32_add_matches_c( TestObjs * ) {
+  static fixpoint_t left[TEST_N], right[TEST_N];
+  test_operands( left, right );
+  for ( size_t i = 0; i < TEST_N; i++ ) {
+    fixpoint_t expected;
+    q32_32 actual;
+    result_t rc = fixpoint_add( &expected, &left[i], &right[i] );
+    ASSERT( q32_32::add( actual, q32_32::from_c( left[i] ), q32_32::from_c( right[i] ) ) == rc );
+    TEST_EQUAL_C( actual, &expected );
+  }
+}
+
+void test_q32_sub_matches_c( TestObjs * ) {
+  static fixpoint_t left[TEST_N], right[TEST_N];
+  test_operands( left, right );
+  for ( size_t i = 0; i < TEST_N; i++ ) {
+    fixpoint_t expected;
+    q32_32 actual;
+    result_t rc = fixpoint_sub( &expected, &left[i], &right[i] );
+    ASSERT( q32_32::sub( actual, q32_32::from_c( left[i] ), q32_32::from_c( right[i] ) ) == rc );
+    TEST_EQUAL_C( actual, &expected );
+  }
+}
+
+void test_q32_mul_matches_c( TestObjs * ) {
+  static fixpoint_t left[TEST_N], right[TEST_N];
+  test_operands( left, right );
+  for ( size_t i = 0; i < TEST_N; i++ ) {
+    fixpoint_t expected;
+    q32_32 actual;
+    result_t rc = fixpoint_mul( &expected, &left[i], &right[i] );
+    ASSERT( q32_32::mul( actual, q32_32::from_c( left[i] ), q32_32::from_c( right[i] ) ) == rc );
+    TEST_EQUAL_C( actual, &expected );
+  }
+}
+
+void test_q32_compare_matches_c( TestObjs * ) {
+  static fixpoint_t left[TEST_N], right[TEST_N];
+  test_operands( left, right );
+  for ( size_t i = 0; i < TEST_N; i++ )
+    ASSERT( q32_32::compare( q32_32::from_c( left[i] ), q32_32::from_c( right[i] ) ) ==
+            fixpoint_compare( &left[i], &right[i] ) );
+}
+
+void test_q32_format_matches_c( TestObjs * ) {
+  static fixpoint_t left[TEST_N], right[TEST_N];
+  test_operands( left, right );
+  for ( size_t i = 0; i < TEST_N; i++ ) {
+    fixpoint_str_t expected;
+    fixpoint_format_hex( &expected, &left[i] );
+    ASSERT( strcmp( q32_32::from_c( left[i] ).format_hex().str, expected.str ) == 0 );
+  }
+}
+
+void test_q32_parse_matches_c( TestObjs * ) {
+  static const char *const inputs[] = {
+    "0.0", "-0.0", "f6a5865.00f2", "-ffffffff.ffffffff", "1.8", "ABCDEF.12", "0.00000001",
+    "", "-", ".", "1.", ".1", "+1.0", " 1.0", "1.0 ", "123456789.0", "1.123456789", "1.2.3", "g.0",
+  };
+  for ( size_t i = 0; i < sizeof( inputs ) / sizeof( inputs[0] ); i++ ) {
+    fixpoint_str_t s;
+    fixpoint_t expected;
+    q32_32 actual;
+    snprintf( s.str, sizeof( s.str ), "%s", inputs[i] );
+    bool ok = fixpoint_parse_hex( &expected, &s );
+    ASSERT( q32_32::parse_hex( actual, inputs[i] ) == ok );
+    if ( ok )
+      TEST_EQUAL_C( actual, &expected );
+  }
+}
+
+void test_q16_16_arith( TestObjs * ) {
+  q16_16 result;
+
+  // carry out of the fraction
+  ASSERT( q16_16::add( result, q16_16::from_parts( 1, 0xC000, false ),
+                       q16_16::from_parts( 0, 0x8000, false ) ) == RESULT_OK );
+  ASSERT( result.whole() == 2 && result.frac() == 0x4000 && !result.is_negative() );
+
+  // overflow at 16 whole bits, truncating to a negative zero
+  ASSERT( q16_16::add( result, q16_16::from_parts( 0x8000, 0, true ),
+                       q16_16::from_parts( 0x8000, 0, true ) ) == RESULT_OVERFLOW );
+  ASSERT( result.raw() == 0 && result.is_negative() );
+
+  // opposite signs take the sign of the larger magnitude
+  ASSERT( q16_16::sub( result, q16_16::from_parts( 1, 0, false ),
+                       q16_16::from_parts( 2, 0x8000, false ) ) == RESULT_OK );
+  ASSERT( result.whole() == 1 && result.frac() == 0x8000 && result.is_negative() );
+
+  // 0.0001 * 0.0001 underflows to a negative zero when the signs differ
+  ASSERT( q16_16::mul( result, q16_16::from_parts( 0, 1, false ),
+                       q16_16::from_parts( 0, 1, true ) ) == RESULT_UNDERFLOW );
+  ASSERT( result.raw() == 0 && result.is_negative() );
+
+  // 0x100 * 0x100 overflows 16 whole bits
+  ASSERT( q16_16::mul( result, q16_16::from_parts( 0x100, 0, false ),
+                       q16_16::from_parts( 0x100, 0x8000, false ) ) == RESULT_OVERFLOW );
+  ASSERT( result.whole() == 0x80 && result.frac() == 0 );
+
+  ASSERT( q16_16::compare( q16_16::from_parts( 1, 0, true ), q16_16::from_parts( 0, 0xFFFF, false ) ) == 1 );
+}
+
+void test_q16_16_hex( TestObjs * ) {
+  q16_16 val;
+  ASSERT( strcmp( q16_16::from_parts( 0xF6A5, 0x00F2, true ).format_hex().str, "-f6a5.00f2" ) == 0 );
+  ASSERT( strcmp( q16_16().format_hex().str, "0.0" ) == 0 );
+  ASSERT( strcmp( q16_16::from_parts( 0xFFFF, 0xFFFF, true ).format_hex().str, "-ffff.ffff" ) == 0 );
+  ASSERT( sizeof( q16_16::str_type ) == sizeof( "-ffff.ffff" ) );
+
+  ASSERT( q16_16::parse_hex( val, "abc.8" ) );
+  ASSERT( val.whole() == 0xABC && val.frac() == 0x8000 && !val.is_negative() );
+  ASSERT( q16_16::parse_hex( val, "-0.0" ) );
+  ASSERT( val.raw() == 0 && !val.is_negative() );
+  ASSERT( !q16_16::parse_hex( val, "10000.0" ) );
+  ASSERT( !q16_16::parse_hex( val, "1.00001" ) );
+}
+
+void test_q48_16_arith( TestObjs * ) {
+  q48_16 result;
+  q48_16 max = q48_16::from_parts( 0xFFFFFFFFFFFFULL, 0xFFFF, false );
+
+  ASSERT( sizeof( q48_16::storage_type ) == 8 );
+  ASSERT( q48_16::add( result, max, q48_16::from_parts( 0, 1, false ) ) == RESULT_OVERFLOW );
+  ASSERT( result.raw() == 0 && !result.is_negative() );
+
+  // whole parts wider than 32 bits
+  ASSERT( q48_16::mul( result, q48_16::from_parts( 0x100000000ULL, 0, false ),
+                       q48_16::from_parts( 0x1000, 0x8000, true ) ) == RESULT_OK );
+  ASSERT( result.whole() == 0x100080000000ULL && result.frac() == 0 && result.is_negative() );
+
+  ASSERT( q48_16::mul( result, max, max ) == ( RESULT_OVERFLOW | RESULT_UNDERFLOW ) );
+  ASSERT( result.whole() == 0xFFFE00000000ULL && result.frac() == 0 );
+
+  ASSERT( q48_16::sub( result, q48_16::from_parts( 0x123456789ULL, 0, true ),
+                       q48_16::from_parts( 0x123456789ULL, 0, true ) ) == RESULT_OK );
+  ASSERT( result.raw() == 0 && !result.is_negative() );
+}
+
+void test_q48_16_hex( TestObjs * ) {
+  q48_16 val;
+  ASSERT( strcmp( q48_16::from_parts( 0xFFFFFFFFFFFFULL, 0x1, true ).format_hex().str,
+                  "-ffffffffffff.0001" ) == 0 );
+  ASSERT( q48_16::parse_hex( val, "FFFFFFFFFFFF.ffff" ) );
+  ASSERT( val.whole() == 0xFFFFFFFFFFFFULL && val.frac() == 0xFFFF );
+  ASSERT( !q48_16::parse_hex( val, "1000000000000.0" ) );
+}
+
+// Q4.4 is small enough to check every pair of values against the
+// exact results computed with plain integers
+void test_q4_4_exhaustive( TestObjs * ) {
+  for ( int l = -255; l <= 255; l++ ) {
+    for ( int r = -255; r <= 255; r++ ) {
+      q4_4 left = q4_4::from_raw( (uint8_t) ( l < 0 ? -l : l ), l < 0 );
+      q4_4 right = q4_4::from_raw( (uint8_t) ( r < 0 ? -r : r ), r < 0 );
+      q4_4 result;
+
+      int sum = l + r;
+      int mag = sum < 0 ? -sum : sum;
+      result_t rc = q4_4::add( result, left, right );
+      ASSERT( rc == ( mag > 255 ? RESULT_OVERFLOW : RESULT_OK ) );
+      ASSERT( result.raw() == ( mag & 0xFF ) );
+      ASSERT( result.is_negative() == ( sum < 0 && ( ( mag & 0xFF ) != 0 || mag > 255 ) ) );
+
+      int prod = l * r;
+      int pmag = prod < 0 ? -prod : prod;
+      result_t expected = ( ( pmag >> 4 ) > 255 ? RESULT_OVERFLOW : 0 ) |
+                          ( ( pmag & 0xF ) ? RESULT_UNDERFLOW : 0 );
+      ASSERT( q4_4::mul( result, left, right ) == expected );
+      ASSERT( result.raw() == ( ( pmag >> 4 ) & 0xFF ) );
+      ASSERT( result.is_negative() == ( prod < 0 && ( result.raw() != 0 || expected != RESULT_OK ) ) );
+
+      q4_4 parsed;
+      ASSERT( q4_4::parse_hex( parsed, left.format_hex().str ) );
+      ASSERT( parsed.raw() == left.raw() && parsed.is_negative() == left.is_negative() );
+    }
+  }
+}
+
+void test_value_ops_match_c( TestObjs * ) {
+  static fixpoint_t left[TEST_N], right[TEST_N];
+  test_operands( left, right );
+  for ( size_t i = 0; i < TEST_N; i++ ) {
+    fixpoint_value a( left[i] ), b( right[i] ), r;
+    fixpoint_t expected;
+    result_t rc;
+
+    rc = fixpoint_add( &expected, &left[i], &right[i] );
+    ASSERT( r.assign( a + b ) == rc );
+    TEST_EQUAL_C( r, &expected );
+
+    rc = fixpoint_sub( &expected, &left[i], &right[i] );
+    ASSERT( r.assign( a - b ) == rc );
+    TEST_EQUAL_C( r, &expected );
+
+    rc = fixpoint_mul( &expected, &left[i], &right[i] );
+    ASSERT( r.assign( a * b ) == rc );
+    TEST_EQUAL_C( r, &expected );
+    r = a;
+    r *= b;
+    TEST_EQUAL_C( r, &expected );
+
+    expected = left[i];
+    fixpoint_negate( &expected );
+    r = -a;
+    TEST_EQUAL_C( r, &expected );
+    ASSERT( a.compare( b ) == fixpoint_compare( &left[i], &right[i] ) );
+  }
+}
+
+// a*b + c and -(a - b)*c over arrays must match calling the C
+// functions one at a time, including the combined flags
+void test_value_fused_matches_c( TestObjs * ) {
+  static fixpoint_t a[TEST_N], b[TEST_N], c[TEST_N], out[TEST_N];
+  test_operands( a, b );
+  for ( size_t i = 0; i < TEST_N; i++ )
+    c[i] = b[TEST_N - 1 - i];
+
+  fixpoint_span sa( a, TEST_N ), sb( b, TEST_N ), sc( c, TEST_N );
+  result_t flags = fixpoint_eval( out, TEST_N, sa * sb + sc );
+  result_t expected_flags = RESULT_OK;
+  for ( size_t i = 0; i < TEST_N; i++ ) {
+    fixpoint_t prod, expected;
+    expected_flags |= fixpoint_mul( &prod, &a[i], &b[i] );
+    expected_flags |= fixpoint_add( &expected, &prod, &c[i] );
+    ASSERT( out[i].whole == expected.whole && out[i].frac == expected.frac &&
+            out[i].negative == expected.negative );
+  }
+  ASSERT( flags == expected_flags );
+
+  // scalars broadcast, and out may alias an operand
+  fixpoint_value half( 0, 0x80000000, false );
+  fixpoint_eval( c, TEST_N, -( sa - sb ) * sc * half );
+  for ( size_t i = 0; i < TEST_N; i++ ) {
+    fixpoint_t diff, prod, expected, h = half.c_val();
+    fixpoint_sub( &diff, &a[i], &b[i] );
+    fixpoint_negate( &diff );
+    fixpoint_mul( &prod, &diff, &b[TEST_N - 1 - i] );
+    fixpoint_mul( &expected, &prod, &h );
+    ASSERT( c[i].whole == expected.whole && c[i].frac == expected.frac &&
+            c[i].negative == expected.negative );
+  }
+}
+
+void test_value_misc( TestObjs * ) {
+  fixpoint_value val;
+  ASSERT( fixpoint_value::parse_hex( val, "-f6a5865.00f2" ) );
+  ASSERT( strcmp( val.format_hex().str, "-f6a5865.00f2" ) == 0 );
+  ASSERT( !fixpoint_value::parse_hex( val, "1" ) );
+
+  ASSERT( fixpoint_value( 0, 0, true ) == fixpoint_value() );
+  ASSERT( fixpoint_value( 1, 0, true ) != fixpoint_value( 1, 0, false ) );
+
+  // the sum overflows to 2^-32, then the product underflows
+  fixpoint_value max( 0xFFFFFFFF, 0xFFFFFFFF, false ), tiny( 0, 1, false ), r;
+  ASSERT( r.assign( ( max + tiny + tiny ) * tiny + tiny ) == ( RESULT_OVERFLOW | RESULT_UNDERFLOW ) );
+  ASSERT( r == tiny );
+
+  fixpoint_value vals[3] = { fixpoint_value( 1, 0, false ), fixpoint_value( 2, 0, true ), fixpoint_value() };
+  ASSERT( fixpoint_value::c_ptr( vals )[1].whole == 2 && fixpoint_value::c_ptr( vals )[1].negative );
+}
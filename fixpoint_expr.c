@@ -0,0 +1,372 @@
+#include "fixpoint_expr.h"
+#include <ctype.h>
+#include <stdlib.h>
+#include <string.h>
+
+////////////////////////////////////////////////////////////////////////
+// Data types
+////////////////////////////////////////////////////////////////////////
+
+// Bytecode operations. The interpreter is a stack machine whose
+// stack entries are blocks of FIXPOINT_EXPR_BLOCK values.
+enum {
+  OP_LOAD,  // push column arg
+  OP_CONST, // push constant arg
+  OP_ADD,   // pop right, pop left, push left + right
+  OP_SUB,   // pop right, pop left, push left - right
+  OP_MUL,   // pop right, pop left, push left * right
+  OP_NEG,   // pop value, push -value
+};
+
+typedef struct {
+  uint32_t op;
+  uint32_t arg;
+} instr_t;
+
+struct fixpoint_expr {
+  instr_t *code;
+  size_t ncode;
+  fixpoint_t *consts;       // one broadcast block per constant
+  size_t nconsts;
+  fixpoint_t *scratch;      // one block per stack slot
+  const fixpoint_t **stack; // current block of each stack slot
+  size_t max_depth;
+};
+
+// Compiler state
+typedef struct {
+  const char *src;
+  const char *p;  // current position
+  const char *const *vars;
+  size_t nvars;
+  const char *error; // position of the first error, or NULL
+  instr_t *code;
+  size_t ncode, code_cap;
+  fixpoint_t *consts; // constant values
+  size_t nconsts, consts_cap;
+  size_t depth, max_depth;
+} compiler_t;
+
+////////////////////////////////////////////////////////////////////////
+// Helper functions
+////////////////////////////////////////////////////////////////////////
+
+/**
+ * Records a compile error at the current position (the first one wins).
+ * param- c pointer to the compiler state.
+ */
+static void compile_error(compiler_t *c) {
+  if (!c->error)
+    c->error = c->p;
+}
+
+/**
+ * Appends an instruction and tracks the stack depth.
+ * param-
+ *  c pointer to the compiler state.
+ *  op operation.
+ *  arg operand (column or constant index).
+ */
+static void emit(compiler_t *c, uint32_t op, uint32_t arg) {
+  if (c->error)
+    return;
+  if (c->ncode == c->code_cap) {
+    size_t cap = c->code_cap ? 2 * c->code_cap : 16;
+    instr_t *code = realloc(c->code, cap * sizeof(instr_t));
+    if (!code) {
+      compile_error(c);
+      return;
+    }
+    c->code = code;
+    c->code_cap = cap;
+  }
+  c->code[c->ncode].op = op;
+  c->code[c->ncode].arg = arg;
+  c->ncode++;
+
+  if (op == OP_LOAD || op == OP_CONST) {
+    if (++c->depth > c->max_depth)
+      c->max_depth = c->depth;
+  } else if (op != OP_NEG) {
+    c->depth--; // binary operators pop two values and push one
+  }
+}
+
+/**
+ * Adds a constant to the constant table.
+ * param-
+ *  c pointer to the compiler state.
+ *  val the constant.
+ * return- index of the constant.
+ */
+static uint32_t add_const(compiler_t *c, const fixpoint_t *val) {
+  if (c->nconsts == c->consts_cap) {
+    size_t cap = c->consts_cap ? 2 * c->consts_cap : 8;
+    fixpoint_t *consts = realloc(c->consts, cap * sizeof(fixpoint_t));
+    if (!consts) {
+      compile_error(c);
+      return 0;
+    }
+    c->consts = consts;
+    c->consts_cap = cap;
+  }
+  c->consts[c->nconsts] = *val;
+  return (uint32_t)c->nconsts++;
+}
+
+/**
+ * Skips whitespace.
+ * param- c pointer to the compiler state.
+ */
+static void skip_space(compiler_t *c) {
+  while (isspace((unsigned char)*c->p))
+    c->p++;
+}
+
+/**
+ * Parses a decimal constant such as "12" or "0.375". The fraction is
+ * converted exactly and truncated to 32 bits: each doubling of the
+ * decimal fraction digits produces the next binary digit. Only the
+ * first 32 decimal digits can affect the truncated value.
+ * param-
+ *  c pointer to the compiler state (positioned at the first digit).
+ *  val pointer to store the value.
+ * return- true if the constant is valid and in range.
+ */
+static bool parse_decimal(compiler_t *c, fixpoint_t *val) {
+  uint64_t whole = 0;
+  while (isdigit((unsigned char)*c->p)) {
+    whole = whole * 10 + (uint64_t)(*c->p - '0');
+    if (whole > 0xFFFFFFFFu)
+      return false;
+    c->p++;
+  }
+
+  uint8_t digits[32];
+  int ndigits = 0;
+  if (*c->p == '.') {
+    c->p++;
+    if (!isdigit((unsigned char)*c->p))
+      return false;
+    while (isdigit((unsigned char)*c->p)) {
+      if (ndigits < 32)
+        digits[ndigits++] = (uint8_t)(*c->p - '0');
+      c->p++;
+    }
+  }
+
+  uint32_t frac = 0;
+  for (int bit = 0; bit < 32; bit++) {
+    int carry = 0;
+    for (int i = ndigits - 1; i >= 0; i--) {
+      int d = digits[i] * 2 + carry;
+      digits[i] = (uint8_t)(d % 10);
+      carry = d / 10;
+    }
+    frac = (frac << 1) | (uint32_t)carry;
+  }
+
+  fixpoint_init(val, (uint32_t)whole, frac, false);
+  return true;
+}
+
+static void parse_expr(compiler_t *c);
+
+/**
+ * Parses a number, a variable, or a parenthesized expression.
+ * param- c pointer to the compiler state.
+ */
+static void parse_primary(compiler_t *c) {
+  skip_space(c);
+  if (isdigit((unsigned char)*c->p)) {
+    fixpoint_t val;
+    const char *start = c->p;
+    if (!parse_decimal(c, &val)) {
+      c->p = start;
+      compile_error(c);
+      return;
+    }
+    emit(c, OP_CONST, add_const(c, &val));
+  } else if (isalpha((unsigned char)*c->p) || *c->p == '_') {
+    const char *start = c->p;
+    while (isalnum((unsigned char)*c->p) || *c->p == '_')
+      c->p++;
+    size_t len = (size_t)(c->p - start);
+    for (size_t i = 0; i < c->nvars; i++) {
+      if (strlen(c->vars[i]) == len && strncmp(c->vars[i], start, len) == 0) {
+        emit(c, OP_LOAD, (uint32_t)i);
+        return;
+      }
+    }
+    c->p = start; // unknown variable
+    compile_error(c);
+  } else if (*c->p == '(') {
+    c->p++;
+    parse_expr(c);
+    skip_space(c);
+    if (*c->p != ')') {
+      compile_error(c);
+      return;
+    }
+    c->p++;
+  } else {
+    compile_error(c);
+  }
+}
+
+/**
+ * Parses a primary with any number of leading unary minus signs.
+ * param- c pointer to the compiler state.
+ */
+static void parse_unary(compiler_t *c) {
+  skip_space(c);
+  if (*c->p == '-') {
+    c->p++;
+    parse_unary(c);
+    emit(c, OP_NEG, 0);
+  } else {
+    parse_primary(c);
+  }
+}
+
+/**
+ * Parses a product of unary expressions.
+ * param- c pointer to the compiler state.
+ */
+static void parse_term(compiler_t *c) {
+  parse_unary(c);
+  for (;;) {
+    skip_space(c);
+    if (c->error || *c->p != '*')
+      return;
+    c->p++;
+    parse_unary(c);
+    emit(c, OP_MUL, 0);
+  }
+}
+
+/**
+ * Parses a sum/difference of terms.
+ * param- c pointer to the compiler state.
+ */
+static void parse_expr(compiler_t *c) {
+  parse_term(c);
+  for (;;) {
+    skip_space(c);
+    if (c->error || (*c->p != '+' && *c->p != '-'))
+      return;
+    uint32_t op = (*c->p == '+') ? OP_ADD : OP_SUB;
+    c->p++;
+    parse_term(c);
+    emit(c, op, 0);
+  }
+}
+
+////////////////////////////////////////////////////////////////////////
+// Public API functions
+////////////////////////////////////////////////////////////////////////
+
+fixpoint_expr_t *fixpoint_expr_compile(const char *src, const char *const *vars,
+                                       size_t nvars, size_t *err_pos) {
+  compiler_t c;
+  memset(&c, 0, sizeof(c));
+  c.src = src;
+  c.p = src;
+  c.vars = vars;
+  c.nvars = nvars;
+
+  parse_expr(&c);
+  skip_space(&c);
+  if (*c.p != '\0')
+    compile_error(&c); // trailing junk
+
+  fixpoint_expr_t *e = NULL;
+  if (!c.error) {
+    e = calloc(1, sizeof(fixpoint_expr_t));
+    if (e) {
+      e->code = c.code;
+      e->ncode = c.ncode;
+      e->nconsts = c.nconsts;
+      e->max_depth = c.max_depth;
+      e->consts = malloc(c.nconsts * FIXPOINT_EXPR_BLOCK * sizeof(fixpoint_t) + 1);
+      e->scratch = malloc(c.max_depth * FIXPOINT_EXPR_BLOCK * sizeof(fixpoint_t));
+      e->stack = malloc(c.max_depth * sizeof(fixpoint_t *));
+      c.code = NULL;
+      if (!e->consts || !e->scratch || !e->stack) {
+        fixpoint_expr_destroy(e);
+        e = NULL;
+      } else {
+        for (size_t i = 0; i < c.nconsts; i++) // broadcast each constant once
+          for (size_t j = 0; j < FIXPOINT_EXPR_BLOCK; j++)
+            e->consts[i * FIXPOINT_EXPR_BLOCK + j] = c.consts[i];
+      }
+    }
+    if (!e)
+      c.error = src + strlen(src);
+  }
+
+  if (c.error && err_pos)
+    *err_pos = (size_t)(c.error - src);
+  free(c.code);
+  free(c.consts);
+  return e;
+}
+
+result_t fixpoint_expr_eval(fixpoint_expr_t *expr, fixpoint_t *out,
+                            const fixpoint_t *const *cols, size_t n) {
+  result_t flags = RESULT_OK;
+  const fixpoint_t **stack = expr->stack;
+  const instr_t *last = &expr->code[expr->ncode - 1];
+
+  for (size_t off = 0; off < n; off += FIXPOINT_EXPR_BLOCK) {
+    size_t len = n - off < FIXPOINT_EXPR_BLOCK ? n - off : FIXPOINT_EXPR_BLOCK;
+    size_t sp = 0;
+
+    for (const instr_t *pc = expr->code; pc <= last; pc++) {
+      if (pc->op == OP_LOAD) {
+        stack[sp++] = cols[pc->arg] + off;
+        continue;
+      }
+      if (pc->op == OP_CONST) {
+        stack[sp++] = expr->consts + pc->arg * FIXPOINT_EXPR_BLOCK;
+        continue;
+      }
+
+      // results go to the scratch block of their stack slot, except
+      // that the last instruction writes straight into the output
+      size_t slot = (pc->op == OP_NEG) ? sp - 1 : sp - 2;
+      fixpoint_t *dst = (pc == last) ? out + off
+                                     : expr->scratch + slot * FIXPOINT_EXPR_BLOCK;
+      switch (pc->op) {
+      case OP_ADD:
+        flags |= fixpoint_add_n(dst, stack[sp - 2], stack[sp - 1], len);
+        break;
+      case OP_SUB:
+        flags |= fixpoint_sub_n(dst, stack[sp - 2], stack[sp - 1], len);
+        break;
+      case OP_MUL:
+        flags |= fixpoint_mul_n(dst, stack[sp - 2], stack[sp - 1], len);
+        break;
+      case OP_NEG:
+        fixpoint_negate_n(dst, stack[sp - 1], len);
+        break;
+      }
+      stack[slot] = dst;
+      sp = slot + 1;
+    }
+
+    if (last->op == OP_LOAD || last->op == OP_CONST) // a lone operand
+      memmove(out + off, stack[0], len * sizeof(fixpoint_t));
+  }
+  return flags;
+}
+
+void fixpoint_expr_destroy(fixpoint_expr_t *expr) {
+  if (!expr)
+    return;
+  free(expr->code);
+  free(expr->consts);
+  free(expr->scratch);
+  free(expr->stack);
+  free(expr);
+}
@@ -0,0 +1,67 @@
+#ifndef FIXPOINT_EXPR_H
+#define FIXPOINT_EXPR_H
+
+#include "fixpoint.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+////////////////////////////////////////////////////////////////////////
+// Vectorized expression evaluation
+////////////////////////////////////////////////////////////////////////
+
+//! Number of elements an expression is evaluated on at a time.
+//! Each bytecode instruction is applied to a whole block using the
+//! batch kernels, so the dispatch cost is paid once per block and
+//! only one block of each temporary value exists at any time.
+#define FIXPOINT_EXPR_BLOCK 1024
+
+//! A compiled expression (opaque).
+typedef struct fixpoint_expr fixpoint_expr_t;
+
+//! Compile a formula such as "a*b + c - d*0.5" into bytecode.
+//! The formula may use the operators +, - (binary and unary) and *,
+//! parentheses, variable names, and non-negative decimal constants
+//! (e.g., "12", "0.5", "3.1415926"), which are truncated to the
+//! nearest fixpoint_t value toward zero. Operators have the usual
+//! precedence and are left-associative, so the result of evaluating
+//! an expression is exactly the result of calling fixpoint_add,
+//! fixpoint_sub, fixpoint_mul and fixpoint_negate in that order.
+//!
+//! @param src the formula (NUL-terminated)
+//! @param vars names of the variables; variable i refers to the
+//!             i-th column passed to fixpoint_expr_eval
+//! @param nvars number of variables
+//! @param err_pos if not NULL, set to the offset in src of the
+//!                first error if the formula is not valid
+//! @return the compiled expression, or NULL if the formula is not
+//!         valid or memory could not be allocated (in which case
+//!         *err_pos is set to the length of src)
+fixpoint_expr_t *
+fixpoint_expr_compile( const char *src, const char *const *vars, size_t nvars, size_t *err_pos );
+
+//! Evaluate a compiled expression on n rows, storing
+//! out[i] = formula(cols[0][i], cols[1][i], ...).
+//! An expression uses internal scratch memory, so it must not
+//! be evaluated by more than one thread at a time.
+//!
+//! @param expr the compiled expression
+//! @param out pointer to the n results
+//! @param cols pointers to the columns (one per variable, n values each)
+//! @param n number of rows
+//! @return the bitwise OR of the flags of all the operations
+result_t
+fixpoint_expr_eval( fixpoint_expr_t *expr, fixpoint_t *out, const fixpoint_t *const *cols, size_t n );
+
+//! Free a compiled expression.
+//!
+//! @param expr the compiled expression (may be NULL)
+void
+fixpoint_expr_destroy( fixpoint_expr_t *expr );
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // FIXPOINT_EXPR_H
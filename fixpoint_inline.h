@@ -0,0 +1,163 @@
+#ifndef FIXPOINT_INLINE_H
+#define FIXPOINT_INLINE_H
+
+#include "fixpoint.h"
+
+////////////////////////////////////////////////////////////////////////
+// Inline versions of the hot-path functions
+////////////////////////////////////////////////////////////////////////
+
+// Each fixpoint_X_inline function behaves exactly like fixpoint_X
+// (the out-of-line functions in fixpoint.c just call these), but
+// including this header lets the compiler inline the operations into
+// the caller's loops instead of making a call per operation. The
+// helpers are the building blocks fixpoint.c uses for the other
+// operations; they are not part of the stable API.
+
+//! Check whether a value has zero magnitude (regardless of its sign).
+static inline bool fixpoint_is_zero_mag( const fixpoint_t *x ) {
+  return x->whole == 0 && x->frac == 0;
+}
+
+//! Compare the magnitudes of two values (the signs are ignored).
+//!
+//! @return -1 if left < right, 1 if left > right, 0 if equal
+static inline int fixpoint_compare_magnitudes( const fixpoint_t *left, const fixpoint_t *right ) {
+  if ( left->whole != right->whole )
+    return ( left->whole < right->whole ) ? -1 : 1;
+  if ( left->frac != right->frac )
+    return ( left->frac < right->frac ) ? -1 : 1;
+  return 0;
+}
+
+//! Add the magnitudes of two values with the same sign. A zero result
+//! is non-negative unless a negative sum overflowed.
+//!
+//! @param negative true if the result is negative
+//! @return RESULT_OVERFLOW if the sum doesn't fit, RESULT_OK otherwise
+static inline result_t fixpoint_add_magnitudes_same_sign( fixpoint_t *result, const fixpoint_t *left,
+                                                          const fixpoint_t *right, bool negative ) {
+  uint64_t frac_sum = (uint64_t) left->frac + right->frac;
+  uint64_t whole_sum = (uint64_t) left->whole + right->whole + ( frac_sum >> 32 );
+
+  result->frac = (uint32_t) frac_sum;
+  result->whole = (uint32_t) whole_sum;
+  result_t flags = ( whole_sum >> 32 ) ? RESULT_OVERFLOW : RESULT_OK;
+  result->negative = negative && ( !fixpoint_is_zero_mag( result ) || flags );
+  return flags;
+}
+
+//! Subtract the smaller magnitude from the larger one, for values with
+//! opposite signs. The result has the sign of the larger value.
+static inline void fixpoint_subtract_magnitudes_opposite_sign( fixpoint_t *result,
+                                                               const fixpoint_t *larger,
+                                                               const fixpoint_t *smaller ) {
+  uint64_t mag = ( ( (uint64_t) larger->whole << 32 ) | larger->frac ) -
+                 ( ( (uint64_t) smaller->whole << 32 ) | smaller->frac );
+  result->whole = (uint32_t) ( mag >> 32 );
+  result->frac = (uint32_t) mag;
+  result->negative = larger->negative && mag != 0;
+}
+
+//! Combine the four 32x32 bit partial products of two magnitudes
+//! (frac*frac, frac*whole, whole*frac, whole*whole) into the whole and
+//! fraction of the product, discarding the low and high 32 bits.
+//!
+//! @param discarded set to the discarded low 32 bits (for rounding)
+static inline void fixpoint_finalize_mul( uint64_t p0, uint64_t p1, uint64_t p2, uint64_t p3,
+                                          uint32_t *out_frac, uint32_t *out_whole,
+                                          bool *overflow, bool *underflow, uint32_t *discarded ) {
+  *discarded = (uint32_t) p0;
+  *underflow = *discarded != 0;
+
+  uint64_t x1 = ( p0 >> 32 ) + ( p1 & 0xFFFFFFFFu ) + ( p2 & 0xFFFFFFFFu ); // fraction
+  uint64_t x2 = ( p1 >> 32 ) + ( p2 >> 32 ) + p3 + ( x1 >> 32 );           // whole
+  *out_frac = (uint32_t) x1;
+  *out_whole = (uint32_t) x2;
+  *overflow = ( x2 >> 32 ) != 0;
+}
+
+//! Fix the sign of a zero product: it keeps the sign of the exact
+//! product only if bits were lost to overflow or underflow.
+static inline void fixpoint_normalize_zero_mul( fixpoint_t *result, bool underflow,
+                                                bool overflow, bool out_sign ) {
+  if ( fixpoint_is_zero_mag( result ) )
+    result->negative = ( underflow || overflow ) && out_sign;
+}
+
+//! Like fixpoint_init.
+static inline void fixpoint_init_inline( fixpoint_t *val, uint32_t whole, uint32_t frac, bool negative ) {
+  val->whole = whole;
+  val->frac = frac;
+  val->negative = negative && ( whole != 0 || frac != 0 );
+}
+
+//! Like fixpoint_get_whole.
+static inline uint32_t fixpoint_get_whole_inline( const fixpoint_t *val ) {
+  return val->whole;
+}
+
+//! Like fixpoint_get_frac.
+static inline uint32_t fixpoint_get_frac_inline( const fixpoint_t *val ) {
+  return val->frac;
+}
+
+//! Like fixpoint_is_negative.
+static inline bool fixpoint_is_negative_inline( const fixpoint_t *val ) {
+  return val->negative;
+}
+
+//! Like fixpoint_negate.
+static inline void fixpoint_negate_inline( fixpoint_t *val ) {
+  val->negative = !val->negative && !fixpoint_is_zero_mag( val );
+}
+
+//! Like fixpoint_add.
+static inline result_t fixpoint_add_inline( fixpoint_t *result, const fixpoint_t *left,
+                                            const fixpoint_t *right ) {
+  bool lneg = left->negative && !fixpoint_is_zero_mag( left );
+  bool rneg = right->negative && !fixpoint_is_zero_mag( right );
+  if ( lneg == rneg )
+    return fixpoint_add_magnitudes_same_sign( result, left, right, lneg );
+
+  // opposite signs: the magnitude can only shrink, so no overflow
+  if ( fixpoint_compare_magnitudes( left, right ) >= 0 )
+    fixpoint_subtract_magnitudes_opposite_sign( result, left, right );
+  else
+    fixpoint_subtract_magnitudes_opposite_sign( result, right, left );
+  return RESULT_OK;
+}
+
+//! Like fixpoint_sub.
+static inline result_t fixpoint_sub_inline( fixpoint_t *result, const fixpoint_t *left,
+                                            const fixpoint_t *right ) {
+  fixpoint_t neg_right = *right;
+  fixpoint_negate_inline( &neg_right );
+  return fixpoint_add_inline( result, left, &neg_right );
+}
+
+//! Like fixpoint_mul.
+static inline result_t fixpoint_mul_inline( fixpoint_t *result, const fixpoint_t *left,
+                                            const fixpoint_t *right ) {
+  bool out_sign = ( left->negative && !fixpoint_is_zero_mag( left ) ) !=
+                  ( right->negative && !fixpoint_is_zero_mag( right ) );
+  uint64_t a = left->frac, A = left->whole;
+  uint64_t b = right->frac, B = right->whole;
+
+  uint32_t out_frac, out_whole, discarded;
+  bool overflow, underflow;
+  fixpoint_finalize_mul( a * b, a * B, A * b, A * B, &out_frac, &out_whole,
+                         &overflow, &underflow, &discarded );
+  result->frac = out_frac;
+  result->whole = out_whole;
+  result->negative = out_sign;
+  fixpoint_normalize_zero_mul( result, underflow, overflow, out_sign );
+  return ( overflow ? RESULT_OVERFLOW : 0 ) | ( underflow ? RESULT_UNDERFLOW : 0 );
+}
+
+//! Like fixpoint_compare, which compares the magnitudes.
+static inline int fixpoint_compare_inline( const fixpoint_t *left, const fixpoint_t *right ) {
+  return fixpoint_compare_magnitudes( left, right );
+}
+
+#endif // FIXPOINT_INLINE_H
@@ -0,0 +1,795 @@
+#include "fixpoint_pipeline.h"
+#include <errno.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+#if defined(__linux__) && defined(__has_include)
+#if __has_include(<linux/io_uring.h>)
+#define HAVE_IO_URING 1
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#endif
+#endif
+
+////////////////////////////////////////////////////////////////////////
+// Ring helper functions
+////////////////////////////////////////////////////////////////////////
+
+/**
+ * Waits a little longer each time it is called: first by spinning,
+ * then by giving up the CPU, then by sleeping (so a stage that waits
+ * for long doesn't take a CPU from the others).
+ * param- spins: number of calls so far (reset it when the wait ends).
+ */
+static void backoff(unsigned *spins) {
+  unsigned n = (*spins)++;
+  if (n < 64) {
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_ia32_pause();
+#endif
+  } else if (n < 128) {
+    sched_yield();
+  } else {
+    struct timespec ts = {0, 50000};
+    nanosleep(&ts, NULL);
+  }
+}
+
+/**
+ * Pushes an item onto a ring that can't be full (the rings of the
+ * pipeline have room for every chunk).
+ * param- ring: the ring.
+ * param- item: the item.
+ */
+static void push_always(fixpoint_ring_t *ring, void *item) {
+  unsigned spins = 0;
+  while (!fixpoint_ring_push(ring, item))
+    backoff(&spins);
+}
+
+/**
+ * Pops an item from a ring, waiting until there is one.
+ * param- ring: the ring.
+ * return- the item.
+ */
+static void *pop_wait(fixpoint_ring_t *ring) {
+  void *item;
+  unsigned spins = 0;
+  while (!fixpoint_ring_pop(ring, &item))
+    backoff(&spins);
+  return item;
+}
+
+////////////////////////////////////////////////////////////////////////
+// Reader helper functions
+////////////////////////////////////////////////////////////////////////
+
+#define DEFAULT_CHUNK_SIZE (256 * 1024)
+#define DEFAULT_DEPTH 4
+
+// A token longer than FIXPOINT_HEX_MAX_LEN is invalid whatever follows,
+// so only this much of a token that spans chunks is carried over
+#define MAX_CARRY (FIXPOINT_HEX_MAX_LEN + 1)
+#define HEADROOM 32 // room for the carry in front of a chunk's data
+
+#define URING_READS 4 // reads in flight with io_uring
+
+enum { READ_PLAIN, READ_PREAD, READ_URING };
+
+// Text cut at a separator, and the values parsed from it
+typedef struct {
+  char *buf;         // HEADROOM + chunk_size bytes
+  char *text;        // the text, in buf
+  size_t len;        // its length
+  fixpoint_t *vals;  // the values
+  uint64_t *invalid; // bitmap of the invalid values
+  size_t n;          // number of values
+} chunk_t;
+
+#ifdef HAVE_IO_URING
+// An io_uring instance with URING_READS buffers; read k of the file
+// (at offset k * chunk_size) goes to buffer k % URING_READS
+typedef struct {
+  int fd;
+  unsigned *sq_tail, *sq_mask, *sq_array;
+  unsigned *cq_head, *cq_tail, *cq_mask;
+  struct io_uring_sqe *sqes;
+  struct io_uring_cqe *cqes;
+  void *sq_ptr, *cq_ptr;
+  size_t sq_size, cq_size, sqes_size;
+  char *bufs[URING_READS];
+  uint64_t offsets[URING_READS]; // file offset of each buffer's read
+  int32_t results[URING_READS];  // result of each completed read
+  bool pending[URING_READS];     // submitted, not yet completed
+  bool done[URING_READS];        // completed, not yet consumed
+  uint64_t next_offset;          // offset of the next read to submit
+  unsigned next;                 // buffer of the next read to consume
+  bool at_end;                   // a read returned end of file
+} uring_t;
+#endif
+
+// The reading stage
+typedef struct {
+  int fd;
+  int mode;
+  size_t chunk_size;
+  const bool *is_sep;
+  uint64_t offset;        // offset of the next pread
+  bool eof;               // no more data
+  char carry[MAX_CARRY];  // start of a token that continues in the next chunk
+  size_t carry_len;
+  uint64_t bytes;         // bytes read
+  bool used_io_uring;
+#ifdef HAVE_IO_URING
+  uring_t uring;
+#endif
+} reader_t;
+
+#ifdef HAVE_IO_URING
+/**
+ * Unmaps the rings and frees the buffers of an io_uring instance,
+ * after waiting for reads in flight (the kernel may still write the
+ * buffers).
+ * param- u: the instance.
+ */
+static void uring_close(uring_t *u) {
+  for (unsigned i = 0; i < URING_READS; i++) {
+    while (u->pending[i]) {
+      unsigned head = *u->cq_head;
+      if (head == __atomic_load_n(u->cq_tail, __ATOMIC_ACQUIRE)) {
+        if (syscall(__NR_io_uring_enter, u->fd, 0, 1, IORING_ENTER_GETEVENTS, NULL, 0) < 0 &&
+            errno != EINTR)
+          break;
+        continue;
+      }
+      u->pending[u->cqes[head & *u->cq_mask].user_data] = false;
+      __atomic_store_n(u->cq_head, head + 1, __ATOMIC_RELEASE);
+    }
+  }
+  if (u->sqes)
+    munmap(u->sqes, u->sqes_size);
+  if (u->cq_ptr && u->cq_ptr != u->sq_ptr)
+    munmap(u->cq_ptr, u->cq_size);
+  if (u->sq_ptr)
+    munmap(u->sq_ptr, u->sq_size);
+  close(u->fd);
+  for (unsigned i = 0; i < URING_READS; i++)
+    free(u->bufs[i]);
+}
+
+/**
+ * Submits the read of the next part of the file into one buffer.
+ * param- u: the instance.
+ * param- file: the file.
+ * param- size: number of bytes to read.
+ * param- i: the buffer.
+ * return- 0 or an errno value.
+ */
+static int uring_submit(uring_t *u, int file, size_t size, unsigned i) {
+  unsigned tail = *u->sq_tail, index = tail & *u->sq_mask;
+  struct io_uring_sqe *sqe = &u->sqes[index];
+  memset(sqe, 0, sizeof(*sqe));
+  sqe->opcode = IORING_OP_READ;
+  sqe->fd = file;
+  sqe->addr = (uint64_t)(uintptr_t)u->bufs[i];
+  sqe->len = (uint32_t)size;
+  sqe->off = u->next_offset;
+  sqe->user_data = i;
+  u->sq_array[index] = index;
+  __atomic_store_n(u->sq_tail, tail + 1, __ATOMIC_RELEASE);
+  while (syscall(__NR_io_uring_enter, u->fd, 1, 0, 0, NULL, 0) < 0) {
+    if (errno != EINTR && errno != EAGAIN)
+      return errno; // not submitted, so there is nothing to wait for
+  }
+  u->offsets[i] = u->next_offset;
+  u->next_offset += size;
+  u->pending[i] = true;
+  return 0;
+}
+
+/**
+ * Sets up an io_uring instance and submits the first reads.
+ * param- u: the instance.
+ * param- file: the file.
+ * param- size: the size of each read.
+ * return- true if successful, false if io_uring can't be used.
+ */
+static bool uring_open(uring_t *u, int file, size_t size) {
+  memset(u, 0, sizeof(*u));
+  struct io_uring_params p;
+  memset(&p, 0, sizeof(p));
+  u->fd = (int)syscall(__NR_io_uring_setup, URING_READS, &p);
+  if (u->fd < 0)
+    return false; // ENOSYS on old kernels, EPERM if it is disabled
+
+  u->sq_size = p.sq_off.array + p.sq_entries * sizeof(unsigned);
+  u->cq_size = p.cq_off.cqes + p.cq_entries * sizeof(struct io_uring_cqe);
+  if (p.features & IORING_FEAT_SINGLE_MMAP) {
+    if (u->cq_size > u->sq_size)
+      u->sq_size = u->cq_size;
+    u->cq_size = u->sq_size;
+  }
+  u->sq_ptr = mmap(NULL, u->sq_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                   u->fd, IORING_OFF_SQ_RING);
+  if (u->sq_ptr == MAP_FAILED) {
+    u->sq_ptr = NULL;
+    uring_close(u);
+    return false;
+  }
+  if (p.features & IORING_FEAT_SINGLE_MMAP) {
+    u->cq_ptr = u->sq_ptr;
+  } else {
+    u->cq_ptr = mmap(NULL, u->cq_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                     u->fd, IORING_OFF_CQ_RING);
+    if (u->cq_ptr == MAP_FAILED) {
+      u->cq_ptr = NULL;
+      uring_close(u);
+      return false;
+    }
+  }
+  u->sqes_size = p.sq_entries * sizeof(struct io_uring_sqe);
+  u->sqes = mmap(NULL, u->sqes_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                 u->fd, IORING_OFF_SQES);
+  if (u->sqes == MAP_FAILED) {
+    u->sqes = NULL;
+    uring_close(u);
+    return false;
+  }
+  char *sq = u->sq_ptr, *cq = u->cq_ptr;
+  u->sq_tail = (unsigned *)(sq + p.sq_off.tail);
+  u->sq_mask = (unsigned *)(sq + p.sq_off.ring_mask);
+  u->sq_array = (unsigned *)(sq + p.sq_off.array);
+  u->cq_head = (unsigned *)(cq + p.cq_off.head);
+  u->cq_tail = (unsigned *)(cq + p.cq_off.tail);
+  u->cq_mask = (unsigned *)(cq + p.cq_off.ring_mask);
+  u->cqes = (struct io_uring_cqe *)(cq + p.cq_off.cqes);
+
+  for (unsigned i = 0; i < URING_READS; i++) {
+    if (!(u->bufs[i] = malloc(size)) || uring_submit(u, file, size, i) != 0) {
+      uring_close(u);
+      return false;
+    }
+  }
+  return true;
+}
+
+/**
+ * Waits for the next read in file order.
+ * param- u: the instance.
+ * return- the read's result (bytes read or a negated errno value).
+ */
+static int32_t uring_wait(uring_t *u) {
+  unsigned i = u->next;
+  while (!u->done[i]) {
+    unsigned head = *u->cq_head;
+    if (head == __atomic_load_n(u->cq_tail, __ATOMIC_ACQUIRE)) {
+      if (syscall(__NR_io_uring_enter, u->fd, 0, 1, IORING_ENTER_GETEVENTS, NULL, 0) < 0 &&
+          errno != EINTR)
+        return -errno;
+      continue;
+    }
+    struct io_uring_cqe *cqe = &u->cqes[head & *u->cq_mask];
+    unsigned j = (unsigned)cqe->user_data;
+    u->results[j] = cqe->res;
+    u->pending[j] = false;
+    u->done[j] = true;
+    __atomic_store_n(u->cq_head, head + 1, __ATOMIC_RELEASE);
+  }
+  return u->results[i];
+}
+#endif
+
+/**
+ * Reads the next block of the file.
+ * param- r: the reader.
+ * param- data: where to put the bytes (room for chunk_size).
+ * param- got: set to the number of bytes read (0 at end of file).
+ * return- 0 or an errno value.
+ */
+static int read_block(reader_t *r, char *data, size_t *got) {
+  ssize_t n = 0;
+  switch (r->mode) {
+#ifdef HAVE_IO_URING
+  case READ_URING: {
+    uring_t *u = &r->uring;
+    unsigned i = u->next;
+    int32_t res = uring_wait(u);
+    if (res < 0 && r->bytes == 0 && (res == -EINVAL || res == -EOPNOTSUPP)) {
+      // the kernel has io_uring but not IORING_OP_READ (before 5.6)
+      uring_close(u);
+      r->mode = READ_PREAD;
+      return read_block(r, data, got);
+    }
+    if (res < 0)
+      return -res;
+    u->done[i] = false;
+    u->next = (i + 1) % URING_READS;
+    memcpy(data, u->bufs[i], (size_t)res);
+    size_t total = (size_t)res;
+    // a short read leaves a gap before the next buffer's offset
+    while (res > 0 && total < r->chunk_size) {
+      n = pread(r->fd, data + total, r->chunk_size - total, (off_t)(u->offsets[i] + total));
+      if (n < 0 && errno == EINTR)
+        continue;
+      if (n < 0)
+        return errno;
+      if (n == 0)
+        break;
+      total += (size_t)n;
+    }
+    if (total < r->chunk_size)
+      u->at_end = true;
+    if (!u->at_end) {
+      int err = uring_submit(u, r->fd, r->chunk_size, i);
+      if (err)
+        return err;
+    }
+    if (total)
+      r->used_io_uring = true;
+    *got = total;
+    return 0;
+  }
+#endif
+  case READ_PREAD:
+    while ((n = pread(r->fd, data, r->chunk_size, (off_t)r->offset)) < 0 && errno == EINTR)
+      ;
+    break;
+  default:
+    while ((n = read(r->fd, data, r->chunk_size)) < 0 && errno == EINTR)
+      ;
+    break;
+  }
+  if (n < 0)
+    return errno;
+  r->offset += (uint64_t)n;
+  *got = (size_t)n;
+  return 0;
+}
+
+/**
+ * Fills a chunk with the next text that ends at a separator (or at the
+ * end of the file).
+ * param- r: the reader.
+ * param- c: the chunk.
+ * return- 1 if the chunk was filled, 0 at the end of the file, or a
+ *         negated errno value.
+ */
+static int reader_fill(reader_t *r, chunk_t *c) {
+  char *data = c->buf + HEADROOM;
+  for (;;) {
+    size_t got = 0;
+    if (!r->eof) {
+      int err = read_block(r, data, &got);
+      if (err)
+        return -err;
+      r->bytes += got;
+      r->eof = got == 0;
+    }
+    if (r->eof && r->carry_len == 0)
+      return 0;
+
+    c->text = data - r->carry_len;
+    memcpy(c->text, r->carry, r->carry_len);
+    size_t len = r->carry_len + got;
+    if (r->eof) { // the last token
+      c->len = len;
+      r->carry_len = 0;
+      return 1;
+    }
+    size_t cut = len;
+    while (cut > 0 && !r->is_sep[(unsigned char)c->text[cut - 1]])
+      cut--;
+    r->carry_len = len - cut < MAX_CARRY ? len - cut : MAX_CARRY;
+    memcpy(r->carry, c->text + cut, r->carry_len);
+    if (cut > 0) {
+      c->len = cut;
+      return 1;
+    }
+    // no separator yet: the whole text is the start of one token
+  }
+}
+
+/**
+ * Sets up the reading stage.
+ * param- r: the reader.
+ * param- fd: the file.
+ * param- chunk_size: bytes per read.
+ * param- is_sep: the separator table.
+ * param- no_io_uring: true to use pread even if io_uring works.
+ */
+static void reader_init(reader_t *r, int fd, size_t chunk_size, const bool *is_sep,
+                        bool no_io_uring) {
+  memset(r, 0, sizeof(*r));
+  r->fd = fd;
+  r->chunk_size = chunk_size;
+  r->is_sep = is_sep;
+  struct stat st;
+  r->mode = fstat(fd, &st) == 0 && S_ISREG(st.st_mode) ? READ_PREAD : READ_PLAIN;
+#ifdef HAVE_IO_URING
+  if (r->mode == READ_PREAD && !no_io_uring && uring_open(&r->uring, fd, chunk_size))
+    r->mode = READ_URING;
+#else
+  (void)no_io_uring;
+#endif
+}
+
+/**
+ * Releases the resources of the reading stage.
+ * param- r: the reader.
+ */
+static void reader_cleanup(reader_t *r) {
+#ifdef HAVE_IO_URING
+  if (r->mode == READ_URING)
+    uring_close(&r->uring);
+#endif
+  r->mode = READ_PLAIN;
+}
+
+////////////////////////////////////////////////////////////////////////
+// Pipeline helper functions
+////////////////////////////////////////////////////////////////////////
+
+typedef struct {
+  reader_t reader;
+  bool is_sep[256];
+  unsigned nparsers;
+  fixpoint_ring_t *to_parser;   // reader -> parser i
+  fixpoint_ring_t *from_parser; // parser i -> sink
+  fixpoint_ring_t free_chunks;  // sink -> reader
+  int error;                    // read error (set by the reader)
+} pipeline_t;
+
+typedef struct {
+  pipeline_t *p;
+  unsigned index;
+} parser_arg_t;
+
+// Sent through every ring after the last chunk
+static chunk_t end_marker;
+
+/**
+ * Parses the text of a chunk. Runs of separators become one '\n' (in
+ * place) and a separator at the start is dropped, so that there are
+ * no empty tokens.
+ * param- c: the chunk.
+ * param- is_sep: the separator table.
+ */
+static void parse_chunk(chunk_t *c, const bool *is_sep) {
+  char *t = c->text;
+  size_t w = 0;
+  bool sep = true;
+  for (size_t i = 0; i < c->len; i++) {
+    unsigned char ch = (unsigned char)t[i];
+    if (!is_sep[ch]) {
+      t[w++] = (char)ch;
+      sep = false;
+    } else if (!sep) {
+      t[w++] = '\n';
+      sep = true;
+    }
+  }
+  // each token takes at least 2 characters with its separator
+  size_t max_vals = (w + 1) / 2;
+  memset(c->invalid, 0, FIXPOINT_STATUS_WORDS(max_vals) * sizeof(uint64_t));
+  c->n = fixpoint_parse_hex_n(c->vals, max_vals, t, w, '\n', c->invalid, NULL);
+}
+
+/**
+ * Counts the invalid values of a chunk.
+ * param- c: the chunk.
+ * return- the count.
+ */
+static uint64_t count_invalid(const chunk_t *c) {
+  uint64_t count = 0;
+  for (size_t i = 0; i < FIXPOINT_STATUS_WORDS(c->n); i++)
+    count += (uint64_t)__builtin_popcountll(c->invalid[i]);
+  return count;
+}
+
+/**
+ * Passes a parsed chunk to the sink and counts it.
+ * param- c: the chunk.
+ * param- sink: the sink.
+ * param- ctx: its argument.
+ * param- stats: the counts.
+ */
+static void deliver(const chunk_t *c, fixpoint_pipeline_sink_t sink, void *ctx,
+                    fixpoint_pipeline_stats_t *stats) {
+  if (c->n)
+    sink(ctx, c->vals, c->n, c->invalid);
+  stats->chunks++;
+  stats->values += c->n;
+  stats->invalid += count_invalid(c);
+}
+
+static void *reader_main(void *arg) {
+  pipeline_t *p = arg;
+  uint64_t seq = 0;
+  for (;;) {
+    chunk_t *c = pop_wait(&p->free_chunks);
+    int res = reader_fill(&p->reader, c);
+    if (res < 0)
+      p->error = -res;
+    if (res <= 0)
+      break;
+    push_always(&p->to_parser[seq++ % p->nparsers], c);
+  }
+  for (unsigned i = 0; i < p->nparsers; i++)
+    push_always(&p->to_parser[i], &end_marker);
+  return NULL;
+}
+
+static void *parser_main(void *arg) {
+  parser_arg_t *a = arg;
+  pipeline_t *p = a->p;
+  for (;;) {
+    chunk_t *c = pop_wait(&p->to_parser[a->index]);
+    if (c != &end_marker)
+      parse_chunk(c, p->is_sep);
+    push_always(&p->from_parser[a->index], c);
+    if (c == &end_marker)
+      return NULL;
+  }
+}
+
+/**
+ * Allocates zeroed memory on a cache line boundary (rings are
+ * cache line aligned).
+ * param- size: number of bytes.
+ * return- the memory, or NULL if out of memory.
+ */
+static void *alloc_lines(size_t size) {
+  size = (size + 63) & ~(size_t)63;
+  void *mem = aligned_alloc(64, size);
+  if (mem)
+    memset(mem, 0, size);
+  return mem;
+}
+
+/**
+ * Frees chunks.
+ * param- chunks: the chunks (may be NULL).
+ * param- n: number of chunks.
+ */
+static void free_chunks(chunk_t *chunks, size_t n) {
+  for (size_t i = 0; chunks && i < n; i++) {
+    free(chunks[i].buf);
+    free(chunks[i].vals);
+    free(chunks[i].invalid);
+  }
+  free(chunks);
+}
+
+/**
+ * Allocates chunks.
+ * param- n: number of chunks.
+ * param- chunk_size: bytes read per chunk.
+ * return- the chunks, or NULL if out of memory.
+ */
+static chunk_t *alloc_chunks(size_t n, size_t chunk_size) {
+  chunk_t *chunks = calloc(n, sizeof(chunk_t));
+  size_t max_vals = (HEADROOM + chunk_size + 1) / 2;
+  for (size_t i = 0; chunks && i < n; i++) {
+    chunks[i].buf = malloc(HEADROOM + chunk_size);
+    chunks[i].vals = malloc(max_vals * sizeof(fixpoint_t));
+    chunks[i].invalid = malloc(FIXPOINT_STATUS_WORDS(max_vals) * sizeof(uint64_t));
+    if (!chunks[i].buf || !chunks[i].vals || !chunks[i].invalid) {
+      free_chunks(chunks, i + 1);
+      return NULL;
+    }
+  }
+  return chunks;
+}
+
+/**
+ * Runs every stage in the calling thread.
+ * param- p: the pipeline (only the reader and separators are used).
+ * param- chunk_size: bytes read per chunk.
+ * param- sink: the sink.
+ * param- ctx: its argument.
+ * param- stats: the counts.
+ * return- 0 or an errno value.
+ */
+static int run_serial(pipeline_t *p, size_t chunk_size, fixpoint_pipeline_sink_t sink,
+                      void *ctx, fixpoint_pipeline_stats_t *stats) {
+  chunk_t *c = alloc_chunks(1, chunk_size);
+  if (!c)
+    return ENOMEM;
+  int res;
+  while ((res = reader_fill(&p->reader, c)) > 0) {
+    parse_chunk(c, p->is_sep);
+    deliver(c, sink, ctx, stats);
+  }
+  free_chunks(c, 1);
+  return -res;
+}
+
+/**
+ * Runs the stages on their own threads, with the sink in the calling
+ * thread. The rings have room for every chunk, so a push never waits.
+ * param- p: the pipeline, with the rings set up and free_chunks full.
+ * param- ordered: true to deliver chunks in input order.
+ * param- sink: the sink.
+ * param- ctx: its argument.
+ * param- stats: the counts.
+ * return- 0 or an errno value.
+ */
+static int run_threads(pipeline_t *p, bool ordered, fixpoint_pipeline_sink_t sink,
+                       void *ctx, fixpoint_pipeline_stats_t *stats) {
+  unsigned n = p->nparsers;
+  pthread_t reader, *parsers = malloc(n * sizeof(pthread_t));
+  parser_arg_t *args = malloc(n * sizeof(parser_arg_t));
+  unsigned started = 0;
+  int err = parsers && args ? 0 : ENOMEM;
+  for (; !err && started < n; started++) {
+    args[started].p = p;
+    args[started].index = started;
+    err = pthread_create(&parsers[started], NULL, parser_main, &args[started]);
+    if (err)
+      break;
+  }
+  if (!err)
+    err = pthread_create(&reader, NULL, reader_main, p);
+  if (err) {
+    // stop the parsers that did start (this thread stands in for the
+    // reader, which isn't running)
+    for (unsigned i = 0; i < started; i++) {
+      push_always(&p->to_parser[i], &end_marker);
+      pthread_join(parsers[i], NULL);
+    }
+    free(parsers);
+    free(args);
+    return err;
+  }
+
+  if (ordered) {
+    for (uint64_t seq = 0;; seq++) {
+      chunk_t *c = pop_wait(&p->from_parser[seq % n]);
+      if (c == &end_marker)
+        break; // the reader sent it after the last chunk
+      deliver(c, sink, ctx, stats);
+      push_always(&p->free_chunks, c);
+    }
+  } else {
+    unsigned ends = 0, spins = 0;
+    while (ends < n) {
+      bool any = false;
+      for (unsigned i = 0; i < n; i++) {
+        void *item;
+        if (!fixpoint_ring_pop(&p->from_parser[i], &item))
+          continue;
+        any = true;
+        if (item == &end_marker) {
+          ends++;
+        } else {
+          deliver(item, sink, ctx, stats);
+          push_always(&p->free_chunks, item);
+        }
+      }
+      if (any)
+        spins = 0;
+      else
+        backoff(&spins);
+    }
+  }
+
+  pthread_join(reader, NULL);
+  for (unsigned i = 0; i < n; i++)
+    pthread_join(parsers[i], NULL);
+  free(parsers);
+  free(args);
+  return p->error;
+}
+
+////////////////////////////////////////////////////////////////////////
+// Public functions
+////////////////////////////////////////////////////////////////////////
+
+bool fixpoint_ring_init(fixpoint_ring_t *ring, size_t capacity) {
+  size_t n = 1;
+  while (n < capacity)
+    n *= 2;
+  ring->slots = malloc(n * sizeof(void *));
+  if (!ring->slots)
+    return false;
+  ring->mask = n - 1;
+  atomic_init(&ring->head, 0);
+  atomic_init(&ring->tail, 0);
+  ring->head_cache = ring->tail_cache = 0;
+  return true;
+}
+
+bool fixpoint_ring_push(fixpoint_ring_t *ring, void *item) {
+  size_t tail = atomic_load_explicit(&ring->tail, memory_order_relaxed);
+  if (tail - ring->head_cache > ring->mask) {
+    ring->head_cache = atomic_load_explicit(&ring->head, memory_order_acquire);
+    if (tail - ring->head_cache > ring->mask)
+      return false;
+  }
+  ring->slots[tail & ring->mask] = item;
+  atomic_store_explicit(&ring->tail, tail + 1, memory_order_release);
+  return true;
+}
+
+bool fixpoint_ring_pop(fixpoint_ring_t *ring, void **item) {
+  size_t head = atomic_load_explicit(&ring->head, memory_order_relaxed);
+  if (head == ring->tail_cache) {
+    ring->tail_cache = atomic_load_explicit(&ring->tail, memory_order_acquire);
+    if (head == ring->tail_cache)
+      return false;
+  }
+  *item = ring->slots[head & ring->mask];
+  atomic_store_explicit(&ring->head, head + 1, memory_order_release);
+  return true;
+}
+
+void fixpoint_ring_cleanup(fixpoint_ring_t *ring) {
+  free(ring->slots);
+  ring->slots = NULL;
+}
+
+int fixpoint_pipeline_run(int fd, const fixpoint_pipeline_opts_t *opts,
+                          fixpoint_pipeline_sink_t sink, void *ctx,
+                          fixpoint_pipeline_stats_t *stats) {
+  fixpoint_pipeline_opts_t o = {0};
+  if (opts)
+    o = *opts;
+  size_t chunk_size = o.chunk_size ? o.chunk_size : DEFAULT_CHUNK_SIZE;
+  size_t depth = o.depth ? o.depth : DEFAULT_DEPTH;
+  fixpoint_pipeline_stats_t local;
+  if (!stats)
+    stats = &local;
+  memset(stats, 0, sizeof(*stats));
+
+  pipeline_t *p = alloc_lines(sizeof(pipeline_t));
+  if (!p)
+    return ENOMEM;
+  for (const char *s = o.seps ? o.seps : "\n"; *s; s++)
+    p->is_sep[(unsigned char)*s] = true;
+  reader_init(&p->reader, fd, chunk_size, p->is_sep, o.no_io_uring);
+
+  int err;
+  if (o.parsers == 0) {
+    err = run_serial(p, chunk_size, sink, ctx, stats);
+  } else {
+    unsigned n = p->nparsers = o.parsers;
+    size_t nchunks = n * depth;
+    chunk_t *chunks = alloc_chunks(nchunks, chunk_size);
+    p->to_parser = alloc_lines(n * sizeof(fixpoint_ring_t));
+    p->from_parser = alloc_lines(n * sizeof(fixpoint_ring_t));
+    bool ok = chunks && p->to_parser && p->from_parser &&
+              fixpoint_ring_init(&p->free_chunks, nchunks);
+    // each ring can hold every chunk and the end marker
+    for (unsigned i = 0; ok && i < n; i++)
+      ok = fixpoint_ring_init(&p->to_parser[i], nchunks + 1) &&
+           fixpoint_ring_init(&p->from_parser[i], nchunks + 1);
+    if (ok) {
+      for (size_t i = 0; i < nchunks; i++)
+        fixpoint_ring_push(&p->free_chunks, &chunks[i]);
+      err = run_threads(p, !o.unordered, sink, ctx, stats);
+    } else {
+      err = ENOMEM;
+    }
+    for (unsigned i = 0; i < n; i++) {
+      if (p->to_parser)
+        fixpoint_ring_cleanup(&p->to_parser[i]);
+      if (p->from_parser)
+        fixpoint_ring_cleanup(&p->from_parser[i]);
+    }
+    fixpoint_ring_cleanup(&p->free_chunks);
+    free(p->to_parser);
+    free(p->from_parser);
+    free_chunks(chunks, nchunks);
+  }
+
+  stats->bytes = p->reader.bytes;
+  stats->used_io_uring = p->reader.used_io_uring;
+  reader_cleanup(&p->reader);
+  free(p);
+  return err;
+}
@@ -0,0 +1,133 @@
+#ifndef FIXPOINT_PIPELINE_H
+#define FIXPOINT_PIPELINE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdatomic.h>
+#include "fixpoint.h"
+
+////////////////////////////////////////////////////////////////////////
+// Single-producer single-consumer ring
+////////////////////////////////////////////////////////////////////////
+
+// A bounded FIFO of pointers between exactly two threads: one that
+// pushes and one that pops. Neither side takes a lock; each only
+// writes its own index (and a cached copy of the other's), and the
+// indexes are on separate cache lines.
+//
+// This is a C11 interface; it isn't available to C++.
+
+//! A single-producer single-consumer ring of pointers.
+typedef struct {
+  _Alignas( 64 ) _Atomic size_t head; //!< next slot to pop (written by the consumer)
+  size_t tail_cache;                  //!< consumer's last view of tail
+  _Alignas( 64 ) _Atomic size_t tail; //!< next slot to push (written by the producer)
+  size_t head_cache;                  //!< producer's last view of head
+  _Alignas( 64 ) size_t mask;         //!< number of slots - 1
+  void **slots;                       //!< the slots
+} fixpoint_ring_t;
+
+//! Initialize an empty ring.
+//!
+//! @param ring the ring
+//! @param capacity number of items it can hold (rounded up to a
+//!                 power of 2)
+//! @return true if successful, false if memory could not be allocated
+bool
+fixpoint_ring_init( fixpoint_ring_t *ring, size_t capacity );
+
+//! Add an item at the back of a ring (producer only).
+//!
+//! @param ring the ring
+//! @param item the item
+//! @return true if it was added, false if the ring is full
+bool
+fixpoint_ring_push( fixpoint_ring_t *ring, void *item );
+
+//! Remove the item at the front of a ring (consumer only).
+//!
+//! @param ring the ring
+//! @param item set to the item
+//! @return true if an item was removed, false if the ring is empty
+bool
+fixpoint_ring_pop( fixpoint_ring_t *ring, void **item );
+
+//! Free the memory used by a ring.
+//!
+//! @param ring the ring
+void
+fixpoint_ring_cleanup( fixpoint_ring_t *ring );
+
+////////////////////////////////////////////////////////////////////////
+// Parsing pipeline
+////////////////////////////////////////////////////////////////////////
+
+// fixpoint_pipeline_run parses base-16 values from a file with the
+// reading, parsing and aggregation on different threads:
+//
+//   reader --> parser 1 --> sink (calling thread)
+//          --> parser 2 -->
+//          ...
+//
+// The reader cuts the input into chunks that end at a separator and
+// hands them to the parsers in turn; every arrow is a ring of chunks
+// (plus one more ring returning used chunks to the reader), so the
+// number of chunks in flight, and the memory, is bounded. The sink is
+// called in the calling thread with the values of one chunk at a time,
+// in input order unless unordered is set.
+//
+// Tokens are separated by any of the separator characters, and a run
+// of separators counts as one (so there are no empty tokens). A token
+// is valid if fixpoint_parse_hex accepts it; an invalid one is passed
+// to the sink as zero with its bit set in the invalid bitmap, as by
+// fixpoint_parse_hex_n.
+//
+// Regular files are read with io_uring (several reads in flight) when
+// the kernel supports it, and with pread otherwise; other files, such
+// as pipes, are read with read.
+
+//! Called with the values of one chunk.
+//!
+//! @param ctx the ctx argument of fixpoint_pipeline_run
+//! @param vals the values
+//! @param n number of values
+//! @param invalid bitmap of the invalid values (bit i of word i / 64)
+typedef void ( *fixpoint_pipeline_sink_t )( void *ctx, const fixpoint_t *vals, size_t n,
+                                            const uint64_t *invalid );
+
+//! Options of fixpoint_pipeline_run. Zero fields select the defaults.
+typedef struct {
+  unsigned parsers;  //!< parser threads; 0 runs every stage in the calling thread
+  size_t chunk_size; //!< bytes read per chunk (default 256 KiB)
+  unsigned depth;    //!< chunks in flight per parser (default 4)
+  const char *seps;  //!< separator characters (default "\n")
+  bool unordered;    //!< pass chunks to the sink as they are parsed
+  bool no_io_uring;  //!< use pread even if io_uring is available
+} fixpoint_pipeline_opts_t;
+
+//! What fixpoint_pipeline_run did.
+typedef struct {
+  uint64_t bytes;     //!< bytes read
+  uint64_t chunks;    //!< chunks passed to the sink
+  uint64_t values;    //!< tokens passed to the sink, valid or not
+  uint64_t invalid;   //!< invalid tokens
+  bool used_io_uring; //!< whether the file was read with io_uring
+} fixpoint_pipeline_stats_t;
+
+//! Parse all base-16 values in a file and pass them to a sink.
+//!
+//! @param fd the file, read from its start if it is a regular file and
+//!           from its current position otherwise
+//! @param opts the options, or NULL for the defaults
+//! @param sink called with the values of each chunk
+//! @param ctx passed to sink
+//! @param stats set to what was done (may be NULL)
+//! @return 0 if successful, otherwise an errno value (the sink may
+//!         have seen part of the input)
+int
+fixpoint_pipeline_run( int fd, const fixpoint_pipeline_opts_t *opts,
+                       fixpoint_pipeline_sink_t sink, void *ctx,
+                       fixpoint_pipeline_stats_t *stats );
+
+#endif // FIXPOINT_PIPELINE_H
@@ -0,0 +1,62 @@
+#ifndef FIXPOINT_PROBES_H
+#define FIXPOINT_PROBES_H
+
+#include "fixpoint.h"
+
+////////////////////////////////////////////////////////////////////////
+// Static tracepoints (used by fixpoint.c)
+////////////////////////////////////////////////////////////////////////
+
+// If <sys/sdt.h> (systemtap-sdt-dev) is available when the library is
+// compiled, fixpoint.c gets USDT probes in the "fixpoint" provider:
+//
+//   add_flags, sub_flags, mul_flags
+//       an operation returned RESULT_OVERFLOW and/or RESULT_UNDERFLOW;
+//       arguments: left magnitude (whole << 32 | frac), left negative,
+//       right magnitude, right negative, flags
+//   parse_hex_fail
+//       fixpoint_parse_hex rejected a string; argument: the string
+//   parse_hex_n_fail
+//       fixpoint_parse_hex_n found an invalid token; arguments: token
+//       index, pointer to the token, token length
+//
+// An unused probe is a single nop, so they are always compiled in and
+// can be attached to a running program, e.g.
+//
+//   bpftrace -e 'usdt:./prog:fixpoint:mul_flags { @[arg4] = count(); }'
+//
+// Without <sys/sdt.h>, or with -DFIXPOINT_NO_PROBES, there are no probes.
+
+#if !defined( FIXPOINT_NO_PROBES ) && defined( __has_include )
+#if __has_include( <sys/sdt.h> )
+#include <sys/sdt.h>
+#define FIXPOINT_HAVE_PROBES 1
+#endif
+#endif
+
+#ifdef FIXPOINT_HAVE_PROBES
+//! Point left and right at local copies of the operands, so that
+//! FIXPOINT_PROBE_FLAGS still sees them if the result overwrites one.
+#define FIXPOINT_PROBE_SAVE( left, right )                         \
+  fixpoint_t left##_probe = *( left ), right##_probe = *( right ); \
+  left = &left##_probe;                                            \
+  right = &right##_probe
+//! Fire the op_flags probe for an operation that returned flags.
+#define FIXPOINT_PROBE_FLAGS( op, left, right, flags )                                  \
+  DTRACE_PROBE5( fixpoint, op##_flags,                                                   \
+                 ( (uint64_t) ( left )->whole << 32 ) | ( left )->frac, ( left )->negative, \
+                 ( (uint64_t) ( right )->whole << 32 ) | ( right )->frac,                 \
+                 ( right )->negative, flags )
+//! Fire the parse_hex_fail probe.
+#define FIXPOINT_PROBE_PARSE_HEX_FAIL( str ) DTRACE_PROBE1( fixpoint, parse_hex_fail, str )
+//! Fire the parse_hex_n_fail probe.
+#define FIXPOINT_PROBE_PARSE_HEX_N_FAIL( index, tok, len ) \
+  DTRACE_PROBE3( fixpoint, parse_hex_n_fail, index, tok, len )
+#else
+#define FIXPOINT_PROBE_SAVE( left, right ) ( (void) 0 )
+#define FIXPOINT_PROBE_FLAGS( op, left, right, flags ) ( (void) 0 )
+#define FIXPOINT_PROBE_PARSE_HEX_FAIL( str ) ( (void) 0 )
+#define FIXPOINT_PROBE_PARSE_HEX_N_FAIL( index, tok, len ) ( (void) 0 )
+#endif
+
+#endif // FIXPOINT_PROBES_H
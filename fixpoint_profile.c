@@ -0,0 +1,208 @@
+#include "fixpoint_profile.h"
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+////////////////////////////////////////////////////////////////////////
+// Helper functions
+////////////////////////////////////////////////////////////////////////
+
+#define SUB_BITS 4 // log2 of the number of buckets per power of two
+#define SUB_COUNT (1 << SUB_BITS)
+
+static const char *const func_names[FIXPOINT_PROFILE_NUM_FUNCS] = {
+  [FIXPOINT_PROFILE_PARSE_HEX] = "fixpoint_parse_hex",
+  [FIXPOINT_PROFILE_FORMAT_HEX] = "fixpoint_format_hex",
+  [FIXPOINT_PROFILE_PARSE_HEX_N] = "fixpoint_parse_hex_n",
+  [FIXPOINT_PROFILE_FORMAT_HEX_N] = "fixpoint_format_hex_n",
+};
+
+static _Atomic uint32_t period = FIXPOINT_PROFILE_DEFAULT_PERIOD;
+
+/**
+ * Reads the time stamp counter (or a nanosecond clock on other CPUs).
+ * return- the current time in ticks.
+ */
+static inline uint64_t read_ticks(void) {
+#if defined(__x86_64__) || defined(__i386__)
+  return __rdtsc();
+#else
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000000u + (uint64_t)ts.tv_nsec;
+#endif
+}
+
+#ifdef FIXPOINT_PROFILE
+// Histograms of one thread; only the owning thread writes them
+typedef struct profile_block {
+  _Atomic uint64_t counts[FIXPOINT_PROFILE_NUM_FUNCS]
+                         [FIXPOINT_PROFILE_NUM_BUCKETS];
+  struct profile_block *next;
+} profile_block_t;
+
+_Thread_local uint32_t fixpoint_profile_countdown[FIXPOINT_PROFILE_NUM_FUNCS];
+static _Thread_local profile_block_t *local_block;
+
+// Blocks of all threads that have recorded a sample (pushed at the
+// head, never freed)
+static _Atomic(profile_block_t *) registry;
+
+/**
+ * Allocates and registers the calling thread's histograms.
+ * return- the block, or NULL if out of memory.
+ */
+static profile_block_t *register_block(void) {
+  profile_block_t *b = calloc(1, sizeof(*b));
+  if (!b)
+    return NULL;
+  b->next = atomic_load_explicit(&registry, memory_order_relaxed);
+  while (!atomic_compare_exchange_weak_explicit(
+      &registry, &b->next, b, memory_order_release, memory_order_relaxed))
+    ;
+  local_block = b;
+  return b;
+}
+#endif
+
+////////////////////////////////////////////////////////////////////////
+// Public functions
+////////////////////////////////////////////////////////////////////////
+
+bool fixpoint_profile_enabled(void) {
+#ifdef FIXPOINT_PROFILE
+  return true;
+#else
+  return false;
+#endif
+}
+
+void fixpoint_profile_set_period(uint32_t n) {
+  atomic_store_explicit(&period, n, memory_order_relaxed);
+}
+
+void fixpoint_profile_snapshot(fixpoint_profile_func_t func,
+                               fixpoint_profile_hist_t *hist) {
+  memset(hist, 0, sizeof(*hist));
+#ifdef FIXPOINT_PROFILE
+  for (profile_block_t *b = atomic_load_explicit(&registry, memory_order_acquire);
+       b; b = b->next) {
+    for (size_t i = 0; i < FIXPOINT_PROFILE_NUM_BUCKETS; i++) {
+      uint64_t c = atomic_load_explicit(&b->counts[func][i], memory_order_relaxed);
+      hist->counts[i] += c;
+      hist->samples += c;
+    }
+  }
+#else
+  (void)func;
+#endif
+}
+
+size_t fixpoint_profile_bucket_of(uint64_t ticks) {
+  if (ticks < 2 * SUB_COUNT)
+    return (size_t)ticks;
+  int shift = 63 - __builtin_clzll(ticks) - SUB_BITS;
+  return (size_t)(shift + 1) * SUB_COUNT + (size_t)(ticks >> shift) - SUB_COUNT;
+}
+
+uint64_t fixpoint_profile_bucket_max(size_t bucket) {
+  if (bucket < 2 * SUB_COUNT)
+    return bucket;
+  int shift = (int)(bucket / SUB_COUNT) - 1;
+  uint64_t top = bucket % SUB_COUNT + SUB_COUNT;
+  return ((top + 1) << shift) - 1; // wraps to UINT64_MAX for the last bucket
+}
+
+uint64_t fixpoint_profile_percentile(const fixpoint_profile_hist_t *hist,
+                                     double percentile) {
+  if (hist->samples == 0)
+    return 0;
+  // the smallest bucket with at least this many samples at or below it
+  uint64_t rank = (uint64_t)(percentile / 100 * hist->samples + 0.5);
+  if (rank < 1)
+    rank = 1;
+  uint64_t seen = 0;
+  size_t last = 0;
+  for (size_t i = 0; i < FIXPOINT_PROFILE_NUM_BUCKETS; i++) {
+    if (!hist->counts[i])
+      continue;
+    seen += hist->counts[i];
+    last = i;
+    if (seen >= rank)
+      break;
+  }
+  return fixpoint_profile_bucket_max(last);
+}
+
+double fixpoint_profile_ticks_per_ns(void) {
+  static _Atomic double rate;
+  double r = atomic_load_explicit(&rate, memory_order_relaxed);
+  if (r > 0)
+    return r;
+
+  struct timespec t0, t1;
+  clock_gettime(CLOCK_MONOTONIC, &t0);
+  uint64_t c0 = read_ticks();
+  double ns;
+  do {
+    clock_gettime(CLOCK_MONOTONIC, &t1);
+    ns = (t1.tv_sec - t0.tv_sec) * 1e9 + (t1.tv_nsec - t0.tv_nsec);
+  } while (ns < 1e7);
+  r = (read_ticks() - c0) / ns;
+  atomic_store_explicit(&rate, r, memory_order_relaxed);
+  return r;
+}
+
+void fixpoint_profile_dump(FILE *out) {
+  static const double pcts[] = { 50, 90, 99, 99.9, 100 };
+  double rate = fixpoint_profile_ticks_per_ns();
+  fprintf(out, "%-24s %10s %10s %10s %10s %10s %10s  (ticks; %.3f ticks/ns)\n",
+          "function", "samples", "p50", "p90", "p99", "p99.9", "max", rate);
+  fixpoint_profile_hist_t *hist = malloc(sizeof(*hist));
+  if (!hist)
+    return;
+  for (int f = 0; f < FIXPOINT_PROFILE_NUM_FUNCS; f++) {
+    fixpoint_profile_snapshot((fixpoint_profile_func_t)f, hist);
+    if (!hist->samples)
+      continue;
+    fprintf(out, "%-24s %10llu", func_names[f], (unsigned long long)hist->samples);
+    for (size_t i = 0; i < sizeof(pcts) / sizeof(pcts[0]); i++)
+      fprintf(out, " %10llu",
+              (unsigned long long)fixpoint_profile_percentile(hist, pcts[i]));
+    fprintf(out, "\n");
+  }
+  free(hist);
+}
+
+const char *fixpoint_profile_func_name(fixpoint_profile_func_t func) {
+  if ((int)func < 0 || func >= FIXPOINT_PROFILE_NUM_FUNCS)
+    return "?";
+  return func_names[func];
+}
+
+#ifdef FIXPOINT_PROFILE
+uint64_t fixpoint_profile_start(fixpoint_profile_func_t func) {
+  uint32_t n = atomic_load_explicit(&period, memory_order_relaxed);
+  if (n == 0) {
+    fixpoint_profile_countdown[func] = 1024; // look at the period again later
+    return 0;
+  }
+  fixpoint_profile_countdown[func] = n;
+  uint64_t t = read_ticks();
+  return t ? t : 1;
+}
+
+void fixpoint_profile_stop(fixpoint_profile_func_t func, uint64_t start) {
+  uint64_t ticks = read_ticks() - start;
+  profile_block_t *b = local_block;
+  if (!b && !(b = register_block()))
+    return;
+  _Atomic uint64_t *c = &b->counts[func][fixpoint_profile_bucket_of(ticks)];
+  atomic_store_explicit(c, atomic_load_explicit(c, memory_order_relaxed) + 1,
+                        memory_order_relaxed);
+}
+#endif
@@ -0,0 +1,161 @@
+#ifndef FIXPOINT_PROFILE_H
+#define FIXPOINT_PROFILE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdio.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+////////////////////////////////////////////////////////////////////////
+// Sampled latency histograms
+////////////////////////////////////////////////////////////////////////
+
+// When the library is compiled with -DFIXPOINT_PROFILE (make stats),
+// the text conversion functions time 1 in every N calls with the time
+// stamp counter and record the time in a histogram. Each thread has
+// its own histograms; fixpoint_profile_snapshot adds them up without
+// taking a lock. Without FIXPOINT_PROFILE nothing is timed and the
+// histograms are empty.
+//
+// The histograms are log-linear (like HdrHistogram): times below 32
+// ticks have a bucket each, and every larger power of two is split
+// into 16 buckets, so a bucket's range is within 1/16 of its values.
+
+//! The profiled functions.
+typedef enum {
+  FIXPOINT_PROFILE_PARSE_HEX,
+  FIXPOINT_PROFILE_FORMAT_HEX,
+  FIXPOINT_PROFILE_PARSE_HEX_N,
+  FIXPOINT_PROFILE_FORMAT_HEX_N,
+  FIXPOINT_PROFILE_NUM_FUNCS
+} fixpoint_profile_func_t;
+
+//! Number of histogram buckets (enough for any 64 bit time).
+#define FIXPOINT_PROFILE_NUM_BUCKETS 976
+
+//! Default sampling period.
+#define FIXPOINT_PROFILE_DEFAULT_PERIOD 64
+
+//! Latency histogram of one function, in time stamp counter ticks.
+typedef struct {
+  uint64_t counts[ FIXPOINT_PROFILE_NUM_BUCKETS ]; //!< samples per bucket
+  uint64_t samples;                                //!< total samples
+} fixpoint_profile_hist_t;
+
+//! Check whether the library was compiled with the profiler.
+//!
+//! @return true if FIXPOINT_PROFILE was defined
+bool
+fixpoint_profile_enabled( void );
+
+//! Set how often calls are timed: 1 in every period calls (period 1
+//! times every call, 0 stops timing). Threads pick up the new period
+//! after their next sample.
+//!
+//! @param period the sampling period
+void
+fixpoint_profile_set_period( uint32_t period );
+
+//! Add up one function's histograms of all threads, including threads
+//! that have exited.
+//!
+//! @param func the function
+//! @param hist set to the totals
+void
+fixpoint_profile_snapshot( fixpoint_profile_func_t func, fixpoint_profile_hist_t *hist );
+
+//! Histogram bucket of a time.
+//!
+//! @param ticks the time
+//! @return the bucket index
+size_t
+fixpoint_profile_bucket_of( uint64_t ticks );
+
+//! Largest time in a histogram bucket.
+//!
+//! @param bucket the bucket index
+//! @return the largest time that falls in the bucket
+uint64_t
+fixpoint_profile_bucket_max( size_t bucket );
+
+//! Percentile of a histogram (e.g., 99.9), reported as the largest
+//! time of the bucket containing it, so it overstates the true value
+//! by less than 1/16.
+//!
+//! @param hist the histogram
+//! @param percentile the percentile, from 0 to 100
+//! @return the time in ticks, or 0 if there are no samples
+uint64_t
+fixpoint_profile_percentile( const fixpoint_profile_hist_t *hist, double percentile );
+
+//! Estimate the rate of the time stamp counter (this takes about
+//! 10 ms the first time).
+//!
+//! @return ticks per nanosecond
+double
+fixpoint_profile_ticks_per_ns( void );
+
+//! Print the sample count and the 50th, 90th, 99th and 99.9th
+//! percentiles and the maximum of each function that has samples.
+//!
+//! @param out the stream to print to
+void
+fixpoint_profile_dump( FILE *out );
+
+//! Name of a profiled function (e.g., "fixpoint_parse_hex").
+//!
+//! @param func the function
+//! @return the name, or "?" if func is out of range
+const char *
+fixpoint_profile_func_name( fixpoint_profile_func_t func );
+
+#ifdef __cplusplus
+}
+#endif
+
+////////////////////////////////////////////////////////////////////////
+// Timing (used by fixpoint.c)
+////////////////////////////////////////////////////////////////////////
+
+#if defined( FIXPOINT_PROFILE ) && !defined( __cplusplus )
+
+//! Calls of each function left until the calling thread's next sample
+//! (separate for each function, so that a program alternating between
+//! them doesn't only ever sample one).
+extern _Thread_local uint32_t fixpoint_profile_countdown[ FIXPOINT_PROFILE_NUM_FUNCS ];
+
+//! Start a sampled call of func: reload its countdown and read the
+//! counter.
+//!
+//! @return the start time (never 0), or 0 if sampling is off
+uint64_t
+fixpoint_profile_start( fixpoint_profile_func_t func );
+
+//! Record the time of a sampled call started at start.
+void
+fixpoint_profile_stop( fixpoint_profile_func_t func, uint64_t start );
+
+//! Begin timing a call of func if it is sampled. Declares the start
+//! time, so it must be at the start of a block that ends with
+//! FIXPOINT_PROFILE_END.
+#define FIXPOINT_PROFILE_BEGIN( func )                                                   \
+  uint64_t fixpoint_profile_t0_ = fixpoint_profile_countdown[func] > 1                   \
+                                      ? ( fixpoint_profile_countdown[func]--, (uint64_t) 0 ) \
+                                      : fixpoint_profile_start( func )
+
+//! Finish timing a call of func.
+#define FIXPOINT_PROFILE_END( func )                                                     \
+  do {                                                                                   \
+    if ( fixpoint_profile_t0_ )                                                          \
+      fixpoint_profile_stop( func, fixpoint_profile_t0_ );                               \
+  } while ( 0 )
+#else
+#define FIXPOINT_PROFILE_BEGIN( func ) ( (void) 0 )
+#define FIXPOINT_PROFILE_END( func ) ( (void) 0 )
+#endif
+
+#endif // FIXPOINT_PROFILE_H
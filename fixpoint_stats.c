@@ -0,0 +1,85 @@
+#include "fixpoint_stats.h"
+#include <stdlib.h>
+#include <string.h>
+
+////////////////////////////////////////////////////////////////////////
+// Helper functions
+////////////////////////////////////////////////////////////////////////
+
+static const char *const func_names[FIXPOINT_STATS_NUM_FUNCS] = {
+  [FIXPOINT_STATS_ADD] = "fixpoint_add",
+  [FIXPOINT_STATS_SUB] = "fixpoint_sub",
+  [FIXPOINT_STATS_MUL] = "fixpoint_mul",
+  [FIXPOINT_STATS_MUL_ROUNDED] = "fixpoint_mul_rounded",
+  [FIXPOINT_STATS_ADD_SAT] = "fixpoint_add_sat",
+  [FIXPOINT_STATS_SUB_SAT] = "fixpoint_sub_sat",
+  [FIXPOINT_STATS_MUL_SAT] = "fixpoint_mul_sat",
+  [FIXPOINT_STATS_ADD_N] = "fixpoint_add_n",
+  [FIXPOINT_STATS_SUB_N] = "fixpoint_sub_n",
+  [FIXPOINT_STATS_MUL_N] = "fixpoint_mul_n",
+  [FIXPOINT_STATS_MUL_ROUNDED_N] = "fixpoint_mul_rounded_n",
+  [FIXPOINT_STATS_ADD_SAT_N] = "fixpoint_add_sat_n",
+  [FIXPOINT_STATS_SUB_SAT_N] = "fixpoint_sub_sat_n",
+  [FIXPOINT_STATS_MUL_SAT_N] = "fixpoint_mul_sat_n",
+  [FIXPOINT_STATS_PARSE_HEX] = "fixpoint_parse_hex",
+  [FIXPOINT_STATS_PARSE_HEX_N] = "fixpoint_parse_hex_n",
+};
+
+#ifdef FIXPOINT_STATS
+_Thread_local fixpoint_stats_block_t *fixpoint_stats_local;
+
+// Blocks of all threads that have counted something. Blocks are only
+// ever pushed at the head and never freed, so readers can walk the
+// list while other threads register.
+static _Atomic(fixpoint_stats_block_t *) registry;
+#endif
+
+////////////////////////////////////////////////////////////////////////
+// Public functions
+////////////////////////////////////////////////////////////////////////
+
+bool fixpoint_stats_enabled(void) {
+#ifdef FIXPOINT_STATS
+  return true;
+#else
+  return false;
+#endif
+}
+
+void fixpoint_stats_snapshot(fixpoint_stats_t *stats) {
+  memset(stats, 0, sizeof(*stats));
+#ifdef FIXPOINT_STATS
+  for (fixpoint_stats_block_t *b =
+           atomic_load_explicit(&registry, memory_order_acquire);
+       b; b = b->next) {
+    for (int f = 0; f < FIXPOINT_STATS_NUM_FUNCS; f++) {
+      fixpoint_stats_count_t *c = &stats->funcs[f];
+      c->calls += atomic_load_explicit(&b->counts[f][0], memory_order_relaxed);
+      c->overflow += atomic_load_explicit(&b->counts[f][1], memory_order_relaxed);
+      c->underflow += atomic_load_explicit(&b->counts[f][2], memory_order_relaxed);
+      c->invalid += atomic_load_explicit(&b->counts[f][3], memory_order_relaxed);
+    }
+  }
+#endif
+}
+
+const char *fixpoint_stats_func_name(fixpoint_stats_func_t func) {
+  if ((int)func < 0 || func >= FIXPOINT_STATS_NUM_FUNCS)
+    return "?";
+  return func_names[func];
+}
+
+#ifdef FIXPOINT_STATS
+fixpoint_stats_block_t *fixpoint_stats_register(void) {
+  fixpoint_stats_block_t *b = calloc(1, sizeof(*b));
+  if (!b)
+    return NULL;
+  b->next = atomic_load_explicit(&registry, memory_order_relaxed);
+  while (!atomic_compare_exchange_weak_explicit(&registry, &b->next, b,
+                                                memory_order_release,
+                                                memory_order_relaxed))
+    ;
+  fixpoint_stats_local = b;
+  return b;
+}
+#endif
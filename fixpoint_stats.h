@@ -0,0 +1,137 @@
+#ifndef FIXPOINT_STATS_H
+#define FIXPOINT_STATS_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "fixpoint.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+////////////////////////////////////////////////////////////////////////
+// Call and outcome counters
+////////////////////////////////////////////////////////////////////////
+
+// When the library is compiled with -DFIXPOINT_STATS (make stats), the
+// out-of-line arithmetic and parsing functions count their calls and
+// how many of the calls overflowed, underflowed or had invalid input.
+// Each thread counts into its own block (no lock and no atomic
+// read-modify-write), and fixpoint_stats_snapshot adds up the blocks
+// of all threads without taking a lock. Without FIXPOINT_STATS
+// nothing is counted and the snapshot is all zero.
+//
+// The _inline functions of fixpoint_inline.h are never counted. The
+// batch (_n) functions count one call with the combined flags of all
+// its elements.
+
+//! The counted functions.
+typedef enum {
+  FIXPOINT_STATS_ADD,
+  FIXPOINT_STATS_SUB,
+  FIXPOINT_STATS_MUL,
+  FIXPOINT_STATS_MUL_ROUNDED,
+  FIXPOINT_STATS_ADD_SAT,
+  FIXPOINT_STATS_SUB_SAT,
+  FIXPOINT_STATS_MUL_SAT,
+  FIXPOINT_STATS_ADD_N,
+  FIXPOINT_STATS_SUB_N,
+  FIXPOINT_STATS_MUL_N,
+  FIXPOINT_STATS_MUL_ROUNDED_N,
+  FIXPOINT_STATS_ADD_SAT_N,
+  FIXPOINT_STATS_SUB_SAT_N,
+  FIXPOINT_STATS_MUL_SAT_N,
+  FIXPOINT_STATS_PARSE_HEX,
+  FIXPOINT_STATS_PARSE_HEX_N,
+  FIXPOINT_STATS_NUM_FUNCS
+} fixpoint_stats_func_t;
+
+//! Counts for one function.
+typedef struct {
+  uint64_t calls;     //!< number of calls
+  uint64_t overflow;  //!< calls that returned RESULT_OVERFLOW
+  uint64_t underflow; //!< calls that returned RESULT_UNDERFLOW
+  uint64_t invalid;   //!< parse calls with invalid input
+} fixpoint_stats_count_t;
+
+//! Counts for all functions, indexed by fixpoint_stats_func_t.
+typedef struct {
+  fixpoint_stats_count_t funcs[ FIXPOINT_STATS_NUM_FUNCS ];
+} fixpoint_stats_t;
+
+//! Check whether the library was compiled with the counters.
+//!
+//! @return true if FIXPOINT_STATS was defined
+bool
+fixpoint_stats_enabled( void );
+
+//! Add up the counts of all threads, including threads that have
+//! exited. Counts of threads that are still running may be a few
+//! calls behind.
+//!
+//! @param stats set to the totals
+void
+fixpoint_stats_snapshot( fixpoint_stats_t *stats );
+
+//! Name of a counted function (e.g., "fixpoint_add").
+//!
+//! @param func the function
+//! @return the name, or "?" if func is out of range
+const char *
+fixpoint_stats_func_name( fixpoint_stats_func_t func );
+
+#ifdef __cplusplus
+}
+#endif
+
+////////////////////////////////////////////////////////////////////////
+// Counting (used by fixpoint.c)
+////////////////////////////////////////////////////////////////////////
+
+#if defined( FIXPOINT_STATS ) && !defined( __cplusplus )
+#include <stdatomic.h>
+
+//! Counters of one thread. Only the owning thread writes them, so a
+//! relaxed load and store is enough to increment; other threads only
+//! read them.
+typedef struct fixpoint_stats_block {
+  _Atomic uint64_t counts[ FIXPOINT_STATS_NUM_FUNCS ][ 4 ];
+  struct fixpoint_stats_block *next; //!< next block in the registry
+} fixpoint_stats_block_t;
+
+//! The calling thread's block, or NULL before its first count.
+extern _Thread_local fixpoint_stats_block_t *fixpoint_stats_local;
+
+//! Allocate and register the calling thread's block.
+//!
+//! @return the block, or NULL if out of memory (nothing is counted)
+fixpoint_stats_block_t *
+fixpoint_stats_register( void );
+
+static inline void fixpoint_stats_bump( _Atomic uint64_t *c ) {
+  atomic_store_explicit( c, atomic_load_explicit( c, memory_order_relaxed ) + 1,
+                         memory_order_relaxed );
+}
+
+static inline void fixpoint_stats_record( fixpoint_stats_func_t func, result_t flags, bool invalid ) {
+  fixpoint_stats_block_t *b = fixpoint_stats_local;
+  if ( !b && !( b = fixpoint_stats_register() ) )
+    return;
+  fixpoint_stats_bump( &b->counts[func][0] );
+  if ( flags & RESULT_OVERFLOW )
+    fixpoint_stats_bump( &b->counts[func][1] );
+  if ( flags & RESULT_UNDERFLOW )
+    fixpoint_stats_bump( &b->counts[func][2] );
+  if ( invalid )
+    fixpoint_stats_bump( &b->counts[func][3] );
+}
+
+//! Count a call of func with the given result flags and validity.
+#define FIXPOINT_STATS_RECORD( func, flags, invalid ) fixpoint_stats_record( func, flags, invalid )
+#else
+// the arguments are still mentioned so that variables kept only for
+// counting don't cause unused-variable warnings
+#define FIXPOINT_STATS_RECORD( func, flags, invalid ) ( (void) ( flags ), (void) ( invalid ) )
+#endif
+
+#endif // FIXPOINT_STATS_H
@@ -0,0 +1,315 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "bench.h"
+#include "fixpoint.h"
+
+// Throughput of base-16 parsing and formatting on a synthetic corpus.
+// Usage: fixpoint_textbench [options]
+//   -n count    number of values in the corpus (default 1000000)
+//   -w dist     whole part digit counts: uniform (1-8), short
+//               (mostly 1-3), or full (always 8) (default short)
+//   -f dist     fraction digit counts, same choices (default uniform)
+//   -u rate     probability that a hex letter is uppercase (default 0)
+//   -x rate     probability that a token is invalid (default 0.01)
+//   -m rate     probability that a value is negative (default 0.5)
+//   -s seed     random seed (default 1)
+//   -r reps     timed runs per measurement (default 5)
+//   -c file     also write the corpus (one value per line) to file
+//   -o file     write the results as JSON to file (default: stdout)
+// Numbers worth comparing come from fixpoint_textbench_opt (make opt).
+
+enum { DIST_UNIFORM, DIST_SHORT, DIST_FULL };
+
+typedef struct {
+  size_t count;
+  int whole_dist, frac_dist;
+  double upper_rate, invalid_rate, neg_rate;
+  uint64_t seed;
+  int reps;
+  const char *corpus_file, *out_file;
+} config_t;
+
+// Everything the measured functions need
+typedef struct {
+  char *corpus;
+  size_t corpus_len;
+  size_t count;
+  fixpoint_t *vals;     // parsed values
+  fixpoint_t *expected; // values parsed by the scalar path
+  uint64_t *invalid;
+  char *out;            // formatted text
+  size_t out_len;
+} text_ctx_t;
+
+// Uniform random number in [0, 1)
+static double rand_unit( uint64_t *state ) {
+  return ( bench_rand( state ) >> 11 ) * 0x1p-53;
+}
+
+static int parse_dist( const char *name ) {
+  if ( strcmp( name, "uniform" ) == 0 )
+    return DIST_UNIFORM;
+  if ( strcmp( name, "short" ) == 0 )
+    return DIST_SHORT;
+  if ( strcmp( name, "full" ) == 0 )
+    return DIST_FULL;
+  fprintf( stderr, "unknown digit distribution '%s'\n", name );
+  exit( 1 );
+}
+
+static const char *dist_name( int dist ) {
+  return dist == DIST_UNIFORM ? "uniform" : dist == DIST_SHORT ? "short" : "full";
+}
+
+// Number of digits (1 to 8) drawn from a distribution
+static int draw_digits( int dist, uint64_t *state ) {
+  if ( dist == DIST_FULL )
+    return 8;
+  if ( dist == DIST_UNIFORM )
+    return 1 + (int) ( bench_rand( state ) % 8 );
+  int n = 1; // short: geometric with mean 2
+  while ( n < 8 && ( bench_rand( state ) & 1 ) )
+    n++;
+  return n;
+}
+
+// Append random hex digits, each letter uppercase with the given probability
+static char *put_digits( char *p, int n, double upper_rate, uint64_t *state ) {
+  for ( int i = 0; i < n; i++ ) {
+    int d = (int) ( bench_rand( state ) % 16 );
+    if ( d < 10 )
+      *p++ = (char) ( '0' + d );
+    else
+      *p++ = (char) ( ( rand_unit( state ) < upper_rate ? 'A' : 'a' ) + d - 10 );
+  }
+  return p;
+}
+
+// Generate the corpus: count tokens, one per line. Invalid tokens are
+// damaged in one of the ways seen in real input.
+static void generate_corpus( text_ctx_t *ctx, const config_t *cfg ) {
+  ctx->corpus = malloc( cfg->count * 32 + 1 );
+  if ( !ctx->corpus ) {
+    fprintf( stderr, "out of memory\n" );
+    exit( 1 );
+  }
+  uint64_t state = cfg->seed * 0x9E3779B97F4A7C15ULL + 1;
+  char *p = ctx->corpus;
+  for ( size_t i = 0; i < cfg->count; i++ ) {
+    char *tok = p;
+    if ( rand_unit( &state ) < cfg->neg_rate )
+      *p++ = '-';
+    p = put_digits( p, draw_digits( cfg->whole_dist, &state ), cfg->upper_rate, &state );
+    *p++ = '.';
+    p = put_digits( p, draw_digits( cfg->frac_dist, &state ), cfg->upper_rate, &state );
+
+    if ( rand_unit( &state ) < cfg->invalid_rate ) {
+      switch ( bench_rand( &state ) % 5 ) {
+      case 0: // too many digits
+        p = put_digits( p, 9, 0, &state );
+        break;
+      case 1: // not a hex digit
+        tok[( tok[0] == '-' ) ? 1 : 0] = 'g';
+        break;
+      case 2: // missing point
+        p = tok;
+        p = put_digits( p, 4, 0, &state );
+        break;
+      case 3: // trailing junk
+        *p++ = ' ';
+        break;
+      default: // empty token
+        p = tok;
+        break;
+      }
+    }
+    *p++ = '\n';
+  }
+  *p = '\0';
+  ctx->corpus_len = (size_t) ( p - ctx->corpus );
+  ctx->count = cfg->count;
+}
+
+// Scalar parse: split the lines and call fixpoint_parse_hex on each
+static void scalar_parse( void *arg ) {
+  text_ctx_t *ctx = arg;
+  const char *p = ctx->corpus, *end = ctx->corpus + ctx->corpus_len;
+  size_t i = 0;
+  memset( ctx->invalid, 0, FIXPOINT_STATUS_WORDS( ctx->count ) * sizeof( uint64_t ) );
+  while ( p < end ) {
+    const char *nl = memchr( p, '\n', (size_t) ( end - p ) );
+    size_t len = (size_t) ( nl - p );
+    fixpoint_str_t s;
+    bool ok = len < sizeof( s.str );
+    if ( ok ) {
+      memcpy( s.str, p, len );
+      s.str[len] = '\0';
+      ok = fixpoint_parse_hex( &ctx->vals[i], &s );
+    }
+    if ( !ok ) {
+      fixpoint_init( &ctx->vals[i], 0, 0, false );
+      ctx->invalid[i / 64] |= (uint64_t) 1 << ( i % 64 );
+    }
+    i++;
+    p = nl + 1;
+  }
+}
+
+static void batch_parse( void *arg ) {
+  text_ctx_t *ctx = arg;
+  memset( ctx->invalid, 0, FIXPOINT_STATUS_WORDS( ctx->count ) * sizeof( uint64_t ) );
+  fixpoint_parse_hex_n( ctx->vals, ctx->count, ctx->corpus, ctx->corpus_len, '\n',
+                        ctx->invalid, NULL );
+}
+
+// Scalar format: fixpoint_format_hex, then copy into the output text
+static void scalar_format( void *arg ) {
+  text_ctx_t *ctx = arg;
+  char *p = ctx->out;
+  for ( size_t i = 0; i < ctx->count; i++ ) {
+    fixpoint_str_t s;
+    fixpoint_format_hex( &s, &ctx->expected[i] );
+    size_t len = strlen( s.str );
+    memcpy( p, s.str, len );
+    p[len] = '\n';
+    p += len + 1;
+  }
+  ctx->out_len = (size_t) ( p - ctx->out );
+}
+
+static void batch_format( void *arg ) {
+  text_ctx_t *ctx = arg;
+  ctx->out_len = fixpoint_format_hex_n( ctx->out, ctx->expected, ctx->count, '\n' );
+}
+
+static bool same_values( const fixpoint_t *x, const fixpoint_t *y, size_t n ) {
+  for ( size_t i = 0; i < n; i++ )
+    if ( x[i].whole != y[i].whole || x[i].frac != y[i].frac || x[i].negative != y[i].negative )
+      return false;
+  return true;
+}
+
+static void usage( void ) {
+  fprintf( stderr, "Usage: fixpoint_textbench [-n count] [-w uniform|short|full] "
+                   "[-f uniform|short|full] [-u rate] [-x rate] [-m rate] [-s seed] "
+                   "[-r reps] [-c corpus_file] [-o results_file]\n" );
+  exit( 1 );
+}
+
+int main( int argc, char **argv ) {
+  config_t cfg = { 1000000, DIST_SHORT, DIST_UNIFORM, 0.0, 0.01, 0.5, 1, 5, NULL, NULL };
+  int opt;
+  while ( ( opt = getopt( argc, argv, "n:w:f:u:x:m:s:r:c:o:" ) ) != -1 ) {
+    switch ( opt ) {
+    case 'n': cfg.count = (size_t) strtoul( optarg, NULL, 10 ); break;
+    case 'w': cfg.whole_dist = parse_dist( optarg ); break;
+    case 'f': cfg.frac_dist = parse_dist( optarg ); break;
+    case 'u': cfg.upper_rate = atof( optarg ); break;
+    case 'x': cfg.invalid_rate = atof( optarg ); break;
+    case 'm': cfg.neg_rate = atof( optarg ); break;
+    case 's': cfg.seed = strtoull( optarg, NULL, 10 ); break;
+    case 'r': cfg.reps = atoi( optarg ); break;
+    case 'c': cfg.corpus_file = optarg; break;
+    case 'o': cfg.out_file = optarg; break;
+    default: usage();
+    }
+  }
+  if ( cfg.count == 0 || cfg.reps < 1 )
+    usage();
+
+  text_ctx_t ctx;
+  generate_corpus( &ctx, &cfg );
+  if ( cfg.corpus_file ) {
+    FILE *f = fopen( cfg.corpus_file, "w" );
+    if ( !f || fwrite( ctx.corpus, 1, ctx.corpus_len, f ) != ctx.corpus_len || fclose( f ) != 0 ) {
+      perror( cfg.corpus_file );
+      return 1;
+    }
+  }
+
+  size_t words = FIXPOINT_STATUS_WORDS( ctx.count );
+  ctx.vals = malloc( ctx.count * sizeof( fixpoint_t ) );
+  ctx.expected = malloc( ctx.count * sizeof( fixpoint_t ) );
+  ctx.invalid = malloc( words * sizeof( uint64_t ) );
+  ctx.out = malloc( ctx.count * ( FIXPOINT_HEX_MAX_LEN + 1 ) );
+  uint64_t *expected_invalid = malloc( words * sizeof( uint64_t ) );
+  if ( !ctx.vals || !ctx.expected || !ctx.invalid || !ctx.out || !expected_invalid ) {
+    fprintf( stderr, "out of memory\n" );
+    return 1;
+  }
+
+  // both paths must agree before they are timed
+  scalar_parse( &ctx );
+  memcpy( ctx.expected, ctx.vals, ctx.count * sizeof( fixpoint_t ) );
+  memcpy( expected_invalid, ctx.invalid, words * sizeof( uint64_t ) );
+  batch_parse( &ctx );
+  if ( !same_values( ctx.vals, ctx.expected, ctx.count ) ||
+       memcmp( ctx.invalid, expected_invalid, words * sizeof( uint64_t ) ) != 0 ) {
+    fprintf( stderr, "scalar and batch parsing differ\n" );
+    return 1;
+  }
+  size_t ninvalid = 0;
+  for ( size_t i = 0; i < words; i++ )
+    ninvalid += (size_t) __builtin_popcountll( expected_invalid[i] );
+
+  scalar_format( &ctx );
+  size_t scalar_len = ctx.out_len;
+  char *scalar_out = malloc( scalar_len );
+  if ( !scalar_out ) {
+    fprintf( stderr, "out of memory\n" );
+    return 1;
+  }
+  memcpy( scalar_out, ctx.out, scalar_len );
+  batch_format( &ctx );
+  if ( ctx.out_len != scalar_len || memcmp( ctx.out, scalar_out, scalar_len ) != 0 ) {
+    fprintf( stderr, "scalar and batch formatting differ\n" );
+    return 1;
+  }
+
+  static const struct {
+    const char *op, *path;
+    void ( *fn )( void *arg );
+  } runs[] = {
+    { "parse", "scalar", scalar_parse },
+    { "parse", "batch", batch_parse },
+    { "format", "scalar", scalar_format },
+    { "format", "batch", batch_format },
+  };
+
+  FILE *out = stdout;
+  if ( cfg.out_file && !( out = fopen( cfg.out_file, "w" ) ) ) {
+    perror( cfg.out_file );
+    return 1;
+  }
+  fprintf( out, "{\n  \"corpus\": { \"values\": %zu, \"bytes\": %zu, \"invalid\": %zu, "
+                "\"whole_digits\": \"%s\", \"frac_digits\": \"%s\", \"upper_rate\": %g, "
+                "\"invalid_rate\": %g, \"neg_rate\": %g, \"seed\": %llu },\n  \"results\": [\n",
+           ctx.count, ctx.corpus_len, ninvalid, dist_name( cfg.whole_dist ),
+           dist_name( cfg.frac_dist ), cfg.upper_rate, cfg.invalid_rate, cfg.neg_rate,
+           (unsigned long long) cfg.seed );
+  for ( size_t i = 0; i < sizeof( runs ) / sizeof( runs[0] ); i++ ) {
+    bench_cost_t cost;
+    bench_measure( &cost, NULL, runs[i].fn, &ctx, ctx.count, cfg.reps );
+    // parsing reads the corpus, formatting writes the same text
+    size_t bytes = runs[i].op[0] == 'p' ? ctx.corpus_len : scalar_len;
+    double secs = cost.ns * 1e-9 * ctx.count;
+    fprintf( out, "    { \"op\": \"%s\", \"path\": \"%s\", \"ns_per_value\": %.3f, "
+                  "\"cycles_per_value\": %.2f, \"values_per_sec\": %.0f, \"bytes_per_sec\": %.0f }%s\n",
+             runs[i].op, runs[i].path, cost.ns, cost.cycles, ctx.count / secs, bytes / secs,
+             i + 1 < sizeof( runs ) / sizeof( runs[0] ) ? "," : "" );
+  }
+  fprintf( out, "  ]\n}\n" );
+  if ( out != stdout )
+    fclose( out );
+
+  free( ctx.corpus );
+  free( ctx.vals );
+  free( ctx.expected );
+  free( ctx.invalid );
+  free( ctx.out );
+  free( expected_invalid );
+  free( scalar_out );
+  return 0;
+}
@@ -0,0 +1,219 @@
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "bench.h"
+#include "fixpoint.h"
+#include "fixpoint_column.h"
+#include "fixpoint_inline.h"
+#include "fixpoint_pipeline.h"
+
+// Summary statistics of base-16 values in text files.
+// Usage: fixpoint_tool [-j parsers] [-o column] [-v] [file ...]
+//   -j parsers  parser threads (default: number of CPUs); 0 reads,
+//               parses and adds up in one thread
+//   -o column   also write the valid values to a column file (see
+//               fixpoint_column.h), e.g. to convert text to a column
+//   -v          report bytes read and throughput on stderr
+//
+// The values are read from the files in order, or from standard input
+// if there are none (a file named - is standard input too). Values are
+// separated by newlines, commas, spaces, tabs or carriage returns, so
+// both one value per line and CSV work; empty fields are skipped. A
+// token that fixpoint_parse_hex doesn't accept is counted as invalid
+// and otherwise ignored. A file that is a column file is used as is,
+// without parsing, after its checksums and values are checked.
+//
+// The input is streamed through fixpoint_pipeline_run, so memory use
+// doesn't depend on the size of the input. The statistics are exact:
+// the sum is kept with fixpoint_add plus a count of the times it
+// wrapped around 2^64, so a total that goes out of range and comes
+// back is not lost.
+// The output is
+//   count   number of valid values
+//   invalid number of invalid tokens
+//   sum     the total, with "(overflow)" and the magnitude truncated to
+//           64 bits (as fixpoint_add does) if it doesn't fit
+//   min     smallest value
+//   max     largest value
+//   mean    sum / count, rounded to nearest (ties to even)
+// min, max and mean are "-" if there are no values. The exit status is
+// 1 if a file couldn't be read (or the column couldn't be written), 0
+// otherwise.
+
+// Running statistics
+typedef struct {
+  uint64_t count, invalid;
+  fixpoint_t sum;   // the total, modulo 2^64 in magnitude
+  int64_t wraps;    // total = sum + wraps * 2^64
+  fixpoint_t min, max;
+  fixpoint_column_writer_t *out; // also gets the valid values (or NULL)
+} agg_t;
+
+////////////////////////////////////////////////////////////////////////
+// Aggregation
+////////////////////////////////////////////////////////////////////////
+
+// Compares signed values (fixpoint_compare compares magnitudes)
+static int compare_values( const fixpoint_t *left, const fixpoint_t *right ) {
+  bool lneg = left->negative && !fixpoint_is_zero_mag( left );
+  bool rneg = right->negative && !fixpoint_is_zero_mag( right );
+  if ( lneg != rneg )
+    return lneg ? -1 : 1;
+  int c = fixpoint_compare_magnitudes( left, right );
+  return lneg ? -c : c;
+}
+
+// The sink of the pipeline
+static void agg_values( void *ctx, const fixpoint_t *vals, size_t n, const uint64_t *invalid ) {
+  agg_t *agg = ctx;
+  size_t run = 0; // start of the current run of valid values
+  for ( size_t i = 0; i < n; i++ ) {
+    if ( invalid[i / 64] >> ( i % 64 ) & 1 ) {
+      if ( agg->out )
+        fixpoint_column_write( agg->out, &vals[run], i - run );
+      run = i + 1;
+      agg->invalid++;
+      continue;
+    }
+    // on overflow fixpoint_add keeps the sign and the low 64 bits of
+    // the magnitude, so the total moved 2^64 towards that sign
+    fixpoint_t sum;
+    if ( fixpoint_add_inline( &sum, &agg->sum, &vals[i] ) & RESULT_OVERFLOW )
+      agg->wraps += sum.negative ? -1 : 1;
+    agg->sum = sum;
+    if ( agg->count == 0 || compare_values( &vals[i], &agg->min ) < 0 )
+      agg->min = vals[i];
+    if ( agg->count == 0 || compare_values( &vals[i], &agg->max ) > 0 )
+      agg->max = vals[i];
+    agg->count++;
+  }
+  if ( agg->out )
+    fixpoint_column_write( agg->out, &vals[run], n - run );
+}
+
+// Adds up a column file, which has no invalid values
+static void agg_column( agg_t *agg, const fixpoint_column_t *col ) {
+  static const uint64_t none[FIXPOINT_STATUS_WORDS( 4096 )];
+  for ( uint64_t i = 0; i < col->count; i += 4096 ) {
+    size_t n = col->count - i < 4096 ? (size_t) ( col->count - i ) : 4096;
+    agg_values( agg, col->vals + i, n, none );
+  }
+}
+
+// The exact total, times 2^32
+static __int128 agg_total( const agg_t *agg ) {
+  __int128 mag = ( (uint64_t) agg->sum.whole << 32 ) | agg->sum.frac;
+  return ( agg->sum.negative ? -mag : mag ) + (__int128) agg->wraps * ( (__int128) 1 << 64 );
+}
+
+static void print_value( const char *label, const fixpoint_t *val ) {
+  fixpoint_str_t s;
+  fixpoint_format_hex( &s, val );
+  printf( "%-8s%s\n", label, s.str );
+}
+
+static void agg_print( const agg_t *agg ) {
+  __int128 total = agg_total( agg );
+  unsigned __int128 mag = total < 0 ? -(unsigned __int128) total : (unsigned __int128) total;
+  fixpoint_t val;
+  fixpoint_init( &val, (uint32_t) ( mag >> 32 ), (uint32_t) mag, total < 0 );
+
+  printf( "%-8s%llu\n", "count", (unsigned long long) agg->count );
+  printf( "%-8s%llu\n", "invalid", (unsigned long long) agg->invalid );
+  fixpoint_str_t s;
+  fixpoint_format_hex( &s, &val );
+  printf( "%-8s%s%s\n", "sum", s.str, ( mag >> 64 ) ? " (overflow)" : "" );
+  if ( agg->count == 0 ) {
+    printf( "%-8s-\n%-8s-\n%-8s-\n", "min", "max", "mean" );
+    return;
+  }
+  print_value( "min", &agg->min );
+  print_value( "max", &agg->max );
+
+  // the mean is within the range of the values, so it fits
+  unsigned __int128 q = mag / agg->count, r = mag % agg->count;
+  if ( 2 * r > agg->count || ( 2 * r == agg->count && ( q & 1 ) ) )
+    q++;
+  fixpoint_init( &val, (uint32_t) ( q >> 32 ), (uint32_t) q, total < 0 && q != 0 );
+  print_value( "mean", &val );
+}
+
+int main( int argc, char **argv ) {
+  long ncpu = sysconf( _SC_NPROCESSORS_ONLN );
+  fixpoint_pipeline_opts_t opts = { 0 };
+  opts.parsers = ncpu > 0 ? (unsigned) ncpu : 1;
+  opts.seps = "\n\r\t ,";
+  const char *out_file = NULL;
+  bool verbose = false;
+  int opt;
+  while ( ( opt = getopt( argc, argv, "j:o:v" ) ) != -1 ) {
+    switch ( opt ) {
+    case 'j': opts.parsers = (unsigned) atoi( optarg ); break;
+    case 'o': out_file = optarg; break;
+    case 'v': verbose = true; break;
+    default:
+      fprintf( stderr, "Usage: %s [-j parsers] [-o column] [-v] [file ...]\n", argv[0] );
+      return 2;
+    }
+  }
+
+  agg_t agg = { 0 };
+  fixpoint_column_writer_t writer;
+  fixpoint_column_status_t cs;
+  if ( out_file ) {
+    if ( ( cs = fixpoint_column_writer_open( &writer, out_file, 0 ) ) != FIXPOINT_COLUMN_OK ) {
+      fprintf( stderr, "%s: %s: %s\n", argv[0], out_file, fixpoint_column_strerror( cs ) );
+      return 1;
+    }
+    agg.out = &writer;
+  }
+  int status = 0;
+  uint64_t bytes = 0;
+  bool used_io_uring = false;
+  double start = bench_now_sec();
+  for ( int i = optind; i < argc || i == optind; i++ ) {
+    const char *name = i < argc ? argv[i] : "-";
+    fixpoint_column_t col;
+    cs = strcmp( name, "-" ) == 0 ? FIXPOINT_COLUMN_ERR_NOT_COLUMN
+                                  : fixpoint_column_open( &col, name, true );
+    if ( cs == FIXPOINT_COLUMN_OK ) {
+      agg_column( &agg, &col );
+      bytes += col.map_size;
+      fixpoint_column_close( &col );
+      continue;
+    } else if ( cs != FIXPOINT_COLUMN_ERR_NOT_COLUMN && cs != FIXPOINT_COLUMN_ERR_IO ) {
+      fprintf( stderr, "%s: %s: %s\n", argv[0], name, fixpoint_column_strerror( cs ) );
+      status = 1;
+      continue;
+    }
+
+    // text (an unreadable file is reported below)
+    int fd = strcmp( name, "-" ) == 0 ? STDIN_FILENO : open( name, O_RDONLY );
+    fixpoint_pipeline_stats_t stats;
+    int err = fd < 0 ? errno : fixpoint_pipeline_run( fd, &opts, agg_values, &agg, &stats );
+    if ( err ) {
+      fprintf( stderr, "%s: %s: %s\n", argv[0], name, strerror( err ) );
+      status = 1;
+    } else {
+      bytes += stats.bytes;
+      used_io_uring |= stats.used_io_uring;
+    }
+    if ( fd > STDIN_FILENO )
+      close( fd );
+  }
+  double secs = bench_now_sec() - start;
+  if ( out_file && ( cs = fixpoint_column_writer_close( &writer ) ) != FIXPOINT_COLUMN_OK ) {
+    fprintf( stderr, "%s: %s: %s\n", argv[0], out_file, fixpoint_column_strerror( cs ) );
+    status = 1;
+  }
+
+  agg_print( &agg );
+  if ( verbose )
+    fprintf( stderr, "%llu bytes in %.3f s (%.1f MB/s), %u parser(s)%s\n",
+             (unsigned long long) bytes, secs, secs > 0 ? bytes / secs / 1e6 : 0.0,
+             opts.parsers, used_io_uring ? ", io_uring" : "" );
+  return status;
+}
@@ -0,0 +1,223 @@
+#ifndef FIXPOINT_VALUE_HPP
+#define FIXPOINT_VALUE_HPP
+
+#include <cstddef>
+#include "fixpoint.hpp"
+
+////////////////////////////////////////////////////////////////////////
+// Value wrapper and expression templates for fixpoint_t
+////////////////////////////////////////////////////////////////////////
+
+// Arithmetic operators on fixpoint_value and fixpoint_span don't
+// compute anything: they build a small expression object recording
+// the operations. Assigning an expression to a value, or evaluating
+// it into an array with fixpoint_eval, runs the whole chain inline on
+// each element (using fixpoint<32, 32>, which has exactly the C
+// semantics) and ORs the flags of every operation together, so that
+// e.g. out = a*b + c is a single pass with one flag check at the end.
+// Operations are applied in the same order as the equivalent calls to
+// fixpoint_mul, fixpoint_add, etc., so the results are bit-for-bit
+// the same as with the C API.
+
+namespace fixpoint_detail {
+
+typedef fixpoint<32, 32> q32_32;
+
+//! Base class of all expressions (E is the derived class).
+template <typename E>
+struct expr {
+  constexpr const E &self() const { return static_cast<const E &>( *this ); }
+};
+
+struct add_op {
+  static constexpr result_t apply( q32_32 &r, const q32_32 &l, const q32_32 &rt ) { return q32_32::add( r, l, rt ); }
+};
+struct sub_op {
+  static constexpr result_t apply( q32_32 &r, const q32_32 &l, const q32_32 &rt ) { return q32_32::sub( r, l, rt ); }
+};
+struct mul_op {
+  static constexpr result_t apply( q32_32 &r, const q32_32 &l, const q32_32 &rt ) { return q32_32::mul( r, l, rt ); }
+};
+
+//! left Op right
+template <typename Op, typename L, typename R>
+struct binary_expr : expr<binary_expr<Op, L, R>> {
+  L left;
+  R right;
+  constexpr binary_expr( const L &l, const R &r ) : left( l ), right( r ) { }
+
+  constexpr q32_32 eval( std::size_t i, result_t &flags ) const {
+    q32_32 result;
+    flags |= Op::apply( result, left.eval( i, flags ), right.eval( i, flags ) );
+    return result;
+  }
+};
+
+//! -operand
+template <typename E>
+struct negate_expr : expr<negate_expr<E>> {
+  E operand;
+  constexpr explicit negate_expr( const E &e ) : operand( e ) { }
+
+  constexpr q32_32 eval( std::size_t i, result_t &flags ) const {
+    return operand.eval( i, flags ).negated();
+  }
+};
+
+} // namespace fixpoint_detail
+
+//! A fixpoint_t with value semantics. It has the same layout as
+//! fixpoint_t, so an array of fixpoint_value can be passed to the C API
+//! (see c_ptr()) and vice versa.
+class fixpoint_value : public fixpoint_detail::expr<fixpoint_value> {
+public:
+  //! Zero.
+  constexpr fixpoint_value() : m_val{} { }
+
+  //! Like fixpoint_init.
+  constexpr fixpoint_value( uint32_t whole, uint32_t frac, bool negative )
+    : m_val{} {
+    m_val.whole = whole;
+    m_val.frac = frac;
+    m_val.negative = negative && ( whole != 0 || frac != 0 );
+  }
+
+  constexpr fixpoint_value( const fixpoint_t &val ) : m_val( val ) { }
+
+  //! Evaluate an expression, discarding the flags (use assign() to get them).
+  template <typename E>
+  constexpr fixpoint_value( const fixpoint_detail::expr<E> &e ) : m_val{} {
+    assign( e );
+  }
+
+  template <typename E>
+  constexpr fixpoint_value &operator=( const fixpoint_detail::expr<E> &e ) {
+    assign( e );
+    return *this;
+  }
+
+  //! Evaluate an expression into this value.
+  //!
+  //! @return the bitwise OR of the flags of all the operations
+  template <typename E>
+  constexpr result_t assign( const fixpoint_detail::expr<E> &e ) {
+    result_t flags = RESULT_OK;
+    m_val = e.self().eval( 0, flags ).to_c();
+    return flags;
+  }
+
+  template <typename E>
+  constexpr fixpoint_value &operator+=( const fixpoint_detail::expr<E> &e ) { return *this = *this + e.self(); }
+  template <typename E>
+  constexpr fixpoint_value &operator-=( const fixpoint_detail::expr<E> &e ) { return *this = *this - e.self(); }
+  template <typename E>
+  constexpr fixpoint_value &operator*=( const fixpoint_detail::expr<E> &e ) { return *this = *this * e.self(); }
+
+  constexpr uint32_t whole() const { return m_val.whole; }
+  constexpr uint32_t frac() const { return m_val.frac; }
+  constexpr bool is_negative() const { return m_val.negative; }
+  constexpr const fixpoint_t &c_val() const { return m_val; }
+
+  //! Like fixpoint_compare, which compares the magnitudes.
+  constexpr int compare( const fixpoint_value &other ) const {
+    return fixpoint_detail::q32_32::compare( eval( 0 ), other.eval( 0 ) );
+  }
+
+  //! Equal numeric values (a negative zero equals zero).
+  constexpr bool operator==( const fixpoint_value &other ) const {
+    return m_val.whole == other.m_val.whole && m_val.frac == other.m_val.frac &&
+           ( m_val.negative == other.m_val.negative || ( m_val.whole == 0 && m_val.frac == 0 ) );
+  }
+  constexpr bool operator!=( const fixpoint_value &other ) const { return !( *this == other ); }
+
+  fixpoint_str_t format_hex() const {
+    fixpoint_str_t s;
+    fixpoint_format_hex( &s, &m_val );
+    return s;
+  }
+
+  //! Like fixpoint_parse_hex. Returns false if s is not well-formed.
+  static constexpr bool parse_hex( fixpoint_value &val, const char *s ) {
+    fixpoint_detail::q32_32 parsed;
+    if ( !fixpoint_detail::q32_32::parse_hex( parsed, s ) )
+      return false;
+    val.m_val = parsed.to_c();
+    return true;
+  }
+
+  //! View an array of values as an array of fixpoint_t.
+  static fixpoint_t *c_ptr( fixpoint_value *vals ) { return reinterpret_cast<fixpoint_t *>( vals ); }
+  static const fixpoint_t *c_ptr( const fixpoint_value *vals ) { return reinterpret_cast<const fixpoint_t *>( vals ); }
+
+  //! A value is an expression that broadcasts itself to every element.
+  constexpr fixpoint_detail::q32_32 eval( std::size_t, result_t & ) const { return eval( 0 ); }
+
+private:
+  constexpr fixpoint_detail::q32_32 eval( std::size_t ) const { return fixpoint_detail::q32_32::from_c( m_val ); }
+
+  fixpoint_t m_val;
+};
+
+static_assert( sizeof( fixpoint_value ) == sizeof( fixpoint_t ), "fixpoint_value must have the layout of fixpoint_t" );
+
+//! An array of n values used as an operand of an expression: element i
+//! of the expression uses element i of the array.
+class fixpoint_span : public fixpoint_detail::expr<fixpoint_span> {
+public:
+  constexpr fixpoint_span( const fixpoint_t *data, std::size_t n ) : m_data( data ), m_n( n ) { }
+  fixpoint_span( const fixpoint_value *data, std::size_t n ) : m_data( fixpoint_value::c_ptr( data ) ), m_n( n ) { }
+
+  constexpr std::size_t size() const { return m_n; }
+
+  constexpr fixpoint_detail::q32_32 eval( std::size_t i, result_t & ) const {
+    return fixpoint_detail::q32_32::from_c( m_data[i] );
+  }
+
+private:
+  const fixpoint_t *m_data;
+  std::size_t m_n;
+};
+
+template <typename L, typename R>
+constexpr fixpoint_detail::binary_expr<fixpoint_detail::add_op, L, R>
+operator+( const fixpoint_detail::expr<L> &l, const fixpoint_detail::expr<R> &r ) {
+  return { l.self(), r.self() };
+}
+
+template <typename L, typename R>
+constexpr fixpoint_detail::binary_expr<fixpoint_detail::sub_op, L, R>
+operator-( const fixpoint_detail::expr<L> &l, const fixpoint_detail::expr<R> &r ) {
+  return { l.self(), r.self() };
+}
+
+template <typename L, typename R>
+constexpr fixpoint_detail::binary_expr<fixpoint_detail::mul_op, L, R>
+operator*( const fixpoint_detail::expr<L> &l, const fixpoint_detail::expr<R> &r ) {
+  return { l.self(), r.self() };
+}
+
+template <typename E>
+constexpr fixpoint_detail::negate_expr<E> operator-( const fixpoint_detail::expr<E> &e ) {
+  return fixpoint_detail::negate_expr<E>( e.self() );
+}
+
+//! Evaluate an expression on n elements, storing element i in out[i].
+//! Every fixpoint_span in the expression must have at least n elements,
+//! and out may be one of them.
+//!
+//! @return the bitwise OR of the flags of all the operations
+template <typename E>
+result_t fixpoint_eval( fixpoint_t *out, std::size_t n, const fixpoint_detail::expr<E> &e ) {
+  const E &ex = e.self();
+  result_t flags = RESULT_OK;
+  for ( std::size_t i = 0; i < n; i++ )
+    out[i] = ex.eval( i, flags ).to_c();
+  return flags;
+}
+
+template <typename E>
+result_t fixpoint_eval( fixpoint_value *out, std::size_t n, const fixpoint_detail::expr<E> &e ) {
+  return fixpoint_eval( fixpoint_value::c_ptr( out ), n, e );
+}
+
+#endif // FIXPOINT_VALUE_HPP
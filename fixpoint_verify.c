@@ -0,0 +1,571 @@
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "bench.h"
+#include "fixpoint.h"
+#include "fixpoint_inline.h"
+
+// Differential testing of the fast kernels against a reference.
+// Usage: fixpoint_verify [options]
+//   -n pairs    random operand pairs per operation (default 10000000)
+//   -x          also check every pair of the reduced domain (below)
+//   -t threads  worker threads (default: number of CPUs)
+//   -s seed     random seed (default 1)
+//
+// The reference does add, sub and mul with __int128 arithmetic on the
+// signed values, independently of fixpoint.c. Every kernel for these
+// operations (the scalar functions, the _inline versions, the _n
+// functions with and without a status, and fixpoint_mul_rounded with
+// FIXPOINT_ROUND_TRUNC) must agree with it bit for bit, flags included.
+// fixpoint_parse_hex_n and fixpoint_format_hex_n are checked against
+// fixpoint_parse_hex and fixpoint_format_hex on random text, half of
+// it mutated into (mostly) invalid tokens.
+//
+// Random operands are edge-biased: a whole or frac word is either
+// random or a boundary word (0, 1, all ones, single bits, carry
+// boundaries, ...) nudged by -1, 0 or +1, and zero is drawn with
+// either sign. The right operand is often derived from the left one so
+// that the exact sum is about 2^64 or 0, or the product about 2^96.
+// The reduced domain maps 16 bits to a value: a sign, 7
+// bits choosing one of 128 boundary words for the whole part and 8
+// bits choosing one of 256 for the fraction; -x checks all 2^16 x 2^16
+// pairs of it for each operation.
+//
+// The first mismatch is printed with the operands as C initializers and
+// the exit status is 1.
+
+#define CHUNK 1024        // pairs (or tokens) per unit of work
+#define NUM_BOUNDARY 256  // boundary words (the first 128 are used for whole parts)
+#define DOMAIN_SIZE 65536 // values in the reduced domain
+
+enum { OP_ADD, OP_SUB, OP_MUL, NUM_OPS };
+
+static const char *const op_names[NUM_OPS] = { "add", "sub", "mul" };
+
+typedef struct {
+  uint64_t pairs;
+  bool exhaustive;
+  unsigned threads;
+  uint64_t seed;
+} config_t;
+
+// A kernel computing out[i] = left[i] op right[i]. It sets flags[i] to
+// the element's flags if it can tell them apart, or -1 otherwise, and
+// returns the combined flags.
+typedef struct {
+  const char *name;
+  int op;
+  result_t ( *fn )( fixpoint_t *out, result_t *flags, const fixpoint_t *left,
+                    const fixpoint_t *right, size_t n );
+} kernel_t;
+
+static uint32_t boundary[NUM_BOUNDARY];
+static config_t config;
+static atomic_uint_fast64_t next_chunk;
+static atomic_bool failed;
+static atomic_uint_fast64_t checked[NUM_OPS];
+static atomic_uint_fast64_t checked_text;
+
+////////////////////////////////////////////////////////////////////////
+// Reference implementation
+////////////////////////////////////////////////////////////////////////
+
+static uint64_t mag_of( const fixpoint_t *x ) {
+  return ( (uint64_t) x->whole << 32 ) | x->frac;
+}
+
+static void set_mag( fixpoint_t *x, uint64_t mag, bool negative ) {
+  x->whole = (uint32_t) ( mag >> 32 );
+  x->frac = (uint32_t) mag;
+  x->negative = negative;
+}
+
+static result_t ref_op( int op, fixpoint_t *result, const fixpoint_t *left,
+                        const fixpoint_t *right ) {
+  uint64_t lm = mag_of( left ), rm = mag_of( right );
+  bool ln = left->negative && lm != 0, rn = right->negative && rm != 0;
+
+  if ( op == OP_MUL ) {
+    unsigned __int128 p = (unsigned __int128) lm * rm;
+    bool underflow = (uint32_t) p != 0, overflow = ( p >> 96 ) != 0;
+    uint64_t mag = (uint64_t) ( p >> 32 );
+    set_mag( result, mag, ( ln != rn ) && ( mag != 0 || overflow || underflow ) );
+    return ( overflow ? RESULT_OVERFLOW : 0 ) | ( underflow ? RESULT_UNDERFLOW : 0 );
+  }
+
+  if ( op == OP_SUB )
+    rn = !rn;
+  __int128 sum = ( ln ? -(__int128) lm : (__int128) lm ) + ( rn ? -(__int128) rm : (__int128) rm );
+  bool negative = sum < 0;
+  unsigned __int128 m = negative ? -(unsigned __int128) sum : (unsigned __int128) sum;
+  bool overflow = ( m >> 64 ) != 0;
+  set_mag( result, (uint64_t) m, negative && ( (uint64_t) m != 0 || overflow ) );
+  return overflow ? RESULT_OVERFLOW : RESULT_OK;
+}
+
+////////////////////////////////////////////////////////////////////////
+// Kernels under test
+////////////////////////////////////////////////////////////////////////
+
+#define SCALAR_KERNEL( name, call )                                                       \
+  static result_t name( fixpoint_t *out, result_t *flags, const fixpoint_t *left,         \
+                        const fixpoint_t *right, size_t n ) {                             \
+    result_t all = RESULT_OK;                                                             \
+    for ( size_t i = 0; i < n; i++ )                                                      \
+      all |= flags[i] = call( &out[i], &left[i], &right[i] );                             \
+    return all;                                                                           \
+  }
+
+#define BATCH_KERNEL( name, call )                                                        \
+  static result_t name( fixpoint_t *out, result_t *flags, const fixpoint_t *left,         \
+                        const fixpoint_t *right, size_t n ) {                             \
+    for ( size_t i = 0; i < n; i++ )                                                      \
+      flags[i] = -1;                                                                      \
+    return call( out, left, right, n );                                                   \
+  }
+
+#define STATUS_KERNEL( name, call )                                                       \
+  static result_t name( fixpoint_t *out, result_t *flags, const fixpoint_t *left,         \
+                        const fixpoint_t *right, size_t n ) {                             \
+    uint64_t ov[FIXPOINT_STATUS_WORDS( CHUNK )], un[FIXPOINT_STATUS_WORDS( CHUNK )];      \
+    fixpoint_status_t st;                                                                 \
+    fixpoint_status_init( &st, ov, un, n );                                               \
+    result_t all = call( out, left, right, n, &st );                                      \
+    size_t first = FIXPOINT_STATUS_NONE;                                                  \
+    for ( size_t i = 0; i < n; i++ ) {                                                    \
+      flags[i] = fixpoint_status_get( &st, i );                                           \
+      if ( flags[i] && first == FIXPOINT_STATUS_NONE )                                    \
+        first = i;                                                                        \
+    }                                                                                     \
+    if ( st.first != first ) /* report it at one of the two indices */                    \
+      flags[first != FIXPOINT_STATUS_NONE ? first : st.first < n ? st.first : 0] = -2;    \
+    return all;                                                                           \
+  }
+
+static result_t mul_rounded_trunc( fixpoint_t *result, const fixpoint_t *left,
+                                   const fixpoint_t *right ) {
+  return fixpoint_mul_rounded( result, left, right, FIXPOINT_ROUND_TRUNC );
+}
+
+static result_t mul_rounded_n_trunc( fixpoint_t *out, const fixpoint_t *left,
+                                     const fixpoint_t *right, size_t n ) {
+  return fixpoint_mul_rounded_n( out, left, right, n, FIXPOINT_ROUND_TRUNC );
+}
+
+SCALAR_KERNEL( k_add, fixpoint_add )
+SCALAR_KERNEL( k_add_inline, fixpoint_add_inline )
+BATCH_KERNEL( k_add_n, fixpoint_add_n )
+STATUS_KERNEL( k_add_n_status, fixpoint_add_n_status )
+SCALAR_KERNEL( k_sub, fixpoint_sub )
+SCALAR_KERNEL( k_sub_inline, fixpoint_sub_inline )
+BATCH_KERNEL( k_sub_n, fixpoint_sub_n )
+STATUS_KERNEL( k_sub_n_status, fixpoint_sub_n_status )
+SCALAR_KERNEL( k_mul, fixpoint_mul )
+SCALAR_KERNEL( k_mul_inline, fixpoint_mul_inline )
+BATCH_KERNEL( k_mul_n, fixpoint_mul_n )
+STATUS_KERNEL( k_mul_n_status, fixpoint_mul_n_status )
+SCALAR_KERNEL( k_mul_rounded, mul_rounded_trunc )
+BATCH_KERNEL( k_mul_rounded_n, mul_rounded_n_trunc )
+
+static const kernel_t kernels[] = {
+  { "fixpoint_add", OP_ADD, k_add },
+  { "fixpoint_add_inline", OP_ADD, k_add_inline },
+  { "fixpoint_add_n", OP_ADD, k_add_n },
+  { "fixpoint_add_n_status", OP_ADD, k_add_n_status },
+  { "fixpoint_sub", OP_SUB, k_sub },
+  { "fixpoint_sub_inline", OP_SUB, k_sub_inline },
+  { "fixpoint_sub_n", OP_SUB, k_sub_n },
+  { "fixpoint_sub_n_status", OP_SUB, k_sub_n_status },
+  { "fixpoint_mul", OP_MUL, k_mul },
+  { "fixpoint_mul_inline", OP_MUL, k_mul_inline },
+  { "fixpoint_mul_n", OP_MUL, k_mul_n },
+  { "fixpoint_mul_n_status", OP_MUL, k_mul_n_status },
+  { "fixpoint_mul_rounded(TRUNC)", OP_MUL, k_mul_rounded },
+  { "fixpoint_mul_rounded_n(TRUNC)", OP_MUL, k_mul_rounded_n },
+};
+
+#define NUM_KERNELS ( sizeof( kernels ) / sizeof( kernels[0] ) )
+
+////////////////////////////////////////////////////////////////////////
+// Operands
+////////////////////////////////////////////////////////////////////////
+
+static size_t add_boundary( size_t n, uint32_t w ) {
+  for ( size_t i = 0; i < n; i++ )
+    if ( boundary[i] == w )
+      return n;
+  if ( n < NUM_BOUNDARY )
+    boundary[n++] = w;
+  return n;
+}
+
+// The boundary words, most interesting first: small values, values
+// around the top bit and all ones, then single bits, low and high
+// masks and their neighbors, then fixed random words to fill the table
+static void init_boundary( void ) {
+  static const uint32_t special[] = { 0, 1, 2, 3, 0xFFFFFFFF, 0xFFFFFFFE, 0xFFFFFFFD,
+                                      0x80000000, 0x7FFFFFFF, 0x80000001, 0x7FFFFFFE,
+                                      0x0000FFFF, 0x00010000, 0xFFFF0000, 0x0000FFFE };
+  size_t n = 0;
+  for ( size_t i = 0; i < sizeof( special ) / sizeof( special[0] ); i++ )
+    n = add_boundary( n, special[i] );
+  for ( int b = 0; b < 32; b++ ) {
+    uint32_t bit = (uint32_t) 1 << b, low = bit - 1 + bit; // bits 0..b
+    n = add_boundary( n, bit );
+    n = add_boundary( n, low );
+    n = add_boundary( n, ~low );
+    n = add_boundary( n, ~bit );
+  }
+  for ( int b = 0; b < 32; b++ ) {
+    uint32_t bit = (uint32_t) 1 << b;
+    n = add_boundary( n, bit + 1 );
+    n = add_boundary( n, bit - 1 );
+  }
+  uint64_t state = 0x9E3779B97F4A7C15ULL;
+  while ( n < NUM_BOUNDARY )
+    n = add_boundary( n, (uint32_t) bench_rand( &state ) );
+}
+
+// Random word: half the time uniform, otherwise a boundary word nudged by -1, 0 or +1
+static uint32_t edge_word( uint64_t *state ) {
+  uint64_t r = bench_rand( state );
+  if ( r & 1 )
+    return (uint32_t) ( r >> 32 );
+  return boundary[( r >> 8 ) % NUM_BOUNDARY] + (uint32_t) ( ( r >> 16 ) % 3 ) - 1;
+}
+
+static void edge_value( fixpoint_t *x, uint64_t *state ) {
+  uint64_t r = bench_rand( state );
+  int shape = (int) ( r % 8 );
+  x->whole = shape == 0 ? 0 : edge_word( state ); // small values are common
+  x->frac = shape == 1 ? 0 : edge_word( state );
+  if ( shape == 2 )
+    x->whole = x->frac = 0; // zero, with either sign
+  x->negative = ( r >> 8 ) & 1;
+}
+
+// Random pair: the right operand is often chosen relative to the left
+// one, so that sums and products land exactly on the carry, overflow
+// and cancellation boundaries (which independent values rarely hit)
+static void edge_pair( fixpoint_t *left, fixpoint_t *right, uint64_t *state ) {
+  edge_value( left, state );
+  edge_value( right, state );
+  uint64_t r = bench_rand( state ), lm = mag_of( left );
+  uint64_t delta = ( r >> 8 ) % 3 - 1;
+  switch ( r % 8 ) {
+  case 0: // magnitudes adding up to about 2^64
+    set_mag( right, -lm + delta, right->negative );
+    break;
+  case 1: // about the same magnitude
+    set_mag( right, lm + delta, right->negative );
+    break;
+  case 2: // product about 2^96
+    if ( lm )
+      set_mag( right, (uint64_t) ( ( (unsigned __int128) 1 << 96 ) / lm ) + delta,
+               right->negative );
+    break;
+  }
+}
+
+// Value number v (0 to DOMAIN_SIZE - 1) of the reduced domain
+static void domain_value( fixpoint_t *x, uint32_t v ) {
+  x->negative = ( v >> 15 ) & 1;
+  x->whole = boundary[( v >> 8 ) & 0x7F];
+  x->frac = boundary[v & 0xFF];
+}
+
+////////////////////////////////////////////////////////////////////////
+// Checking
+////////////////////////////////////////////////////////////////////////
+
+// Only the first mismatch is reported
+static bool claim_report( void ) {
+  return !atomic_exchange( &failed, true );
+}
+
+static void print_value( const char *label, const fixpoint_t *x ) {
+  printf( "  fixpoint_t %s = { 0x%08Xu, 0x%08Xu, %s };\n", label, x->whole, x->frac,
+          x->negative ? "true" : "false" );
+}
+
+static bool same_value( const fixpoint_t *a, const fixpoint_t *b ) {
+  return a->whole == b->whole && a->frac == b->frac && a->negative == b->negative;
+}
+
+// Run every kernel of every operation on n pairs and compare with the
+// reference. where describes the pairs for the report.
+static bool check_pairs( const fixpoint_t *left, const fixpoint_t *right, size_t n,
+                         const char *where ) {
+  fixpoint_t expected[CHUNK], got[CHUNK];
+  result_t expected_flags[CHUNK], got_flags[CHUNK];
+
+  for ( int op = 0; op < NUM_OPS; op++ ) {
+    result_t expected_all = RESULT_OK;
+    for ( size_t i = 0; i < n; i++ )
+      expected_all |= expected_flags[i] = ref_op( op, &expected[i], &left[i], &right[i] );
+
+    for ( size_t k = 0; k < NUM_KERNELS; k++ ) {
+      if ( kernels[k].op != op )
+        continue;
+      result_t all = kernels[k].fn( got, got_flags, left, right, n );
+      for ( size_t i = 0; i <= n; i++ ) {
+        bool bad = i < n ? !same_value( &got[i], &expected[i] ) ||
+                               ( got_flags[i] != -1 && got_flags[i] != expected_flags[i] )
+                         : all != expected_all;
+        if ( !bad )
+          continue;
+        if ( claim_report() ) {
+          size_t e = i < n ? i : 0;
+          printf( "MISMATCH: %s (%s, %s element %zu)\n", kernels[k].name, op_names[op], where,
+                  e );
+          print_value( "left", &left[e] );
+          print_value( "right", &right[e] );
+          print_value( "expected", &expected[e] );
+          printf( "  // expected flags %d\n", expected_flags[e] );
+          print_value( "got", &got[e] );
+          if ( i < n )
+            printf( "  // got flags %d (-1: not reported per element, -2: wrong first index)\n",
+                    got_flags[e] );
+          else
+            printf( "  // combined flags of the call: expected %d, got %d\n", expected_all,
+                    all );
+        }
+        return false;
+      }
+    }
+    atomic_fetch_add( &checked[op], n );
+  }
+  return true;
+}
+
+// Append a C string literal of text to stdout
+static void print_literal( const char *text, size_t len ) {
+  putchar( '"' );
+  for ( size_t i = 0; i < len; i++ ) {
+    unsigned char c = (unsigned char) text[i];
+    if ( c == '"' || c == '\\' )
+      printf( "\\%c", c );
+    else if ( c < 32 || c > 126 )
+      printf( "\\x%02x", c );
+    else
+      putchar( c );
+  }
+  putchar( '"' );
+}
+
+// Random token: a formatted edge-biased value, mutated half the time
+static size_t random_token( char *tok, uint64_t *state ) {
+  static const char alphabet[] = "0123456789abcdefABCDEF.-+ xg\t";
+  fixpoint_t x;
+  fixpoint_str_t s;
+  edge_value( &x, state );
+  fixpoint_format_hex( &s, &x );
+  size_t len = strlen( s.str );
+  memcpy( tok, s.str, len );
+
+  uint64_t r = bench_rand( state );
+  if ( r & 1 )
+    return len;
+  char c = alphabet[( r >> 8 ) % ( sizeof( alphabet ) - 1 )];
+  size_t pos = (size_t) ( ( r >> 16 ) % ( len + 1 ) );
+  switch ( ( r >> 24 ) % 6 ) {
+  case 0: // replace a character
+    if ( pos < len )
+      tok[pos] = c;
+    break;
+  case 1: // insert one
+    memmove( tok + pos + 1, tok + pos, len - pos );
+    tok[pos] = c;
+    len++;
+    break;
+  case 2: // delete one
+    if ( pos < len ) {
+      memmove( tok + pos, tok + pos + 1, len - pos - 1 );
+      len--;
+    }
+    break;
+  case 3: // truncate
+    len = pos;
+    break;
+  case 4: // leading zeros
+    memmove( tok + 3, tok, len );
+    memcpy( tok, "000", 3 );
+    len += 3;
+    break;
+  default: // nine more digits
+    memcpy( tok + len, "123456789", 9 );
+    len += 9;
+    break;
+  }
+  return len;
+}
+
+// Check fixpoint_parse_hex_n and fixpoint_format_hex_n on one chunk of text
+static bool check_text( uint64_t *state, const char *where ) {
+  static _Thread_local char buf[CHUNK * 40], ref_buf[CHUNK * ( FIXPOINT_HEX_MAX_LEN + 1 )],
+      out_buf[CHUNK * ( FIXPOINT_HEX_MAX_LEN + 1 )];
+  size_t start[CHUNK + 1], len = 0;
+  for ( size_t i = 0; i < CHUNK; i++ ) {
+    start[i] = len;
+    len += random_token( buf + len, state );
+    buf[len++] = '\n';
+  }
+  start[CHUNK] = len;
+
+  fixpoint_t vals[CHUNK];
+  uint64_t invalid[FIXPOINT_STATUS_WORDS( CHUNK )] = { 0 };
+  size_t consumed;
+  size_t n = fixpoint_parse_hex_n( vals, CHUNK, buf, len, '\n', invalid, &consumed );
+  for ( size_t i = 0; i < CHUNK; i++ ) {
+    size_t tok_len = start[i + 1] - 1 - start[i];
+    fixpoint_str_t s;
+    fixpoint_t expected = { 0, 0, false };
+    memcpy( s.str, buf + start[i], tok_len );
+    s.str[tok_len] = '\0';
+    bool ok = fixpoint_parse_hex( &expected, &s );
+    if ( !ok )
+      fixpoint_init( &expected, 0, 0, false );
+    bool got_ok = !( ( invalid[i / 64] >> ( i % 64 ) ) & 1 );
+    if ( n == CHUNK && consumed == len && ok == got_ok && same_value( &vals[i], &expected ) )
+      continue;
+    if ( claim_report() ) {
+      printf( "MISMATCH: fixpoint_parse_hex_n (%s, token %zu)\n  token: ", where, i );
+      print_literal( buf + start[i], tok_len );
+      printf( "\n  fixpoint_parse_hex: %s\n", ok ? "valid" : "invalid" );
+      print_value( "expected", &expected );
+      printf( "  fixpoint_parse_hex_n: %s (%zu tokens, %zu of %zu characters)\n",
+              got_ok ? "valid" : "invalid", n, consumed, len );
+      print_value( "got", &vals[i] );
+    }
+    return false;
+  }
+
+  // format the parsed values back
+  size_t ref_len = 0;
+  for ( size_t i = 0; i < CHUNK; i++ ) {
+    fixpoint_str_t s;
+    fixpoint_format_hex( &s, &vals[i] );
+    size_t l = strlen( s.str );
+    memcpy( ref_buf + ref_len, s.str, l );
+    ref_len += l;
+    ref_buf[ref_len++] = '\n';
+  }
+  size_t out_len = fixpoint_format_hex_n( out_buf, vals, CHUNK, '\n' );
+  if ( out_len != ref_len || memcmp( out_buf, ref_buf, ref_len ) != 0 ) {
+    size_t i = 0, line = 0;
+    while ( i < out_len && i < ref_len && out_buf[i] == ref_buf[i] )
+      line += out_buf[i++] == '\n';
+    if ( claim_report() ) {
+      printf( "MISMATCH: fixpoint_format_hex_n (%s, value %zu)\n", where, line );
+      print_value( "val", &vals[line] );
+      printf( "  differs at character %zu of the output\n", i );
+    }
+    return false;
+  }
+  atomic_fetch_add( &checked_text, CHUNK );
+  return true;
+}
+
+////////////////////////////////////////////////////////////////////////
+// Work
+////////////////////////////////////////////////////////////////////////
+
+// Chunks of work: the random pairs, then the random text, then (with
+// -x) the reduced domain in rows of one left value
+static uint64_t num_pair_chunks, num_text_chunks, num_domain_chunks;
+
+static void *worker( void *arg ) {
+  (void) arg;
+  fixpoint_t left[CHUNK], right[CHUNK];
+  char where[96];
+  uint64_t total = num_pair_chunks + num_text_chunks + num_domain_chunks;
+
+  while ( !atomic_load( &failed ) ) {
+    uint64_t c = atomic_fetch_add( &next_chunk, 1 );
+    if ( c >= total )
+      break;
+
+    if ( c < num_pair_chunks + num_text_chunks ) {
+      // every chunk has its own random state, so runs are repeatable
+      uint64_t state = config.seed * 0x9E3779B97F4A7C15ULL + c * 0xBF58476D1CE4E5B9ULL + 1;
+      snprintf( where, sizeof( where ), "seed %llu chunk %llu", (unsigned long long) config.seed,
+                (unsigned long long) c );
+      if ( c >= num_pair_chunks ) {
+        check_text( &state, where );
+        continue;
+      }
+      size_t n = CHUNK;
+      if ( c == num_pair_chunks - 1 && config.pairs % CHUNK )
+        n = config.pairs % CHUNK;
+      for ( size_t i = 0; i < n; i++ )
+        edge_pair( &left[i], &right[i], &state );
+      check_pairs( left, right, n, where );
+      continue;
+    }
+
+    // one row of the reduced domain
+    uint32_t a = (uint32_t) ( c - num_pair_chunks - num_text_chunks );
+    for ( size_t i = 0; i < CHUNK; i++ )
+      domain_value( &left[i], a );
+    for ( uint32_t b = 0; b < DOMAIN_SIZE && !atomic_load( &failed ); b += CHUNK ) {
+      for ( size_t i = 0; i < CHUNK; i++ )
+        domain_value( &right[i], b + (uint32_t) i );
+      snprintf( where, sizeof( where ), "domain %u x %u", a, b );
+      check_pairs( left, right, CHUNK, where );
+    }
+    if ( a % 4096 == 4095 )
+      fprintf( stderr, "domain: %u of %u rows\n", a + 1, DOMAIN_SIZE );
+  }
+  return NULL;
+}
+
+int main( int argc, char **argv ) {
+  long ncpu = sysconf( _SC_NPROCESSORS_ONLN );
+  config.pairs = 10000000;
+  config.exhaustive = false;
+  config.threads = ncpu > 0 ? (unsigned) ncpu : 1;
+  config.seed = 1;
+
+  int opt;
+  while ( ( opt = getopt( argc, argv, "n:xt:s:" ) ) != -1 ) {
+    switch ( opt ) {
+    case 'n': config.pairs = strtoull( optarg, NULL, 0 ); break;
+    case 'x': config.exhaustive = true; break;
+    case 't': config.threads = (unsigned) atoi( optarg ); break;
+    case 's': config.seed = strtoull( optarg, NULL, 0 ); break;
+    default:
+      fprintf( stderr, "Usage: %s [-n pairs] [-x] [-t threads] [-s seed]\n", argv[0] );
+      return 2;
+    }
+  }
+  if ( config.threads < 1 )
+    config.threads = 1;
+
+  init_boundary();
+  num_pair_chunks = ( config.pairs + CHUNK - 1 ) / CHUNK;
+  num_text_chunks = ( num_pair_chunks + 7 ) / 8; // text is slower, so check less of it
+  num_domain_chunks = config.exhaustive ? DOMAIN_SIZE : 0;
+
+  double start = bench_now_sec();
+  pthread_t *threads = malloc( config.threads * sizeof( pthread_t ) );
+  unsigned started = 0;
+  while ( threads && started < config.threads &&
+          pthread_create( &threads[started], NULL, worker, NULL ) == 0 )
+    started++;
+  if ( started == 0 )
+    worker( NULL );
+  for ( unsigned t = 0; t < started; t++ )
+    pthread_join( threads[t], NULL );
+  free( threads );
+  double secs = bench_now_sec() - start;
+
+  for ( int op = 0; op < NUM_OPS; op++ )
+    printf( "%s: %llu pairs\n", op_names[op], (unsigned long long) atomic_load( &checked[op] ) );
+  printf( "text: %llu tokens\n", (unsigned long long) atomic_load( &checked_text ) );
+  printf( "%.1f s with %u thread(s): %s\n", secs, started ? started : 1,
+          atomic_load( &failed ) ? "MISMATCH" : "no mismatches" );
+  return atomic_load( &failed ) ? 1 : 0;
+}
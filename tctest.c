@@ -25,6 +25,11 @@
 #include <signal.h>
 #include <unistd.h>
 #include <stdarg.h>
+#include <stdlib.h>
+#include <errno.h>
+#include <time.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
 #include "tctest.h"
 
 typedef struct {
@@ -49,6 +54,74 @@ int tctest_num_executed;
 const char *tctest_testname_to_execute;
 void (*tctest_on_test_executed)(const char *testname, int passed);
 void (*tctest_on_complete)(int num_passed, int num_executed);
+double tctest_last_test_sec;
+int tctest_num_jobs;
+int tctest_report_times;
+int tctest_bench_mode;
+double tctest_bench_sample_sec = 0.01;
+int tctest_bench_samples = 10;
+
+/*
+ * State of the parallel runner. The tests are numbered in the order
+ * their TEST macros are reached. Each worker holds a claim on one test
+ * number (taken from the shared counter) and runs that test when it
+ * gets to it, then takes a new claim; since claims only increase, every
+ * test is run by at most one worker. Once the workers are gone, the
+ * parent goes through the TEST macros itself and reports each test
+ * from its slot, so a test no worker finished is still reported.
+ */
+#define TCTEST_MAX_TESTS 4096
+
+enum { TCTEST_SEQUENTIAL, TCTEST_PARENT, TCTEST_WORKER };
+enum { TCTEST_NOT_RUN, TCTEST_RUNNING, TCTEST_DONE };
+
+typedef struct {
+	int state;
+	int passed;
+	int worker;            /* index of the worker that ran the test */
+	double sec;
+	long out_start;        /* the test's output in the worker's file */
+	long out_end;          /* (-1 if the worker died during the test) */
+} tctest_slot;
+
+typedef struct {
+	int next_claim;
+	int num_tests;         /* (-1 until a worker gets past the last test) */
+	tctest_slot slots[TCTEST_MAX_TESTS];
+} tctest_shared;
+
+static int tctest_role = TCTEST_SEQUENTIAL;
+static tctest_shared *tctest_sh;
+static int tctest_worker_index;
+static int tctest_claim;
+static int tctest_test_counter;
+static double tctest_test_start;
+
+/* Output file and process of each worker (in the parent) */
+static FILE **tctest_worker_out;
+static pid_t *tctest_worker_pid;
+static int tctest_num_workers;
+
+/* Results collected for tctest_write_report */
+typedef struct {
+	const char *name;
+	int passed;
+	double sec;
+} tctest_result;
+
+static const char *tctest_report_file;
+static tctest_result *tctest_results;
+static int tctest_num_results;
+static void (*tctest_prev_on_test_executed)(const char *testname, int passed);
+static void (*tctest_prev_on_complete)(int num_passed, int num_executed);
+
+/* State of the running benchmark (iters is 0 before its first call) */
+static long tctest_bench_iters;
+static int tctest_bench_calibrating;
+static int tctest_bench_taken;
+static double tctest_bench_mean;
+static double tctest_bench_m2;
+static double tctest_bench_t0;
 
 /*
  * Special version of write to work around the fact that
@@ -150,3 +223,351 @@ void tctest_fail(const char *fmt, ...) {
 	/* jump back to the TEST context */
 	siglongjmp(tctest_env, 1);
 }
+
+static double tctest_now(void) {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+/*
+ * Fork a new worker. Returns 0 in the worker, 1 in the parent,
+ * and -1 if the worker could not be started.
+ */
+static int tctest_spawn_worker(void) {
+	int w = tctest_num_workers;
+	FILE **out = realloc(tctest_worker_out, (w + 1) * sizeof(FILE *));
+	if (out)
+		tctest_worker_out = out;
+	pid_t *pids = realloc(tctest_worker_pid, (w + 1) * sizeof(pid_t));
+	if (pids)
+		tctest_worker_pid = pids;
+	if (!out || !pids || !(out[w] = tmpfile()))
+		return -1;
+
+	fflush(stdout);
+	pid_t pid = fork();
+	if (pid < 0) {
+		fclose(out[w]);
+		return -1;
+	}
+	if (pid == 0) {
+		tctest_role = TCTEST_WORKER;
+		tctest_worker_index = w;
+		dup2(fileno(out[w]), 1);
+		tctest_claim = __atomic_fetch_add(&tctest_sh->next_claim, 1, __ATOMIC_SEQ_CST);
+		return 0;
+	}
+	tctest_worker_pid[w] = pid;
+	tctest_num_workers++;
+	return 1;
+}
+
+/* Print the output a worker captured for a test */
+static void tctest_copy_output(const tctest_slot *slot) {
+	int fd = fileno(tctest_worker_out[slot->worker]);
+	char buf[4096];
+	long pos = slot->out_start;
+	while (slot->out_end < 0 || pos < slot->out_end) {
+		size_t want = sizeof(buf);
+		if (slot->out_end >= 0 && (long) want > slot->out_end - pos)
+			want = slot->out_end - pos;
+		ssize_t n = pread(fd, buf, want, pos);
+		if (n <= 0)
+			break;
+		fwrite(buf, 1, n, stdout);
+		pos += n;
+	}
+}
+
+/*
+ * Run the tests in worker processes. Returns in the workers (which
+ * go on to run the tests) and, once all workers are done, in the
+ * parent, which then reports the results (see tctest_report_slot).
+ */
+static void tctest_run_workers(void) {
+	tctest_sh = mmap(NULL, sizeof(tctest_shared), PROT_READ | PROT_WRITE,
+		MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+	if (tctest_sh == MAP_FAILED) {
+		tctest_sh = NULL;
+		return; /* run the tests sequentially */
+	}
+	tctest_sh->num_tests = -1;
+
+	int running = 0;
+	for (int i = 0; i < tctest_num_jobs; i++) {
+		int rc = tctest_spawn_worker();
+		if (rc == 0)
+			return;
+		running += rc > 0;
+	}
+	if (running == 0) {
+		munmap(tctest_sh, sizeof(tctest_shared));
+		tctest_sh = NULL;
+		return;
+	}
+	tctest_role = TCTEST_PARENT;
+
+	while (running > 0) {
+		int status;
+		pid_t pid = wait(&status);
+		if (pid < 0) {
+			if (errno == EINTR)
+				continue;
+			break;
+		}
+		int w;
+		for (w = 0; w < tctest_num_workers && tctest_worker_pid[w] != pid; w++)
+			;
+		if (w == tctest_num_workers)
+			continue;
+		running--;
+
+		/*
+		 * A worker that exits any other way than after its last test
+		 * (a crash, or exit() called by a test, even exit(0)) fails
+		 * the test it was running and is replaced while there are
+		 * tests left to claim.
+		 */
+		int died = !WIFEXITED(status) || WEXITSTATUS(status) != 0;
+		for (int i = 0; i < TCTEST_MAX_TESTS; i++) {
+			tctest_slot *slot = &tctest_sh->slots[i];
+			if (slot->state == TCTEST_RUNNING && slot->worker == w) {
+				slot->state = TCTEST_DONE;
+				slot->passed = 0;
+				slot->out_end = -1;
+				died = 1;
+			}
+		}
+		int num_tests = __atomic_load_n(&tctest_sh->num_tests, __ATOMIC_SEQ_CST);
+		int unclaimed = num_tests < 0 ||
+			__atomic_load_n(&tctest_sh->next_claim, __ATOMIC_SEQ_CST) < num_tests;
+		if (!died || !unclaimed)
+			continue;
+		int rc = tctest_spawn_worker();
+		if (rc == 0)
+			return;
+		running += rc > 0;
+	}
+}
+
+/*
+ * Report a test that ran in a worker (called by the parent at the
+ * test's TEST macro). A test without a result, because no worker
+ * got to it, fails.
+ */
+static void tctest_report_slot(int index, const char *testname) {
+	tctest_slot *slot = index < TCTEST_MAX_TESTS ? &tctest_sh->slots[index] : NULL;
+	int passed = 0;
+	tctest_last_test_sec = 0;
+	if (!slot) {
+		printf("%s...too many tests to run in parallel\n", testname);
+	} else if (slot->state != TCTEST_DONE) {
+		printf("%s...not run\n", testname);
+	} else {
+		tctest_copy_output(slot);
+		if (slot->out_end < 0)
+			printf(" (worker process died)\n");
+		passed = slot->passed;
+		tctest_last_test_sec = slot->sec;
+	}
+	fflush(stdout);
+	tctest_num_executed++;
+	if (!passed)
+		tctest_failures++;
+	if (tctest_on_test_executed)
+		tctest_on_test_executed(testname, passed);
+}
+
+void tctest_start(void) {
+	const char *env = getenv("TCTEST_JOBS");
+	if (env)
+		tctest_num_jobs = atoi(env);
+	if (getenv("TCTEST_TIMES"))
+		tctest_report_times = 1;
+	env = getenv("TCTEST_REPORT");
+	if (env && *env)
+		tctest_write_report(env);
+	if (tctest_num_jobs > 1 && !tctest_bench_mode) {
+		tctest_report_times = 1;
+		tctest_run_workers();
+	}
+}
+
+int tctest_begin_test(const char *testname) {
+	int index = tctest_test_counter++;
+	if (tctest_role == TCTEST_PARENT) {
+		tctest_report_slot(index, testname);
+		return 0;
+	}
+	if (tctest_role == TCTEST_WORKER) {
+		if (index != tctest_claim)
+			return 0;
+		if (index >= TCTEST_MAX_TESTS) {
+			printf("%s...too many tests to run in parallel\n", testname);
+			exit(1);
+		}
+		tctest_slot *slot = &tctest_sh->slots[index];
+		slot->worker = tctest_worker_index;
+		fflush(stdout);
+		slot->out_start = lseek(1, 0, SEEK_CUR);
+		__atomic_store_n(&slot->state, TCTEST_RUNNING, __ATOMIC_SEQ_CST);
+	}
+	tctest_bench_iters = 0;
+	tctest_test_start = tctest_now();
+	return 1;
+}
+
+void tctest_test_executed(const char *testname, int passed) {
+	tctest_last_test_sec = tctest_now() - tctest_test_start;
+	if (passed) {
+		if (tctest_report_times)
+			printf(" (%.3f ms)", tctest_last_test_sec * 1e3);
+		printf("\n");
+	}
+
+	if (tctest_role != TCTEST_WORKER) {
+		if (tctest_on_test_executed)
+			tctest_on_test_executed(testname, passed);
+		return;
+	}
+
+	/* the parent reports it and calls the hook */
+	tctest_slot *slot = &tctest_sh->slots[tctest_claim];
+	fflush(stdout);
+	slot->out_end = lseek(1, 0, SEEK_CUR);
+	slot->passed = passed;
+	slot->sec = tctest_last_test_sec;
+	__atomic_store_n(&slot->state, TCTEST_DONE, __ATOMIC_SEQ_CST);
+	tctest_claim = __atomic_fetch_add(&tctest_sh->next_claim, 1, __ATOMIC_SEQ_CST);
+}
+
+void tctest_worker_exit(void) {
+	if (tctest_role != TCTEST_WORKER)
+		return;
+	__atomic_store_n(&tctest_sh->num_tests, tctest_test_counter, __ATOMIC_SEQ_CST);
+	fflush(stdout);
+	_exit(0);
+}
+
+static void tctest_report_on_test_executed(const char *testname, int passed) {
+	tctest_result *r = realloc(tctest_results, (tctest_num_results + 1) * sizeof(tctest_result));
+	if (r) {
+		tctest_results = r;
+		r[tctest_num_results].name = testname;
+		r[tctest_num_results].passed = passed;
+		r[tctest_num_results].sec = tctest_last_test_sec;
+		tctest_num_results++;
+	}
+	if (tctest_prev_on_test_executed)
+		tctest_prev_on_test_executed(testname, passed);
+}
+
+static void tctest_report_on_complete(int num_passed, int num_executed) {
+	FILE *f = fopen(tctest_report_file, "w");
+	if (!f) {
+		perror(tctest_report_file);
+	} else {
+		size_t len = strlen(tctest_report_file);
+		double total = 0;
+		for (int i = 0; i < tctest_num_results; i++)
+			total += tctest_results[i].sec;
+		if (len >= 4 && strcmp(tctest_report_file + len - 4, ".xml") == 0) {
+			fprintf(f, "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n");
+			fprintf(f, "<testsuite name=\"tctest\" tests=\"%d\" failures=\"%d\" time=\"%.6f\">\n",
+				num_executed, num_executed - num_passed, total);
+			for (int i = 0; i < tctest_num_results; i++) {
+				fprintf(f, "  <testcase name=\"%s\" time=\"%.6f\"", tctest_results[i].name,
+					tctest_results[i].sec);
+				if (tctest_results[i].passed)
+					fprintf(f, "/>\n");
+				else
+					fprintf(f, ">\n    <failure message=\"test failed\"/>\n  </testcase>\n");
+			}
+			fprintf(f, "</testsuite>\n");
+		} else {
+			fprintf(f, "{\n  \"executed\": %d,\n  \"passed\": %d,\n  \"time_sec\": %.6f,\n  \"tests\": [",
+				num_executed, num_passed, total);
+			for (int i = 0; i < tctest_num_results; i++)
+				fprintf(f, "%s\n    { \"name\": \"%s\", \"passed\": %s, \"time_sec\": %.6f }",
+					i ? "," : "", tctest_results[i].name,
+					tctest_results[i].passed ? "true" : "false", tctest_results[i].sec);
+			fprintf(f, "\n  ]\n}\n");
+		}
+		fclose(f);
+	}
+	if (tctest_prev_on_complete)
+		tctest_prev_on_complete(num_passed, num_executed);
+}
+
+void tctest_write_report(const char *filename) {
+	tctest_report_file = filename;
+	if (tctest_on_test_executed != tctest_report_on_test_executed) {
+		tctest_prev_on_test_executed = tctest_on_test_executed;
+		tctest_on_test_executed = tctest_report_on_test_executed;
+	}
+	if (tctest_on_complete != tctest_report_on_complete) {
+		tctest_prev_on_complete = tctest_on_complete;
+		tctest_on_complete = tctest_report_on_complete;
+	}
+}
+
+long tctest_bench_next(void) {
+	double now = tctest_now();
+
+	if (tctest_bench_iters == 0) {
+		tctest_bench_iters = 1;
+		tctest_bench_calibrating = 1;
+		tctest_bench_taken = 0;
+		tctest_bench_mean = 0;
+		tctest_bench_m2 = 0;
+	} else if (tctest_bench_calibrating) {
+		/*
+		 * Grow the iteration count until a call takes the sample time;
+		 * that call is not used as a sample (it warmed things up).
+		 */
+		double sec = now - tctest_bench_t0;
+		if (sec >= tctest_bench_sample_sec) {
+			tctest_bench_calibrating = 0;
+		} else {
+			double scale = sec > 0 ? tctest_bench_sample_sec * 1.2 / sec : 100;
+			if (scale < 2)
+				scale = 2;
+			if (scale > 100)
+				scale = 100;
+			if (tctest_bench_iters > 0x7fffffffL / 100)
+				tctest_bench_calibrating = 0;
+			else
+				tctest_bench_iters = (long) (tctest_bench_iters * scale);
+		}
+	} else {
+		/* Welford's method for the mean and variance */
+		double ns = (now - tctest_bench_t0) * 1e9 / tctest_bench_iters;
+		double delta = ns - tctest_bench_mean;
+		tctest_bench_taken++;
+		tctest_bench_mean += delta / tctest_bench_taken;
+		tctest_bench_m2 += delta * (ns - tctest_bench_mean);
+
+		if (tctest_bench_taken >= tctest_bench_samples) {
+			double var = tctest_bench_taken > 1 ? tctest_bench_m2 / (tctest_bench_taken - 1) : 0;
+			double sd = 0;
+			/* square root by Newton's method, to not need libm */
+			for (int i = 0; i < 64 && var > 0; i++)
+				sd = sd > 0 ? (sd + var / sd) / 2 : var;
+			printf("%.2f ns/iter +/- %.2f (%d x %ld iters)", tctest_bench_mean, sd,
+				tctest_bench_taken, tctest_bench_iters);
+			tctest_bench_iters = 0;
+			return 0;
+		}
+	}
+
+	tctest_bench_t0 = tctest_now();
+	return tctest_bench_iters;
+}
+
+#ifndef __GNUC__
+void tctest_keep(const void *p) {
+	static const void *volatile sink;
+	sink = p;
+}
+#endif
@@ -85,6 +85,87 @@ extern void (*tctest_on_test_executed)(const char *testname, int passed);
  */
 extern void (*tctest_on_complete)(int num_passed, int num_executed);
 
+/*
+ * Wall clock time in seconds of the most recently executed test.
+ * It is valid when tctest_on_test_executed is called.
+ */
+extern double tctest_last_test_sec;
+
+/*
+ * Number of worker processes to run tests in. If greater than 1,
+ * TEST_INIT forks that many workers, which all run through the
+ * TEST sequence but each test is claimed and executed by only one of
+ * them, so the tests are spread dynamically over the workers. A test
+ * that kills its worker (e.g. by calling exit, even exit(0), or by
+ * corrupting memory so badly that the signal handlers can't recover)
+ * is reported as failed and a new worker takes over the remaining
+ * tests; a test that no worker got to is reported as failed ("not
+ * run"). The original
+ * process collects the results and prints each test's output in the
+ * usual order, then the hooks are called as usual.
+ *
+ * TEST_INIT sets this from the TCTEST_JOBS environment variable if
+ * it is set (it must be set before TEST_INIT to take effect).
+ */
+extern int tctest_num_jobs;
+
+/*
+ * If nonzero, each passed test's wall clock time is printed after
+ * "passed!". This is always done when running tests in parallel.
+ * TEST_INIT sets it if the TCTEST_TIMES environment variable is set.
+ */
+extern int tctest_report_times;
+
+/*
+ * Write a summary of the results to a file: JUnit XML if the file name
+ * ends in ".xml", JSON otherwise. The summary is collected through the
+ * tctest_on_test_executed and tctest_on_complete hooks (any hooks set
+ * before calling this are still called). TEST_INIT calls this with
+ * the value of the TCTEST_REPORT environment variable if it is set.
+ */
+void tctest_write_report(const char *filename);
+
+/*
+ * If nonzero, TEST does nothing and TEST_BENCH runs benchmarks;
+ * otherwise TEST_BENCH does nothing. A benchmark function has the
+ * form
+ *
+ *   void bench_foo(TestObjs *objs, long iters)
+ *
+ * and should do the measured work iters times. It is called with
+ * increasing iteration counts until one call takes about
+ * tctest_bench_sample_sec (default 0.01) seconds, then
+ * tctest_bench_samples (default 10) more times with that count, and
+ * the mean time per iteration and its standard deviation over the
+ * samples are printed. The fixture is set up once per benchmark and
+ * the signal handling is armed once around all the calls, so neither
+ * is part of the measured time. ASSERT and FAIL work as in tests.
+ * Benchmarks always run sequentially (tctest_num_jobs is ignored).
+ */
+extern int tctest_bench_mode;
+extern double tctest_bench_sample_sec;
+extern int tctest_bench_samples;
+
+/*
+ * Keep the value of a variable (of any type) alive, so the compiler
+ * can't remove the computation of it from a benchmark loop, and
+ * treat all memory as modified, so loop-invariant loads are redone
+ * on every iteration.
+ */
+#ifdef __GNUC__
+#  define TCTEST_KEEP(var) __asm__ __volatile__("" : : "g"(&(var)) : "memory")
+#else
+void tctest_keep(const void *p);
+#  define TCTEST_KEEP(var) tctest_keep(&(var))
+#endif
+
+/* Implementation of the TEST_INIT, TEST and TEST_FINI macros */
+void tctest_start(void);
+int tctest_begin_test(const char *testname);
+void tctest_test_executed(const char *testname, int passed);
+void tctest_worker_exit(void);
+long tctest_bench_next(void);
+
 #ifdef __cplusplus
 /*
  * For tests implemented in C++, attempt to
@@ -99,15 +180,11 @@ extern void (*tctest_on_complete)(int num_passed, int num_executed);
 	} catch (std::exception &ex) { \
 		printf("std::exception (what='%s')\n", ex.what()); \
 		tctest_failures++; \
-		if (tctest_on_test_executed) { \
-			tctest_on_test_executed(#func, 0); \
-		} \
+		tctest_test_executed(#func, 0); \
 	} catch (...) { \
 		printf("exception\n"); \
 		tctest_failures++; \
-		if (tctest_on_test_executed) { \
-			tctest_on_test_executed(#func, 0); \
-		} \
+		tctest_test_executed(#func, 0); \
 	}
 
 #else
@@ -120,10 +197,13 @@ extern void (*tctest_on_complete)(int num_passed, int num_executed);
 
 #define TEST_INIT() do { \
 	tctest_register_signal_handlers(); \
+	tctest_start(); \
 } while (0)
 
 #define TEST(func) do { \
-	if (!tctest_testname_to_execute || strcmp(tctest_testname_to_execute, #func) == 0) { \
+	if (!tctest_bench_mode && \
+			(!tctest_testname_to_execute || strcmp(tctest_testname_to_execute, #func) == 0) && \
+			tctest_begin_test(#func)) { \
 		TestObjs *t = 0; \
 		tctest_num_executed++; \
 		tctest_assertion_line = -1; \
@@ -133,15 +213,39 @@ extern void (*tctest_on_complete)(int num_passed, int num_executed);
 			printf("%s...", #func); \
 			fflush(stdout); \
 			func(t); \
-			printf("passed!\n"); \
-			if (tctest_on_test_executed) { \
-				tctest_on_test_executed(#func, 1); \
-			} \
+			printf("passed!"); \
+			tctest_test_executed(#func, 1); \
 		} else { \
 			tctest_failures++; \
-			if (tctest_on_test_executed) { \
-				tctest_on_test_executed(#func, 0); \
+			tctest_test_executed(#func, 0); \
+		} \
+		TCTEST_CATCH(func) \
+		if (t) { \
+			cleanup(t); \
+		} \
+	} \
+} while (0)
+
+#define TEST_BENCH(func) do { \
+	if (tctest_bench_mode && \
+			(!tctest_testname_to_execute || strcmp(tctest_testname_to_execute, #func) == 0) && \
+			tctest_begin_test(#func)) { \
+		TestObjs *t = 0; \
+		long tctest_iters; \
+		tctest_num_executed++; \
+		tctest_assertion_line = -1; \
+		TCTEST_TRY \
+		if (sigsetjmp(tctest_env, 1) == 0) { \
+			t = setup(); \
+			printf("%s...", #func); \
+			fflush(stdout); \
+			while ((tctest_iters = tctest_bench_next()) > 0) { \
+				func(t, tctest_iters); \
 			} \
+			tctest_test_executed(#func, 1); \
+		} else { \
+			tctest_failures++; \
+			tctest_test_executed(#func, 0); \
 		} \
 		TCTEST_CATCH(func) \
 		if (t) { \
@@ -167,6 +271,7 @@ extern void (*tctest_on_complete)(int num_passed, int num_executed);
 } while (0)
 
 #define TEST_FINI() do { \
+	tctest_worker_exit(); \
 	if (tctest_failures == 0) { \
 		if (tctest_num_executed > 0) { \
 			printf("All tests passed!\n"); \